@@ -0,0 +1,68 @@
+/**
+  ******************************************************************************
+  * @file           : acmeter.h
+  * @brief          : Header for acmeter.c file.
+  *                   AC measurement over interleaved blocks: true RMS,
+  *                   peak-to-peak and zero-crossing frequency.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ACMETER_H
+#define __ACMETER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Smallest crossing hysteresis in ADC counts; the hysteresis used is
+   1/8 of the previous window's peak-to-peak if that is larger */
+#define AC_HYST_MIN            8U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  AC accumulators of one channel (one block or one window)
+  */
+typedef struct
+{
+  uint64_t sum;            /*!< Sum of samples                                */
+  uint64_t sum_sq;         /*!< Sum of squared samples                        */
+  uint32_t count;          /*!< Number of samples                             */
+  uint16_t min;            /*!< Smallest sample                               */
+  uint16_t max;            /*!< Largest sample                                */
+  uint32_t crossings;      /*!< Rising crossings of the level                 */
+  uint64_t first_cross;    /*!< Position of the first crossing, Q16 samples   */
+  uint64_t last_cross;     /*!< Position of the last crossing, Q16 samples    */
+  /* Carried from block to block */
+  uint16_t level;          /*!< Crossing level, previous window mean          */
+  uint16_t hysteresis;     /*!< Re-arm distance below the level               */
+  uint16_t prev;           /*!< Last sample of the previous block             */
+  uint8_t flags;           /*!< AC_FLAG_x                                     */
+} AC_ChannelTypeDef;
+
+#define AC_FLAG_LEVEL          0x01U  /*!< level and hysteresis are valid     */
+#define AC_FLAG_PREV           0x02U  /*!< prev continues into the next block */
+#define AC_FLAG_ARMED          0x04U  /*!< Signal was below level - hysteresis */
+
+/* Exported functions prototypes ---------------------------------------------*/
+void AC_Reset(AC_ChannelTypeDef *ac, uint8_t channels);
+void AC_NextWindow(AC_ChannelTypeDef *ac, uint8_t channels);
+void AC_Block(AC_ChannelTypeDef *block, const AC_ChannelTypeDef *window,
+              const uint16_t *data, uint16_t length, uint8_t channels);
+void AC_Merge(AC_ChannelTypeDef *window, const AC_ChannelTypeDef *block, uint8_t channels);
+void AC_Skip(AC_ChannelTypeDef *window, uint8_t channels);
+
+uint32_t AC_RmsQ8(const AC_ChannelTypeDef *ac, uint8_t include_dc);
+uint16_t AC_PeakToPeak(const AC_ChannelTypeDef *ac);
+uint32_t AC_FrequencyMilliHz(const AC_ChannelTypeDef *ac, uint32_t rate_mhz);
+uint32_t AC_Isqrt(uint64_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ACMETER_H */
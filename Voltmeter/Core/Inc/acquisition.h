@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * @file           : acquisition.h
+  * @brief          : Header for acquisition.c file.
+  *                   Double-buffered (ping-pong) ADC acquisition over the
+  *                   circular DMA channel.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ACQUISITION_H
+#define __ACQUISITION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Regular sequence length: the 10 external inputs plus the temperature
+   sensor and Vrefint */
+#define ACQ_MAX_CHANNELS       12U
+
+/* Scans (one conversion of every channel in the list) in one half of the
+   circular DMA buffer. While the CPU processes one half, the DMA fills the
+   other one, so the value may be raised to several hundred scans without
+   stalling the main loop. */
+#define ACQ_SCANS_PER_HALF     16U
+#define ACQ_BUFFER_SIZE        (2U * ACQ_SCANS_PER_HALF * ACQ_MAX_CHANNELS)
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  ADC arrangement feeding the DMA buffer
+  */
+typedef enum
+{
+  ACQ_MODE_INDEPENDENT = 0U,     /*!< ADC1 alone, scan of the channel list               */
+  ACQ_MODE_DUAL_SIMULT,          /*!< ADC1 and ADC2 convert two channels at the same time */
+  ACQ_MODE_DUAL_INTERLEAVED      /*!< ADC1 and ADC2 alternate on one channel, 2x rate     */
+} ACQ_ModeTypeDef;
+
+/**
+  * @brief  Descriptor of one completed half-buffer
+  */
+typedef struct
+{
+  const uint16_t *data;    /*!< First sample of the block (inside the DMA buffer) */
+  uint16_t length;         /*!< Number of samples in the block                    */
+  uint8_t channels;        /*!< Interleaved channels, samples are in rank order   */
+  uint32_t sequence;       /*!< Block number since ACQ_Start(), first block is 1  */
+  uint32_t timestamp;      /*!< DWT cycle count when the DMA completed the block  */
+} ACQ_BlockTypeDef;
+
+/**
+  * @brief  Block accounting since ACQ_Start()
+  */
+typedef struct
+{
+  uint32_t blocks;         /*!< Blocks completed by the DMA                       */
+  uint32_t missed;         /*!< Completed but overwritten before ACQ_GetBlock()   */
+  uint32_t torn;           /*!< Overwritten while being processed                 */
+  uint32_t latency_max;    /*!< Longest DMA interrupt to ACQ_GetBlock(), cycles   */
+  uint32_t period;         /*!< Time between two blocks at the current rate,
+                                cycles; latency_max must stay below it        */
+} ACQ_StatsTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+/* ADC inputs of the 48-pin C8: IN0..IN9 (PA0..PA7, PB0, PB1), the
+   temperature sensor and Vrefint; IN10..IN15 are not bonded out */
+#define IS_ACQ_CHANNEL(ch)     (((ch) <= ADC_CHANNEL_9) || ((ch) == ADC_CHANNEL_TEMPSENSOR) || \
+                                ((ch) == ADC_CHANNEL_VREFINT))
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef ACQ_Init(ADC_HandleTypeDef *hadc, ADC_HandleTypeDef *hadc_slave);
+HAL_StatusTypeDef ACQ_ConfigChannels(const uint8_t *channels, uint8_t count);
+HAL_StatusTypeDef ACQ_ConfigDual(ACQ_ModeTypeDef mode, uint8_t channel_a, uint8_t channel_b);
+ACQ_ModeTypeDef ACQ_GetMode(void);
+uint8_t ACQ_GetChannels(uint8_t *channels);
+HAL_StatusTypeDef ACQ_SetSampleRate(uint32_t rate_hz);
+uint32_t ACQ_GetSampleRateMilliHz(void);
+HAL_StatusTypeDef ACQ_Start(void);
+HAL_StatusTypeDef ACQ_Stop(void);
+uint8_t ACQ_IsRunning(void);
+uint8_t ACQ_GetBlock(ACQ_BlockTypeDef *block);
+void ACQ_UnpackBlock(const ACQ_BlockTypeDef *block);
+uint8_t ACQ_ReleaseBlock(const ACQ_BlockTypeDef *block);
+uint32_t ACQ_GetOverruns(void);
+void ACQ_GetStats(ACQ_StatsTypeDef *stats);
+
+/* Called from HAL_ADC_ConvHalfCpltCallback / HAL_ADC_ConvCpltCallback */
+void ACQ_HalfCpltHandler(void);
+void ACQ_CpltHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ACQUISITION_H */
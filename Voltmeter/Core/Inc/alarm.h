@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file           : alarm.h
+  * @brief          : Header for alarm.c file.
+  *                   Over/under-voltage alarms: ADC1 analog watchdog on the
+  *                   first channel, block min/max on the others.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ALARM_H
+#define __ALARM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "stats.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define ALM_MAX_CHANNELS       12U
+/* Pending events; more are counted as lost */
+#define ALM_QUEUE_SIZE         8U
+/* The watchdog interrupt is off for this long after an event, so a signal
+   that stays out of the window does not interrupt every conversion */
+#define ALM_HOLDOFF_MS         100U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Window of one monitored channel, ADC counts
+  */
+typedef struct
+{
+  uint8_t channel;         /*!< ADC_CHANNEL_x                                */
+  uint16_t low;            /*!< Under-voltage below this value               */
+  uint16_t high;           /*!< Over-voltage above this value                */
+} ALM_ChannelTypeDef;
+
+/**
+  * @brief  Latched out-of-window event
+  */
+typedef struct
+{
+  uint32_t tick;           /*!< HAL_GetTick() when latched                   */
+  uint16_t value;          /*!< Sample outside the window                    */
+  uint8_t channel;         /*!< ADC_CHANNEL_x                                */
+  uint8_t over;            /*!< 1 - above high, 0 - below low                */
+  uint8_t watchdog;        /*!< 1 - analog watchdog, 0 - block check         */
+} ALM_EventTypeDef;
+
+/**
+  * @brief  Alarm counters
+  */
+typedef struct
+{
+  uint32_t watchdog_events;  /*!< Events from the analog watchdog            */
+  uint32_t block_events;     /*!< Events from the block check                */
+  uint32_t lost_events;      /*!< Events the queue had no room for           */
+} ALM_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void ALM_Init(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef ALM_Config(const ALM_ChannelTypeDef *list, uint8_t count);
+void ALM_CheckBlock(const STATS_ChannelTypeDef *stats, uint8_t channels);
+void ALM_Process(void);
+uint8_t ALM_GetEvent(ALM_EventTypeDef *event);
+void ALM_GetStats(ALM_StatsTypeDef *stats);
+
+/* Called from HAL_ADC_LevelOutOfWindowCallback */
+void ALM_WatchdogHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ALARM_H */
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file           : calib.h
+  * @brief          : Header for calib.c file.
+  *                   Per-channel piecewise linear calibration (1..4 points)
+  *                   kept in the emulated EEPROM.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CALIB_H
+#define __CALIB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* 1 point corrects the offset, 2 points gain and offset, 3..4 points a
+   piecewise linear curve */
+#define CAL_MAX_POINTS         4U
+/* ADC_CHANNEL_0..ADC_CHANNEL_VREFINT */
+#define CAL_CHANNELS           18U
+/* Points hold the reading in ADC counts with 4 fractional bits, so an
+   averaged or oversampled reading keeps its resolution; readings are
+   referred to the nominal supply (VOLT_Compensate) */
+#define CAL_RAW_SHIFT          4U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Calibration point: reading and the true input voltage
+  */
+typedef struct
+{
+  uint16_t raw;            /*!< ADC counts << CAL_RAW_SHIFT                  */
+  uint32_t microvolts;     /*!< Reference voltage applied                    */
+} CAL_PointTypeDef;
+
+/**
+  * @brief  Precomputed conversion of one channel, one entry per segment
+  */
+typedef struct
+{
+  uint8_t segments;                        /*!< 0 - nominal conversion       */
+  uint16_t start[CAL_MAX_POINTS - 1U];     /*!< Segment start, raw units     */
+  int32_t base[CAL_MAX_POINTS - 1U];       /*!< uV at the segment start      */
+  int32_t slope[CAL_MAX_POINTS - 1U];      /*!< uV per raw unit, Q16         */
+} CAL_TableTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef CAL_Init(void);
+HAL_StatusTypeDef CAL_AddPoint(uint8_t channel, uint16_t raw, uint32_t microvolts);
+HAL_StatusTypeDef CAL_Clear(uint8_t channel);
+uint8_t CAL_GetPoints(uint8_t channel, CAL_PointTypeDef *points);
+uint32_t CAL_ToMicrovolts(uint8_t channel, uint32_t value, uint8_t extra_bits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CALIB_H */
@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file           : capture.h
+  * @brief          : Header for capture.c file.
+  *                   Triggered capture: a pre-trigger history of the
+  *                   acquisition blocks is kept until a trigger fires, the
+  *                   frozen record is then dumped as stream frames.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "acquisition.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* History ring in samples, all channels; pre_scans + post_scans must fit
+   into CAP_BUFFER_SAMPLES / channels */
+#define CAP_BUFFER_SAMPLES     1024U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Trigger condition on one channel of the scan
+  */
+typedef enum
+{
+  CAP_TRIG_RISING = 0U,    /*!< Crosses level upwards (after level - hysteresis)  */
+  CAP_TRIG_FALLING,        /*!< Crosses level downwards (after level + hysteresis) */
+  CAP_TRIG_ABOVE,          /*!< Any sample above level                            */
+  CAP_TRIG_BELOW,          /*!< Any sample below level (brown-out)                */
+  CAP_TRIG_OUTSIDE         /*!< Any sample below level or above level_high        */
+} CAP_TriggerTypeDef;
+
+/**
+  * @brief  Capture state
+  */
+typedef enum
+{
+  CAP_STATE_IDLE = 0U,     /*!< Not armed                                    */
+  CAP_STATE_ARMED,         /*!< Filling the history, waiting for the trigger */
+  CAP_STATE_TRIGGERED,     /*!< Recording the post-trigger samples           */
+  CAP_STATE_FROZEN         /*!< Record complete, being sent                  */
+} CAP_StateTypeDef;
+
+/**
+  * @brief  Capture settings
+  */
+typedef struct
+{
+  CAP_TriggerTypeDef trigger;
+  uint8_t rank;            /*!< Trigger channel, position in the scan list   */
+  uint16_t level;          /*!< Trigger level in ADC counts                  */
+  uint16_t level_high;     /*!< Upper level of CAP_TRIG_OUTSIDE              */
+  uint16_t hysteresis;     /*!< Edge triggers re-arm this far from level     */
+  uint16_t pre_scans;      /*!< Scans kept before the trigger scan           */
+  uint16_t post_scans;     /*!< Scans from the trigger scan on               */
+  uint8_t single;          /*!< 1 - stop after one record, 0 - re-arm        */
+} CAP_ConfigTypeDef;
+
+/**
+  * @brief  Capture counters
+  */
+typedef struct
+{
+  uint32_t captures;       /*!< Records sent completely                      */
+  uint32_t frames_sent;    /*!< Frames queued on the UART                    */
+  uint32_t restarts;       /*!< History dropped after an overwritten block   */
+  uint32_t disarmed;       /*!< Disarmed by a scan list without the trigger
+                                rank or too long for the record             */
+} CAP_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef CAP_Config(const CAP_ConfigTypeDef *config);
+HAL_StatusTypeDef CAP_Arm(void);
+void CAP_Disarm(void);
+CAP_StateTypeDef CAP_GetState(void);
+void CAP_Block(const ACQ_BlockTypeDef *block);
+void CAP_Release(uint8_t valid);
+void CAP_Process(void);
+void CAP_GetStats(CAP_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAPTURE_H */
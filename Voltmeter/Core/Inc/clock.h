@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file           : clock.h
+  * @brief          : Header for clock.c file.
+  *                   Named clock tree profiles switched at runtime, with the
+  *                   sample rate and the baud rate carried over.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Longest wait for the UART to send what is queued at the old baud rate:
+   a full transmit ring at 9600 baud */
+#define CLK_DRAIN_TIMEOUT_MS   2500U
+
+/* Largest baud rate error accepted on a new tree, per mille; a profile whose
+   PCLK cannot produce the UART baud rate within it is refused */
+#define CLK_BAUD_TOLERANCE     20U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Clock tree profiles
+  */
+typedef enum
+{
+  CLK_PROFILE_HSI64 = 0U,      /*!< HSI/2 x 16 = 64 MHz, ADC 8 MHz; the tree of
+                                    SystemClock_Config()                    */
+  CLK_PROFILE_HSE72,           /*!< 8 MHz crystal x 9 = 72 MHz, ADC 12 MHz;
+                                    highest sample rate                     */
+  CLK_PROFILE_HSI8,            /*!< HSI 8 MHz without PLL, ADC 4 MHz;
+                                    lowest supply current                   */
+  CLK_PROFILE_COUNT
+} CLK_ProfileTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void CLK_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef CLK_SetProfile(CLK_ProfileTypeDef profile);
+CLK_ProfileTypeDef CLK_GetProfile(void);
+const char *CLK_Name(CLK_ProfileTypeDef profile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_H */
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file           : command.h
+  * @brief          : Header for command.c file.
+  *                   Text command interface on the USART1 receiver (circular
+  *                   DMA with idle-line detection).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __COMMAND_H
+#define __COMMAND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "filter.h"
+#include "robust.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Circular DMA buffer; must hold everything received between two passes
+   of the main loop */
+#define CMD_RX_BUFFER_SIZE     64U
+/* Longest command line without the terminator */
+#define CMD_LINE_MAX           48U
+#define CMD_MAX_ARGS           14U
+
+#define CMD_PERIOD_MIN_MS      10U
+#define CMD_PERIOD_MAX_MS      60000U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Report formats
+  */
+typedef enum
+{
+  CMD_FORMAT_TEXT = 0U,        /*!< DC text report                            */
+  CMD_FORMAT_AC,               /*!< AC text report (RMS, Vpp, frequency)      */
+  CMD_FORMAT_STREAM,           /*!< Binary sample frames                      */
+  CMD_FORMAT_FFT               /*!< Spectrum of one channel (frequency, THD)  */
+} CMD_FormatTypeDef;
+
+/**
+  * @brief  Settings the main loop works with, changed by the commands
+  */
+typedef struct
+{
+  uint32_t report_ms;          /*!< Report period                             */
+  FLT_PresetTypeDef filter;    /*!< Filter preset of the processing stage     */
+  CMD_FormatTypeDef format;    /*!< Report format                             */
+  uint8_t restart;             /*!< Set on a reconfiguration; the main loop
+                                    restarts its report window and clears it */
+  uint8_t cal_pending;         /*!< Calibration point wanted from the window  */
+  uint8_t cal_channel;         /*!< ADC_CHANNEL_x of the point                */
+  uint32_t cal_microvolts;     /*!< Reference voltage applied                 */
+  uint16_t avg_window;         /*!< Moving average samples per channel, 0 off */
+  ROB_ConfigTypeDef robust[ROB_MAX_CHANNELS]; /*!< Spike rejection per position
+                                                   in the scan list         */
+} CMD_SettingsTypeDef;
+
+/**
+  * @brief  Command interface counters
+  */
+typedef struct
+{
+  uint32_t commands;           /*!< Lines executed                            */
+  uint32_t rejected;           /*!< Unknown commands or bad arguments         */
+  uint32_t overlong;           /*!< Lines longer than CMD_LINE_MAX, dropped   */
+  uint32_t rx_errors;          /*!< Framing/noise/overrun errors (restarts)   */
+} CMD_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef CMD_Init(UART_HandleTypeDef *huart, CMD_SettingsTypeDef *settings);
+void CMD_Process(void);
+void CMD_ReadProcess(void);
+void CMD_GetStats(CMD_StatsTypeDef *stats);
+
+/* Called from HAL_UARTEx_RxEventCallback / HAL_UART_ErrorCallback */
+void CMD_RxEventHandler(uint16_t position);
+void CMD_ErrorHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COMMAND_H */
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file           : cycle.h
+  * @brief          : Cortex-M3 DWT cycle counter access.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CYCLE_H
+#define __CYCLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Starts the free-running DWT cycle counter (CPU clock)
+  */
+__STATIC_INLINE void CYCLE_Init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0U;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+  * @brief  Current cycle count, wraps every 2^32 cycles
+  */
+__STATIC_INLINE uint32_t CYCLE_Now(void)
+{
+  return DWT->CYCCNT;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CYCLE_H */
@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file           : datalog.h
+  * @brief          : Header for datalog.c file.
+  *                   Decimated, delta-compressed sample log in a ring of the
+  *                   flash pages the program does not use.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_H
+#define __DATALOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "acquisition.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define LOG_PAGE_SIZE          0x400U
+/* The ring runs from the first free page after the program image up to the
+   emulated EEPROM pages; fewer pages than this disable the log (checked
+   at link time by STM32F103C8TX_FLASH.ld, keep _Log_Min_Pages equal) */
+#define LOG_MIN_PAGES          2U
+
+/* Scans averaged into one logged scan; at least one block per logged scan
+   keeps the flash writes far below the page budget */
+#define LOG_MIN_DECIMATION     ACQ_SCANS_PER_HALF
+#define LOG_MAX_DECIMATION     60000U
+#define LOG_DEFAULT_DECIMATION 1000U
+
+/* Flash operations waiting for the main loop; LOG_PROGRAM_BURST halfwords
+   (about 60 us each) are programmed per LOG_Process call */
+#define LOG_QUEUE_SIZE         64U
+#define LOG_PROGRAM_BURST      16U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Logger counters
+  */
+typedef struct
+{
+  uint32_t pages;          /*!< Pages in the ring                            */
+  uint32_t scans;          /*!< Decimated scans logged since LOG_Start       */
+  uint32_t samples;        /*!< Samples in those scans, all channels         */
+  uint32_t nibbles;        /*!< Payload they took, 4-bit units               */
+  uint32_t dropped_scans;  /*!< Scans without valid samples or queue room   */
+  uint32_t gaps;           /*!< Pages closed early by lost blocks or changes */
+  uint32_t erases;         /*!< Pages erased                                 */
+  uint32_t flash_errors;   /*!< Failed erase or program operations           */
+  uint32_t bad_pages;      /*!< Pages skipped by the last dump (CRC)         */
+} LOG_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef LOG_Init(void);
+HAL_StatusTypeDef LOG_Start(uint16_t decimation);
+void LOG_Stop(void);
+uint8_t LOG_IsRunning(void);
+HAL_StatusTypeDef LOG_Dump(void);
+uint8_t LOG_IsDumping(void);
+HAL_StatusTypeDef LOG_Erase(void);
+
+void LOG_Block(const ACQ_BlockTypeDef *block);
+void LOG_Release(uint8_t valid);
+void LOG_Process(void);
+void LOG_GetStats(LOG_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_H */
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file           : eeprom.h
+  * @brief          : Header for eeprom.c file.
+  *                   EEPROM emulation on a pair of flash pages: 16-bit
+  *                   values under 16-bit virtual addresses.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __EEPROM_H
+#define __EEPROM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* The last two 1 KB pages of the 64 KB STM32F103C8, the EEPROM region of
+   STM32F103C8TX_FLASH.ld, which keeps them out of the image */
+#define EE_PAGE_SIZE           0x400U
+#define EE_PAGE0_ADDRESS       0x0800F800U
+#define EE_PAGE1_ADDRESS       (EE_PAGE0_ADDRESS + EE_PAGE_SIZE)
+
+/* Virtual addresses 1..EE_MAX_VADDR; all of them must fit into one page
+   ((EE_PAGE_SIZE - 4) / 4 records) for the page transfer */
+#define EE_MAX_VADDR           240U
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef EE_Init(void);
+uint8_t EE_Read(uint16_t vaddr, uint16_t *data);
+HAL_StatusTypeDef EE_Write(uint16_t vaddr, uint16_t data);
+uint32_t EE_GetTransfers(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EEPROM_H */
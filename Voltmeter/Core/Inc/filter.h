@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @file           : filter.h
+  * @brief          : Header for filter.c file.
+  *                   Fixed-point biquad cascade and decimating FIR applied
+  *                   per channel to the acquisition blocks.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FILTER_H
+#define __FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define FLT_MAX_CHANNELS       12U
+#define FLT_MAX_STAGES         2U
+#define FLT_FIR_MAX_TAPS       32U
+/* Samples of one channel in one block */
+#define FLT_MAX_BLOCK          192U
+
+/* Samples enter the filters as ADC counts in Q16 (12.16 bits), leaving
+   headroom for overshoot in the int32 signal path */
+#define FLT_SIGNAL_SHIFT       16U
+#define FLT_ADC_MAX            4095U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Filter presets (coefficients in filter_coeffs.h)
+  */
+typedef enum
+{
+  FLT_PRESET_NONE = 0U,
+  FLT_PRESET_LOWPASS,          /*!< Butterworth low-pass, FIR decimation by 4 */
+  FLT_PRESET_NOTCH_50HZ,       /*!< 50 Hz mains and third harmonic notches    */
+  FLT_PRESET_NOTCH_60HZ,       /*!< 60 Hz mains and third harmonic notches    */
+  FLT_PRESET_COUNT
+} FLT_PresetTypeDef;
+
+/**
+  * @brief  Coefficient set of a preset
+  */
+typedef struct
+{
+  const int32_t *sos;      /*!< stages x {b0, b1, b2, a1, a2}, Q30          */
+  uint8_t stages;          /*!< Biquad sections, 0..FLT_MAX_STAGES          */
+  const int16_t *fir;      /*!< FIR taps in Q15, NULL for no FIR            */
+  uint8_t taps;            /*!< Multiple of 4, 0..FLT_FIR_MAX_TAPS          */
+  uint8_t decimation;      /*!< FIR output every n-th input, 1 = no decimation */
+} FLT_DesignTypeDef;
+
+/**
+  * @brief  Filter state of one channel
+  */
+typedef struct
+{
+  int32_t biquad[FLT_MAX_STAGES][4];     /*!< x[n-1], x[n-2], y[n-1], y[n-2]   */
+  int32_t fir[2U * FLT_FIR_MAX_TAPS];    /*!< Delay line stored twice, so the
+                                              newest taps are always contiguous */
+  uint8_t fir_pos;                       /*!< Index of the newest FIR input    */
+  uint8_t phase;                         /*!< Inputs since the last FIR output */
+} FLT_ChannelTypeDef;
+
+/**
+  * @brief  Filter stage for interleaved multi-channel blocks
+  */
+typedef struct
+{
+  FLT_PresetTypeDef preset;
+  const FLT_DesignTypeDef *design;
+  uint8_t channels;
+  FLT_ChannelTypeDef channel[FLT_MAX_CHANNELS];
+} FLT_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint8_t FLT_Config(FLT_HandleTypeDef *flt, FLT_PresetTypeDef preset, uint8_t channels);
+void FLT_Reset(FLT_HandleTypeDef *flt);
+uint16_t FLT_Block(FLT_HandleTypeDef *flt, const uint16_t *data, uint16_t length,
+                   uint16_t *out, uint16_t out_size, uint8_t extra_bits);
+uint32_t FLT_GetDesignRate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FILTER_H */
@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file           : filter_coeffs.h
+  * @brief          : Filter preset coefficients for filter.c.
+  *                   Generated by Host/filter_design.py, do not edit.
+  *
+  *                   Designed for a 1000 Hz sample rate:
+  *                   LOWPASS   4th order Butterworth at 40 Hz, then a
+  *                             32-tap FIR at 100 Hz decimating by 4
+  *                   NOTCH_50  notches at 50 and 150 Hz, Q 5
+  *                   NOTCH_60  notches at 60 and 180 Hz, Q 5
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FILTER_COEFFS_H
+#define __FILTER_COEFFS_H
+
+#define FLT_DESIGN_FS_HZ       1000U
+
+/* Biquads: b0, b1, b2, a1, a2 in Q30, a1/a2 negated */
+#define FLT_LOWPASS_STAGES     2U
+#define FLT_LOWPASS_TAPS       32U
+#define FLT_LOWPASS_DECIMATION 4U
+#define FLT_NOTCH50_STAGES     2U
+#define FLT_NOTCH60_STAGES     2U
+
+static const int32_t flt_lowpass_sos[] =
+{
+     13715517,    27431033,    13715517,  1691401047,  -672521290,
+     15401074,    30802149,    15401074,  1899264453,  -887126926,
+};
+
+static const int16_t flt_lowpass_fir[] =
+{
+       0,     39,     91,    139,    129,      0,   -271,   -609,
+    -832,   -696,      0,   1297,   3011,   4755,   6059,   6544,
+    6059,   4755,   3011,   1297,      0,   -696,   -832,   -609,
+    -271,      0,    129,    139,     91,     39,      0,      0,
+};
+
+static const int32_t flt_notch50_sos[] =
+{
+   1041555974, -1981157193,  1041555974,  1981157193, -1009370125,
+    993376016, -1167783545,   993376016,  1167783545,  -913010208,
+};
+
+static const int32_t flt_notch60_sos[] =
+{
+   1035618176, -1925786857,  1035618176,  1925786857,  -997494528,
+    984648192,  -838485619,   984648192,   838485619,  -895554560,
+};
+
+#endif /* __FILTER_COEFFS_H */
@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file           : format.h
+  * @brief          : Header for format.c file.
+  *                   Small integer-to-decimal text formatter.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FORMAT_H
+#define __FORMAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Longest output of FMT_Uint (4294967295) */
+#define FMT_UINT_MAX_LEN       10U
+
+/* Exported functions prototypes ---------------------------------------------*/
+/* Each function writes at dst without a terminator and returns the position
+   after the last character written; the caller sizes the buffer. */
+char *FMT_Str(char *dst, const char *str);
+char *FMT_Uint(char *dst, uint32_t value);
+char *FMT_Fixed(char *dst, uint32_t value, uint8_t decimals);
+char *FMT_Volts(char *dst, uint32_t microvolts, uint8_t decimals);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FORMAT_H */
@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file           : inject.h
+  * @brief          : Header for inject.c file.
+  *                   On-demand single conversions on the ADC1 injected group
+  *                   while the regular group keeps streaming through DMA.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __INJECT_H
+#define __INJECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Requests waiting behind the one being converted */
+#define INJ_QUEUE_SIZE         4U
+/* Sampling time of channels outside the scan list: 239.5 cycles suit a
+   high-impedance divider (battery) and Vrefint (17.1 us minimum) */
+#define INJ_SAMPLE_TIME        ADC_SAMPLETIME_239CYCLES_5
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Progress of a request
+  */
+typedef enum
+{
+  INJ_STATE_IDLE = 0U,         /*!< Never submitted                          */
+  INJ_STATE_QUEUED,            /*!< Waiting for the injected group           */
+  INJ_STATE_BUSY,              /*!< Being converted                          */
+  INJ_STATE_DONE,              /*!< value and timestamp are valid            */
+  INJ_STATE_ERROR              /*!< Not converted (dual mode, HAL error)     */
+} INJ_StateTypeDef;
+
+/**
+  * @brief  One conversion, owned by the caller until it is DONE or ERROR
+  */
+typedef struct
+{
+  uint8_t channel;                   /*!< ADC_CHANNEL_x                       */
+  volatile INJ_StateTypeDef state;   /*!< Written by the ADC interrupt        */
+  volatile uint16_t value;           /*!< 12-bit result                       */
+  volatile uint32_t timestamp;       /*!< DWT cycle count at the end of the
+                                          conversion                      */
+} INJ_RequestTypeDef;
+
+/**
+  * @brief  Injected group counters
+  */
+typedef struct
+{
+  uint32_t requests;           /*!< Requests accepted                        */
+  uint32_t conversions;        /*!< Conversions completed                    */
+  uint32_t rejected;           /*!< Requests refused (queue full, dual mode) */
+} INJ_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef INJ_Init(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef INJ_Submit(INJ_RequestTypeDef *request, uint8_t channel);
+uint8_t INJ_IsFinished(const INJ_RequestTypeDef *request);
+uint8_t INJ_IsIdle(void);
+HAL_StatusTypeDef INJ_Read(uint8_t channel, uint32_t timeout_ms, uint16_t *value);
+void INJ_Process(void);
+void INJ_GetStats(INJ_StatsTypeDef *stats);
+
+/* Called from HAL_ADCEx_InjectedConvCpltCallback */
+void INJ_CpltHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INJECT_H */
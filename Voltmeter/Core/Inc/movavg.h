@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file           : movavg.h
+  * @brief          : Header for movavg.c file.
+  *                   Sliding-window moving average over consecutive blocks,
+  *                   constant time per sample for any window length.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MOVAVG_H
+#define __MOVAVG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define MAVG_MAX_CHANNELS      12U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Moving average of interleaved multi-channel blocks
+  */
+typedef struct
+{
+  uint16_t *history;       /*!< Last window scans, interleaved; caller memory */
+  uint16_t size;           /*!< Samples the history holds, all channels       */
+  uint16_t requested;      /*!< Window set by MAVG_Config()                   */
+  uint16_t window;         /*!< Samples per channel in the average, 0 - off;
+                                requested, shortened to fit the history   */
+  uint8_t channels;        /*!< Interleave stride of the input blocks         */
+  uint16_t head;           /*!< Scan overwritten next                         */
+  uint16_t fill;           /*!< Scans in the history, at most window          */
+  uint32_t sum[MAVG_MAX_CHANNELS]; /*!< Exact sum of the history per channel  */
+} MAVG_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void MAVG_Init(MAVG_HandleTypeDef *mavg, uint16_t *history, uint16_t size);
+void MAVG_Config(MAVG_HandleTypeDef *mavg, uint16_t window);
+void MAVG_Reset(MAVG_HandleTypeDef *mavg);
+void MAVG_Block(MAVG_HandleTypeDef *mavg, const uint16_t *data, uint16_t length, uint8_t channels);
+void MAVG_Release(MAVG_HandleTypeDef *mavg, uint8_t valid);
+uint8_t MAVG_IsFull(const MAVG_HandleTypeDef *mavg);
+uint32_t MAVG_Mean(const MAVG_HandleTypeDef *mavg, uint8_t channel, uint8_t extra_bits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MOVAVG_H */
@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file           : oversample.h
+  * @brief          : Header for oversample.c file.
+  *                   Oversample-and-decimate stage (boxcar or CIC) raising
+  *                   the 12-bit ADC results to 13..16 bits.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __OVERSAMPLE_H
+#define __OVERSAMPLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define OVS_ADC_BITS           12U
+/* 4^n input samples per output for n extra bits */
+#define OVS_MAX_EXTRA_BITS     4U
+/* 1 - boxcar (sum and dump), 2 - second order CIC */
+#define OVS_MAX_ORDER          2U
+#define OVS_MAX_CHANNELS       12U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Decimator state of one channel
+  */
+typedef struct
+{
+  uint32_t integrator[OVS_MAX_ORDER]; /*!< Running sums, wrap around by design */
+  uint32_t comb[OVS_MAX_ORDER];       /*!< Delayed values of the comb stages   */
+  uint16_t phase;                     /*!< Inputs taken since the last output  */
+} OVS_ChannelTypeDef;
+
+/**
+  * @brief  Oversampling stage for interleaved multi-channel blocks
+  */
+typedef struct
+{
+  uint8_t extra_bits;      /*!< Output resolution is OVS_ADC_BITS + extra_bits */
+  uint8_t order;           /*!< Number of integrator/comb pairs               */
+  uint8_t shift;           /*!< Right shift removing the surplus filter gain  */
+  uint8_t channels;        /*!< Interleave stride of the input blocks         */
+  uint16_t ratio;          /*!< Decimation ratio, 4^extra_bits                */
+  OVS_ChannelTypeDef channel[OVS_MAX_CHANNELS];
+} OVS_HandleTypeDef;
+
+/**
+  * @brief  Noise accumulator of one decimated channel (ENOB estimate)
+  */
+typedef struct
+{
+  int64_t sum;             /*!< Sum of deviations from the first value        */
+  uint64_t sum_sq;         /*!< Sum of squared deviations                     */
+  uint32_t count;          /*!< Number of values                              */
+  uint16_t reference;      /*!< First value, keeps the sums small             */
+} OVS_NoiseTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint8_t OVS_Config(OVS_HandleTypeDef *ovs, uint8_t extra_bits, uint8_t order, uint8_t channels);
+void OVS_Reset(OVS_HandleTypeDef *ovs);
+uint16_t OVS_Block(OVS_HandleTypeDef *ovs, const uint16_t *data, uint16_t length,
+                   uint16_t *out, uint16_t out_size);
+
+void OVS_NoiseReset(OVS_NoiseTypeDef *noise, uint8_t channels);
+void OVS_NoiseBlock(OVS_NoiseTypeDef *noise, const uint16_t *data,
+                    uint16_t length, uint8_t channels);
+uint16_t OVS_Enob(const OVS_NoiseTypeDef *noise, uint8_t bits);
+uint32_t OVS_Log2Q16(uint64_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OVERSAMPLE_H */
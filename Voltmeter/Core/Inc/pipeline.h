@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file           : pipeline.h
+  * @brief          : Header for pipeline.c file.
+  *                   Per-block processing of the report path (statistics,
+  *                   spike rejection, AC meter, filter or oversampling). Free of HAL
+  *                   dependencies, so it also builds on the PC (Host/).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PIPELINE_H
+#define __PIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "stats.h"
+#include "oversample.h"
+#include "filter.h"
+#include "acmeter.h"
+#include "robust.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define PIPE_MAX_CHANNELS      12U
+/* Samples of one block, all channels (one ACQ half-buffer) */
+#define PIPE_MAX_BLOCK         192U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Processing state and report window of the main loop
+  */
+typedef struct
+{
+  /* Configuration, set by PIPE_Config() */
+  FLT_PresetTypeDef filter;      /*!< Filter preset, FLT_PRESET_NONE: oversampling */
+  uint8_t extra_bits;            /*!< Oversampling bits, 0 = raw samples           */
+  uint8_t order;                 /*!< Oversampling filter order                    */
+  uint8_t ac;                    /*!< 1 - run the AC meter                         */
+
+  /* Stages, reconfigured when the channel count changes */
+  FLT_HandleTypeDef flt;
+  OVS_HandleTypeDef ovs;
+  ROB_HandleTypeDef rob;         /*!< Set per channel by PIPE_ConfigRobust()       */
+
+  /* Last block, valid between PIPE_Block() and the next block */
+  uint8_t channels;              /*!< Interleaved channels of the block            */
+  uint8_t processed;             /*!< 1 if proc_out holds filter/oversampling data */
+  uint16_t proc_count;           /*!< Values in proc_out, all channels             */
+  uint16_t proc_out[PIPE_MAX_BLOCK]; /*!< ADC counts with extra_bits more bits     */
+  STATS_ChannelTypeDef block_stats[PIPE_MAX_CHANNELS];
+  STATS_ChannelTypeDef proc_block_stats[PIPE_MAX_CHANNELS];
+  STATS_ChannelTypeDef rob_block_stats[ROB_MAX_CHANNELS];
+  AC_ChannelTypeDef ac_block[PIPE_MAX_CHANNELS];
+
+  /* Report window, merged from the intact blocks; the robust estimates
+     replace the raw samples for the channels with a robust mode */
+  STATS_ChannelTypeDef window_stats[PIPE_MAX_CHANNELS];
+  STATS_ChannelTypeDef proc_stats[PIPE_MAX_CHANNELS];
+  OVS_NoiseTypeDef proc_noise[PIPE_MAX_CHANNELS];
+  AC_ChannelTypeDef ac_window[PIPE_MAX_CHANNELS];
+} PIPE_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint8_t PIPE_Config(PIPE_HandleTypeDef *pipe, FLT_PresetTypeDef filter,
+                    uint8_t extra_bits, uint8_t order, uint8_t ac);
+uint8_t PIPE_ConfigRobust(PIPE_HandleTypeDef *pipe, const ROB_ConfigTypeDef *config, uint8_t count);
+void PIPE_ResetWindow(PIPE_HandleTypeDef *pipe);
+void PIPE_NextWindow(PIPE_HandleTypeDef *pipe);
+void PIPE_Block(PIPE_HandleTypeDef *pipe, const uint16_t *data, uint16_t length, uint8_t channels);
+void PIPE_Release(PIPE_HandleTypeDef *pipe, uint8_t valid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PIPELINE_H */
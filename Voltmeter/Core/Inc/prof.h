@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file           : prof.h
+  * @brief          : Header for prof.c file.
+  *                   DWT cycle profiling of named code regions: count,
+  *                   min, max and mean cycles, dumped with the PROF command.
+  *                   Compiled out unless PROF_ENABLE is 1 (default: on in
+  *                   the Debug configuration, off in Release).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PROF_H
+#define __PROF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "cycle.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef PROF_ENABLE
+#ifdef DEBUG
+#define PROF_ENABLE            1
+#else
+#define PROF_ENABLE            0
+#endif
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Profiled regions, see prof_names in prof.c
+  */
+typedef enum
+{
+  PROF_DMA_IRQ = 0U,           /*!< DMA1_Channel1_IRQHandler, ADC block done   */
+  PROF_ADC_CALLBACK,           /*!< HAL_ADC_Conv(Half)CpltCallback             */
+  PROF_BLOCK,                  /*!< One block in the main loop, all stages and
+                                    releases, without the report            */
+  PROF_PIPELINE,               /*!< PIPE_Block                                 */
+  PROF_STREAM,                 /*!< STREAM_Encode                              */
+  PROF_CAPTURE,                /*!< CAP_Block                                  */
+  PROF_LOG,                    /*!< LOG_Block                                  */
+  PROF_SPECTRUM,               /*!< SPEC_Block                                 */
+  PROF_AVERAGE,                /*!< MAVG_Block                                 */
+  PROF_RELEASE,                /*!< ACQ_ReleaseBlock and the stage releases    */
+  PROF_REPORT,                 /*!< Formatting and queueing one report         */
+  PROF_FFT,                    /*!< SPEC_Process with a complete record        */
+  PROF_FLASH,                  /*!< LOG_Process, a page erase stalls the core  */
+  PROF_COMMAND,                /*!< CMD_Process                                */
+  PROF_REGION_COUNT
+} PROF_RegionTypeDef;
+
+/**
+  * @brief  Cycle statistics of one region
+  */
+typedef struct
+{
+  uint32_t count;              /*!< Completed passes                           */
+  uint32_t min;                /*!< Shortest pass, cycles                      */
+  uint32_t max;                /*!< Longest pass, cycles                       */
+  uint64_t total;              /*!< Sum of all passes, cycles                  */
+} PROF_StatsTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+/* PROF_BEGIN/PROF_END enclose a region in one block scope; the start count
+   lives in a local variable named after the region. The cost of the pair
+   itself is measured by PROF_Init() and subtracted. */
+#if PROF_ENABLE
+#define PROF_BEGIN(region)     uint32_t prof_start_##region = CYCLE_Now()
+#define PROF_END(region)       PROF_Record((region), CYCLE_Now() - prof_start_##region)
+#else
+#define PROF_BEGIN(region)     ((void)0)
+#define PROF_END(region)       ((void)0)
+#endif
+
+/* Exported functions prototypes ---------------------------------------------*/
+void PROF_Init(void);
+void PROF_Reset(void);
+void PROF_Record(PROF_RegionTypeDef region, uint32_t cycles);
+void PROF_Get(PROF_RegionTypeDef region, PROF_StatsTypeDef *stats);
+const char *PROF_Name(PROF_RegionTypeDef region);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PROF_H */
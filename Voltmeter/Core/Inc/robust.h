@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file           : robust.h
+  * @brief          : Header for robust.c file.
+  *                   Spike-rejecting median and trimmed mean of N consecutive
+  *                   samples per channel, sorted by compare-exchange networks.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ROBUST_H
+#define __ROBUST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "stats.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Scan positions that can have a window, counted from the start of the
+   scan list; each one takes 2 * ROB_MAX_WINDOW + 4 bytes of RAM */
+#ifndef ROB_MAX_CHANNELS
+#define ROB_MAX_CHANNELS       2U
+#endif
+/* Window lengths with a sorting network: 8, 16 or 32 samples */
+#define ROB_MAX_WINDOW         32U
+#define ROB_DEFAULT_WINDOW     16U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Estimate taken from each window
+  */
+typedef enum
+{
+  ROB_MODE_NONE = 0U,          /*!< Stage off, plain mean of the samples      */
+  ROB_MODE_MEDIAN,             /*!< Median (mean of the two middle values)    */
+  ROB_MODE_TRIMMED,            /*!< Mean of the middle half (N/4 dropped at
+                                    either end)                              */
+  ROB_MODE_COUNT
+} ROB_ModeTypeDef;
+
+/**
+  * @brief  Setting of one channel
+  */
+typedef struct
+{
+  ROB_ModeTypeDef mode;
+  uint8_t window;              /*!< 8, 16 or 32; ignored for ROB_MODE_NONE    */
+} ROB_ConfigTypeDef;
+
+/**
+  * @brief  Window being collected for one channel
+  */
+typedef struct
+{
+  ROB_ModeTypeDef mode;
+  uint8_t window;              /*!< Samples per estimate                      */
+  uint8_t fill;                /*!< Samples collected so far                  */
+  uint16_t buffer[ROB_MAX_WINDOW];
+} ROB_ChannelTypeDef;
+
+/**
+  * @brief  Robust stage for interleaved multi-channel blocks
+  */
+typedef struct
+{
+  uint8_t channels;            /*!< Interleave stride of the input blocks     */
+  uint8_t active;              /*!< Channels with a mode other than NONE      */
+  ROB_ChannelTypeDef channel[ROB_MAX_CHANNELS];
+} ROB_HandleTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+#define IS_ROB_WINDOW(n)       (((n) == 8U) || ((n) == 16U) || ((n) == 32U))
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint8_t ROB_SetChannel(ROB_HandleTypeDef *rob, uint8_t rank, ROB_ModeTypeDef mode, uint8_t window);
+void ROB_Reset(ROB_HandleTypeDef *rob);
+void ROB_Block(ROB_HandleTypeDef *rob, const uint16_t *data, uint16_t length,
+               uint8_t channels, STATS_ChannelTypeDef *stats);
+void ROB_Sort(uint16_t *values, uint8_t count);
+uint16_t ROB_Estimate(uint16_t *values, uint8_t count, ROB_ModeTypeDef mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ROBUST_H */
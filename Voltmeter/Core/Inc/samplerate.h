@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file           : samplerate.h
+  * @brief          : Header for samplerate.c file.
+  *                   Timer-driven ADC sample rate engine (TIM2 CC2 trigger).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SAMPLERATE_H
+#define __SAMPLERATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define SRATE_MIN_HZ           1U
+/* Absolute ADC limit of the F103: 14 MHz ADC clock / 14 cycles. The limit
+   for the running clock tree is returned by SRATE_GetMaxRate(). */
+#define SRATE_MAX_HZ           1000000U
+
+/* Exported functions prototypes ---------------------------------------------*/
+void SRATE_Init(TIM_HandleTypeDef *htim, ADC_HandleTypeDef *hadc, ADC_HandleTypeDef *hadc_slave);
+HAL_StatusTypeDef SRATE_SetRate(uint32_t rate_hz);
+HAL_StatusTypeDef SRATE_SetConversions(uint8_t conversions);
+HAL_StatusTypeDef SRATE_Refresh(void);
+uint32_t SRATE_GetRate(void);
+uint32_t SRATE_GetActualRateMilliHz(void);
+uint32_t SRATE_GetMaxRate(void);
+uint32_t SRATE_GetSampleTime(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SAMPLERATE_H */
@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file           : sched.h
+  * @brief          : Header for sched.c file.
+  *                   Event-driven main loop: the interrupts post events, the
+  *                   loop sleeps (WFI) while none is pending.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SCHED_H
+#define __SCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define SCHED_EVENT_BLOCK      0x01U  /*!< DMA half-buffer ready          */
+#define SCHED_EVENT_UART_TX    0x02U  /*!< TX DMA done, ring has room     */
+#define SCHED_EVENT_ALARM      0x04U  /*!< Analog watchdog event latched  */
+#define SCHED_EVENT_COMMAND    0x08U  /*!< Bytes received on USART1 RX    */
+#define SCHED_EVENT_INJECTED   0x10U  /*!< Injected conversion finished   */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  CPU time split since the previous SCHED_GetLoad() call
+  */
+typedef struct
+{
+  uint32_t awake_cycles;   /*!< Cycles spent running (DWT)                   */
+  uint32_t sleep_cycles;   /*!< Cycles spent in WFI                          */
+  uint16_t load;           /*!< awake / total in 1/100 %                     */
+} SCHED_LoadTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void SCHED_Init(void);
+void SCHED_Post(uint32_t events);
+uint32_t SCHED_Wait(void);
+void SCHED_GetLoad(SCHED_LoadTypeDef *load);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCHED_H */
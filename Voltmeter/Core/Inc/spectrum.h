@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum.h
+  * @brief          : Header for spectrum.c file.
+  *                   Q15 FFT of one channel: dominant frequency, amplitude,
+  *                   THD and noise floor.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SPECTRUM_H
+#define __SPECTRUM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "acquisition.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Record length, a power of two; the tables in spectrum_tables.h are built
+   for SPEC_MAX_POINTS */
+#define SPEC_MIN_POINTS        256U
+#define SPEC_MAX_POINTS        1024U
+/* uint16_t values lent by SPEC_GetWorkspace() */
+#define SPEC_WORKSPACE_SIZE    SPEC_MAX_POINTS
+
+/* Harmonics 2..SPEC_HARMONICS count into the THD */
+#define SPEC_HARMONICS         9U
+/* Bins on each side of a peak that belong to it (Hann main lobe) */
+#define SPEC_LOBE_BINS         2U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Analysis of one record
+  */
+typedef struct
+{
+  uint32_t frequency_mhz;  /*!< Strongest component, interpolated between bins */
+  uint32_t rms_q8;         /*!< Its RMS in ADC counts, 8 fractional bits       */
+  uint32_t thd_ppm;        /*!< Harmonics against the fundamental, RMS ratio   */
+  int32_t noise_dbfs_q8;   /*!< Mean of the other bins against a full-scale
+                                sine, dB in Q8 (per bin, so it drops 3 dB per
+                                doubling of points)                         */
+  uint32_t cycles;         /*!< CPU cycles of the transform and analysis       */
+  uint16_t points;         /*!< Record length                                  */
+  uint8_t channel;         /*!< ADC channel                                    */
+} SPEC_ResultTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef SPEC_Config(uint16_t points, uint8_t rank);
+void SPEC_Enable(uint8_t enable);
+uint8_t SPEC_IsEnabled(void);
+void SPEC_Block(const ACQ_BlockTypeDef *block);
+void SPEC_Release(uint8_t valid);
+uint8_t SPEC_Process(void);
+uint8_t SPEC_GetResult(SPEC_ResultTypeDef *result);
+uint16_t *SPEC_GetWorkspace(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SPECTRUM_H */
@@ -0,0 +1,226 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum_tables.h
+  * @brief          : FFT tables for spectrum.c.
+  *                   Generated by Host/spectrum_tables.py, do not edit.
+  *
+  *                   Built for 1024 points; smaller transforms read them
+  *                   with a stride of SPEC_TABLE_POINTS / points.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SPECTRUM_TABLES_H
+#define __SPECTRUM_TABLES_H
+
+#define SPEC_TABLE_POINTS      1024U
+
+/* sin(2 pi i / SPEC_TABLE_POINTS) in Q15, i < 3/4 SPEC_TABLE_POINTS */
+static const int16_t spec_sine[] =
+{
+       0,    201,    402,    603,    804,   1005,   1206,   1407,
+    1608,   1809,   2009,   2210,   2411,   2611,   2811,   3012,
+    3212,   3412,   3612,   3812,   4011,   4211,   4410,   4609,
+    4808,   5007,   5205,   5404,   5602,   5800,   5998,   6195,
+    6393,   6590,   6787,   6983,   7180,   7376,   7571,   7767,
+    7962,   8157,   8351,   8546,   8740,   8933,   9127,   9319,
+    9512,   9704,   9896,  10088,  10279,  10469,  10660,  10850,
+   11039,  11228,  11417,  11605,  11793,  11980,  12167,  12354,
+   12540,  12725,  12910,  13095,  13279,  13463,  13646,  13828,
+   14010,  14192,  14373,  14553,  14733,  14912,  15091,  15269,
+   15447,  15624,  15800,  15976,  16151,  16326,  16500,  16673,
+   16846,  17018,  17190,  17361,  17531,  17700,  17869,  18037,
+   18205,  18372,  18538,  18703,  18868,  19032,  19195,  19358,
+   19520,  19681,  19841,  20001,  20160,  20318,  20475,  20632,
+   20788,  20943,  21097,  21251,  21403,  21555,  21706,  21856,
+   22006,  22154,  22302,  22449,  22595,  22740,  22884,  23028,
+   23170,  23312,  23453,  23593,  23732,  23870,  24008,  24144,
+   24279,  24414,  24548,  24680,  24812,  24943,  25073,  25202,
+   25330,  25457,  25583,  25708,  25833,  25956,  26078,  26199,
+   26320,  26439,  26557,  26674,  26791,  26906,  27020,  27133,
+   27246,  27357,  27467,  27576,  27684,  27791,  27897,  28002,
+   28106,  28209,  28311,  28411,  28511,  28610,  28707,  28803,
+   28899,  28993,  29086,  29178,  29269,  29359,  29448,  29535,
+   29622,  29707,  29792,  29875,  29957,  30038,  30118,  30196,
+   30274,  30350,  30425,  30499,  30572,  30644,  30715,  30784,
+   30853,  30920,  30986,  31050,  31114,  31177,  31238,  31298,
+   31357,  31415,  31471,  31527,  31581,  31634,  31686,  31737,
+   31786,  31834,  31881,  31927,  31972,  32015,  32058,  32099,
+   32138,  32177,  32214,  32251,  32286,  32319,  32352,  32383,
+   32413,  32442,  32470,  32496,  32522,  32546,  32568,  32590,
+   32610,  32629,  32647,  32664,  32679,  32693,  32706,  32718,
+   32729,  32738,  32746,  32753,  32758,  32762,  32766,  32767,
+   32767,  32767,  32766,  32762,  32758,  32753,  32746,  32738,
+   32729,  32718,  32706,  32693,  32679,  32664,  32647,  32629,
+   32610,  32590,  32568,  32546,  32522,  32496,  32470,  32442,
+   32413,  32383,  32352,  32319,  32286,  32251,  32214,  32177,
+   32138,  32099,  32058,  32015,  31972,  31927,  31881,  31834,
+   31786,  31737,  31686,  31634,  31581,  31527,  31471,  31415,
+   31357,  31298,  31238,  31177,  31114,  31050,  30986,  30920,
+   30853,  30784,  30715,  30644,  30572,  30499,  30425,  30350,
+   30274,  30196,  30118,  30038,  29957,  29875,  29792,  29707,
+   29622,  29535,  29448,  29359,  29269,  29178,  29086,  28993,
+   28899,  28803,  28707,  28610,  28511,  28411,  28311,  28209,
+   28106,  28002,  27897,  27791,  27684,  27576,  27467,  27357,
+   27246,  27133,  27020,  26906,  26791,  26674,  26557,  26439,
+   26320,  26199,  26078,  25956,  25833,  25708,  25583,  25457,
+   25330,  25202,  25073,  24943,  24812,  24680,  24548,  24414,
+   24279,  24144,  24008,  23870,  23732,  23593,  23453,  23312,
+   23170,  23028,  22884,  22740,  22595,  22449,  22302,  22154,
+   22006,  21856,  21706,  21555,  21403,  21251,  21097,  20943,
+   20788,  20632,  20475,  20318,  20160,  20001,  19841,  19681,
+   19520,  19358,  19195,  19032,  18868,  18703,  18538,  18372,
+   18205,  18037,  17869,  17700,  17531,  17361,  17190,  17018,
+   16846,  16673,  16500,  16326,  16151,  15976,  15800,  15624,
+   15447,  15269,  15091,  14912,  14733,  14553,  14373,  14192,
+   14010,  13828,  13646,  13463,  13279,  13095,  12910,  12725,
+   12540,  12354,  12167,  11980,  11793,  11605,  11417,  11228,
+   11039,  10850,  10660,  10469,  10279,  10088,   9896,   9704,
+    9512,   9319,   9127,   8933,   8740,   8546,   8351,   8157,
+    7962,   7767,   7571,   7376,   7180,   6983,   6787,   6590,
+    6393,   6195,   5998,   5800,   5602,   5404,   5205,   5007,
+    4808,   4609,   4410,   4211,   4011,   3812,   3612,   3412,
+    3212,   3012,   2811,   2611,   2411,   2210,   2009,   1809,
+    1608,   1407,   1206,   1005,    804,    603,    402,    201,
+       0,   -201,   -402,   -603,   -804,  -1005,  -1206,  -1407,
+   -1608,  -1809,  -2009,  -2210,  -2411,  -2611,  -2811,  -3012,
+   -3212,  -3412,  -3612,  -3812,  -4011,  -4211,  -4410,  -4609,
+   -4808,  -5007,  -5205,  -5404,  -5602,  -5800,  -5998,  -6195,
+   -6393,  -6590,  -6787,  -6983,  -7180,  -7376,  -7571,  -7767,
+   -7962,  -8157,  -8351,  -8546,  -8740,  -8933,  -9127,  -9319,
+   -9512,  -9704,  -9896, -10088, -10279, -10469, -10660, -10850,
+  -11039, -11228, -11417, -11605, -11793, -11980, -12167, -12354,
+  -12540, -12725, -12910, -13095, -13279, -13463, -13646, -13828,
+  -14010, -14192, -14373, -14553, -14733, -14912, -15091, -15269,
+  -15447, -15624, -15800, -15976, -16151, -16326, -16500, -16673,
+  -16846, -17018, -17190, -17361, -17531, -17700, -17869, -18037,
+  -18205, -18372, -18538, -18703, -18868, -19032, -19195, -19358,
+  -19520, -19681, -19841, -20001, -20160, -20318, -20475, -20632,
+  -20788, -20943, -21097, -21251, -21403, -21555, -21706, -21856,
+  -22006, -22154, -22302, -22449, -22595, -22740, -22884, -23028,
+  -23170, -23312, -23453, -23593, -23732, -23870, -24008, -24144,
+  -24279, -24414, -24548, -24680, -24812, -24943, -25073, -25202,
+  -25330, -25457, -25583, -25708, -25833, -25956, -26078, -26199,
+  -26320, -26439, -26557, -26674, -26791, -26906, -27020, -27133,
+  -27246, -27357, -27467, -27576, -27684, -27791, -27897, -28002,
+  -28106, -28209, -28311, -28411, -28511, -28610, -28707, -28803,
+  -28899, -28993, -29086, -29178, -29269, -29359, -29448, -29535,
+  -29622, -29707, -29792, -29875, -29957, -30038, -30118, -30196,
+  -30274, -30350, -30425, -30499, -30572, -30644, -30715, -30784,
+  -30853, -30920, -30986, -31050, -31114, -31177, -31238, -31298,
+  -31357, -31415, -31471, -31527, -31581, -31634, -31686, -31737,
+  -31786, -31834, -31881, -31927, -31972, -32015, -32058, -32099,
+  -32138, -32177, -32214, -32251, -32286, -32319, -32352, -32383,
+  -32413, -32442, -32470, -32496, -32522, -32546, -32568, -32590,
+  -32610, -32629, -32647, -32664, -32679, -32693, -32706, -32718,
+  -32729, -32738, -32746, -32753, -32758, -32762, -32766, -32767,
+};
+
+/* Bit-reversed index of the SPEC_TABLE_POINTS / 2 complex FFT */
+static const uint16_t spec_bitrev[] =
+{
+    0, 256, 128, 384,  64, 320, 192, 448,  32, 288, 160, 416,  96, 352, 224, 480,
+   16, 272, 144, 400,  80, 336, 208, 464,  48, 304, 176, 432, 112, 368, 240, 496,
+    8, 264, 136, 392,  72, 328, 200, 456,  40, 296, 168, 424, 104, 360, 232, 488,
+   24, 280, 152, 408,  88, 344, 216, 472,  56, 312, 184, 440, 120, 376, 248, 504,
+    4, 260, 132, 388,  68, 324, 196, 452,  36, 292, 164, 420, 100, 356, 228, 484,
+   20, 276, 148, 404,  84, 340, 212, 468,  52, 308, 180, 436, 116, 372, 244, 500,
+   12, 268, 140, 396,  76, 332, 204, 460,  44, 300, 172, 428, 108, 364, 236, 492,
+   28, 284, 156, 412,  92, 348, 220, 476,  60, 316, 188, 444, 124, 380, 252, 508,
+    2, 258, 130, 386,  66, 322, 194, 450,  34, 290, 162, 418,  98, 354, 226, 482,
+   18, 274, 146, 402,  82, 338, 210, 466,  50, 306, 178, 434, 114, 370, 242, 498,
+   10, 266, 138, 394,  74, 330, 202, 458,  42, 298, 170, 426, 106, 362, 234, 490,
+   26, 282, 154, 410,  90, 346, 218, 474,  58, 314, 186, 442, 122, 378, 250, 506,
+    6, 262, 134, 390,  70, 326, 198, 454,  38, 294, 166, 422, 102, 358, 230, 486,
+   22, 278, 150, 406,  86, 342, 214, 470,  54, 310, 182, 438, 118, 374, 246, 502,
+   14, 270, 142, 398,  78, 334, 206, 462,  46, 302, 174, 430, 110, 366, 238, 494,
+   30, 286, 158, 414,  94, 350, 222, 478,  62, 318, 190, 446, 126, 382, 254, 510,
+    1, 257, 129, 385,  65, 321, 193, 449,  33, 289, 161, 417,  97, 353, 225, 481,
+   17, 273, 145, 401,  81, 337, 209, 465,  49, 305, 177, 433, 113, 369, 241, 497,
+    9, 265, 137, 393,  73, 329, 201, 457,  41, 297, 169, 425, 105, 361, 233, 489,
+   25, 281, 153, 409,  89, 345, 217, 473,  57, 313, 185, 441, 121, 377, 249, 505,
+    5, 261, 133, 389,  69, 325, 197, 453,  37, 293, 165, 421, 101, 357, 229, 485,
+   21, 277, 149, 405,  85, 341, 213, 469,  53, 309, 181, 437, 117, 373, 245, 501,
+   13, 269, 141, 397,  77, 333, 205, 461,  45, 301, 173, 429, 109, 365, 237, 493,
+   29, 285, 157, 413,  93, 349, 221, 477,  61, 317, 189, 445, 125, 381, 253, 509,
+    3, 259, 131, 387,  67, 323, 195, 451,  35, 291, 163, 419,  99, 355, 227, 483,
+   19, 275, 147, 403,  83, 339, 211, 467,  51, 307, 179, 435, 115, 371, 243, 499,
+   11, 267, 139, 395,  75, 331, 203, 459,  43, 299, 171, 427, 107, 363, 235, 491,
+   27, 283, 155, 411,  91, 347, 219, 475,  59, 315, 187, 443, 123, 379, 251, 507,
+    7, 263, 135, 391,  71, 327, 199, 455,  39, 295, 167, 423, 103, 359, 231, 487,
+   23, 279, 151, 407,  87, 343, 215, 471,  55, 311, 183, 439, 119, 375, 247, 503,
+   15, 271, 143, 399,  79, 335, 207, 463,  47, 303, 175, 431, 111, 367, 239, 495,
+   31, 287, 159, 415,  95, 351, 223, 479,  63, 319, 191, 447, 127, 383, 255, 511,
+};
+
+/* Periodic Hann window in Q15, first SPEC_TABLE_POINTS / 2 + 1 points */
+static const int16_t spec_hann[] =
+{
+       0,      0,      1,      3,      5,      8,     11,     15,
+      20,     25,     31,     37,     44,     52,     60,     69,
+      79,     89,    100,    111,    123,    136,    149,    163,
+     177,    192,    208,    224,    241,    259,    277,    296,
+     315,    335,    355,    376,    398,    420,    443,    467,
+     491,    516,    541,    567,    593,    621,    648,    677,
+     705,    735,    765,    796,    827,    859,    891,    924,
+     958,    992,   1027,   1062,   1098,   1134,   1171,   1209,
+    1247,   1286,   1325,   1365,   1406,   1447,   1488,   1530,
+    1573,   1616,   1660,   1704,   1749,   1795,   1841,   1887,
+    1935,   1982,   2030,   2079,   2128,   2178,   2229,   2280,
+    2331,   2383,   2435,   2488,   2542,   2596,   2651,   2706,
+    2761,   2817,   2874,   2931,   2989,   3047,   3105,   3165,
+    3224,   3284,   3345,   3406,   3468,   3530,   3592,   3655,
+    3719,   3783,   3847,   3912,   3978,   4044,   4110,   4177,
+    4244,   4312,   4380,   4449,   4518,   4587,   4657,   4728,
+    4799,   4870,   4942,   5014,   5087,   5160,   5233,   5307,
+    5381,   5456,   5531,   5606,   5682,   5759,   5835,   5913,
+    5990,   6068,   6146,   6225,   6304,   6383,   6463,   6543,
+    6624,   6705,   6786,   6868,   6950,   7032,   7115,   7198,
+    7282,   7365,   7449,   7534,   7619,   7704,   7789,   7875,
+    7961,   8047,   8134,   8221,   8308,   8396,   8484,   8572,
+    8661,   8749,   8839,   8928,   9018,   9108,   9198,   9288,
+    9379,   9470,   9561,   9653,   9745,   9837,   9929,  10021,
+   10114,  10207,  10300,  10394,  10487,  10581,  10676,  10770,
+   10864,  10959,  11054,  11149,  11245,  11340,  11436,  11532,
+   11628,  11724,  11821,  11917,  12014,  12111,  12208,  12306,
+   12403,  12501,  12598,  12696,  12794,  12892,  12991,  13089,
+   13188,  13286,  13385,  13484,  13583,  13682,  13781,  13881,
+   13980,  14079,  14179,  14279,  14378,  14478,  14578,  14678,
+   14778,  14878,  14978,  15078,  15179,  15279,  15379,  15480,
+   15580,  15680,  15781,  15881,  15982,  16082,  16183,  16283,
+   16384,  16485,  16585,  16686,  16786,  16887,  16987,  17088,
+   17188,  17288,  17389,  17489,  17589,  17690,  17790,  17890,
+   17990,  18090,  18190,  18290,  18390,  18489,  18589,  18689,
+   18788,  18887,  18987,  19086,  19185,  19284,  19383,  19482,
+   19580,  19679,  19777,  19876,  19974,  20072,  20170,  20267,
+   20365,  20462,  20560,  20657,  20754,  20851,  20947,  21044,
+   21140,  21236,  21332,  21428,  21523,  21619,  21714,  21809,
+   21904,  21998,  22092,  22187,  22281,  22374,  22468,  22561,
+   22654,  22747,  22839,  22931,  23023,  23115,  23207,  23298,
+   23389,  23480,  23570,  23660,  23750,  23840,  23929,  24019,
+   24107,  24196,  24284,  24372,  24460,  24547,  24634,  24721,
+   24807,  24893,  24979,  25064,  25149,  25234,  25319,  25403,
+   25486,  25570,  25653,  25736,  25818,  25900,  25982,  26063,
+   26144,  26225,  26305,  26385,  26464,  26543,  26622,  26700,
+   26778,  26855,  26933,  27009,  27086,  27162,  27237,  27312,
+   27387,  27461,  27535,  27608,  27681,  27754,  27826,  27898,
+   27969,  28040,  28111,  28181,  28250,  28319,  28388,  28456,
+   28524,  28591,  28658,  28724,  28790,  28856,  28921,  28985,
+   29049,  29113,  29176,  29238,  29300,  29362,  29423,  29484,
+   29544,  29603,  29663,  29721,  29779,  29837,  29894,  29951,
+   30007,  30062,  30117,  30172,  30226,  30280,  30333,  30385,
+   30437,  30488,  30539,  30590,  30640,  30689,  30738,  30786,
+   30833,  30881,  30927,  30973,  31019,  31064,  31108,  31152,
+   31195,  31238,  31280,  31321,  31362,  31403,  31443,  31482,
+   31521,  31559,  31597,  31634,  31670,  31706,  31741,  31776,
+   31810,  31844,  31877,  31909,  31941,  31972,  32003,  32033,
+   32063,  32091,  32120,  32147,  32175,  32201,  32227,  32252,
+   32277,  32301,  32325,  32348,  32370,  32392,  32413,  32433,
+   32453,  32472,  32491,  32509,  32527,  32544,  32560,  32576,
+   32591,  32605,  32619,  32632,  32645,  32657,  32668,  32679,
+   32689,  32699,  32708,  32716,  32724,  32731,  32737,  32743,
+   32748,  32753,  32757,  32760,  32763,  32765,  32767,  32767,
+   32767,
+};
+
+#endif /* __SPECTRUM_TABLES_H */
@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file           : stats.h
+  * @brief          : Header for stats.c file.
+  *                   Per-channel running statistics over interleaved blocks.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STATS_H
+#define __STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Running mean/min/max of one channel
+  */
+typedef struct
+{
+  uint64_t sum;            /*!< Sum of all samples since the last reset */
+  uint32_t count;          /*!< Number of samples in sum                */
+  uint16_t min;            /*!< Smallest sample                         */
+  uint16_t max;            /*!< Largest sample                          */
+} STATS_ChannelTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void STATS_Reset(STATS_ChannelTypeDef *stats, uint8_t channels);
+void STATS_Block(STATS_ChannelTypeDef *stats, const uint16_t *data,
+                 uint16_t length, uint8_t channels);
+void STATS_Merge(STATS_ChannelTypeDef *total, const STATS_ChannelTypeDef *block,
+                 uint8_t channels);
+uint16_t STATS_Mean(const STATS_ChannelTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STATS_H */
@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file           : stream.h
+  * @brief          : Header for stream.c file.
+  *                   Raw sample streaming: every acquisition block is sent
+  *                   as one binary frame (stream_frame.h) over the TX ring.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STREAM_H
+#define __STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "acquisition.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Streaming counters
+  */
+typedef struct
+{
+  uint32_t frames_sent;    /*!< Frames queued on the UART                   */
+  uint32_t frames_dropped; /*!< Frames the TX ring had no room for          */
+  uint32_t frames_torn;    /*!< Blocks overwritten by the DMA while encoded */
+} STREAM_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void STREAM_Enable(uint8_t enable);
+uint8_t STREAM_IsEnabled(void);
+uint16_t STREAM_Encode(const ACQ_BlockTypeDef *block);
+void STREAM_Send(uint8_t valid);
+void STREAM_GetStats(STREAM_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STREAM_H */
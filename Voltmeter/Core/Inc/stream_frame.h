@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+  * @file           : stream_frame.h
+  * @brief          : Header for stream_frame.c file.
+  *                   Binary sample frame format shared by the firmware and
+  *                   the host decoder (Host/stream_decode.c).
+  *
+  *                   Frame before COBS stuffing, multi-byte fields are
+  *                   little-endian:
+  *
+  *                     0  u8   type (SFRAME_TYPE_x)
+  *                     1  u8   channels in the block, N
+  *                     2  u16  sample count, all channels, rank order
+  *                     4  u32  SAMPLES: block sequence number
+  *                             CAPTURE: int32 offset of the first scan from
+  *                             the trigger scan, negative before it
+  *                             LOG: HAL tick (ms) of the first scan
+  *                     8  u32  per-channel sample rate in mHz
+  *                    12  u8   ADC channel numbers [N]
+  *                  12+N  ...  samples, 12-bit packed two per three bytes
+  *                   end  u16  CRC-16/CCITT-FALSE of all bytes above
+  *
+  *                   The stuffed frame is followed by one 0x00 delimiter.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STREAM_FRAME_H
+#define __STREAM_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define SFRAME_TYPE_SAMPLES    0x01U
+/* Part of a triggered record (capture.c) */
+#define SFRAME_TYPE_CAPTURE    0x02U
+/* Scans read back from the flash log (datalog.c) */
+#define SFRAME_TYPE_LOG        0x03U
+
+#define SFRAME_MAX_CHANNELS    12U
+#define SFRAME_MAX_SAMPLES     192U
+
+#define SFRAME_HEADER_SIZE     12U
+#define SFRAME_CRC_SIZE        2U
+
+/* Bytes taken by n packed samples, an odd last sample takes two bytes */
+#define SFRAME_PACKED_SIZE(n)  ((((n) * 3U) + 1U) / 2U)
+/* Worst-case COBS output for n input bytes */
+#define SFRAME_COBS_SIZE(n)    ((n) + ((n) / 254U) + 1U)
+
+#define SFRAME_RAW_MAX         (SFRAME_HEADER_SIZE + SFRAME_MAX_CHANNELS + \
+                                SFRAME_PACKED_SIZE(SFRAME_MAX_SAMPLES) + SFRAME_CRC_SIZE)
+/* Stuffed frame including the delimiter */
+#define SFRAME_ENCODED_MAX     (SFRAME_COBS_SIZE(SFRAME_RAW_MAX) + 1U)
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Frame header fields
+  */
+typedef struct
+{
+  uint8_t type;            /*!< SFRAME_TYPE_x                                */
+  uint8_t channels;        /*!< Interleaved channels, 1..SFRAME_MAX_CHANNELS */
+  uint16_t samples;        /*!< Samples in the frame, all channels           */
+  uint32_t sequence;       /*!< Block number, gaps mean lost blocks; scan
+                                offset from the trigger in capture frames,
+                                tick (ms) of the first scan in log frames   */
+  uint32_t rate_mhz;       /*!< Per-channel sample rate in mHz               */
+} SFRAME_HeaderTypeDef;
+
+/**
+  * @brief  Decoder result
+  */
+typedef enum
+{
+  SFRAME_OK = 0U,
+  SFRAME_ERR_COBS,         /*!< Byte stuffing broken                         */
+  SFRAME_ERR_LENGTH,       /*!< Size does not match the header               */
+  SFRAME_ERR_CRC           /*!< Checksum mismatch                            */
+} SFRAME_StatusTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint16_t SFRAME_Crc16(const uint8_t *data, uint16_t length);
+uint16_t SFRAME_Pack12(uint8_t *dst, const uint16_t *samples, uint16_t count);
+void SFRAME_Unpack12(uint16_t *samples, const uint8_t *src, uint16_t count);
+uint16_t SFRAME_CobsEncode(uint8_t *dst, const uint8_t *src, uint16_t length);
+uint16_t SFRAME_CobsDecode(uint8_t *dst, const uint8_t *src, uint16_t length);
+
+uint16_t SFRAME_Encode(uint8_t *dst, uint8_t *raw, const SFRAME_HeaderTypeDef *header,
+                       const uint8_t *channel_list, const uint16_t *samples);
+SFRAME_StatusTypeDef SFRAME_Decode(const uint8_t *src, uint16_t length, uint8_t *raw,
+                                   SFRAME_HeaderTypeDef *header, uint8_t *channel_list,
+                                   uint16_t *samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STREAM_FRAME_H */
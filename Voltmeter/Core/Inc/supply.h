@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file           : supply.h
+  * @brief          : Header for supply.c file.
+  *                   VDDA estimate from periodic injected conversions of the
+  *                   internal reference (Vrefint) for ratiometric correction.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SUPPLY_H
+#define __SUPPLY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Vrefint of the F103 is 1.16..1.24 V (datasheet), 1.20 V typical and not
+   factory calibrated: measure VDDA once and build with
+   -DSUP_VREFINT_UV=<VDDA * reading / 4095 in uV> */
+#ifndef SUP_VREFINT_UV
+#define SUP_VREFINT_UV         1200000U
+#endif
+#define SUP_PERIOD_MS          100U
+/* Exponential smoothing of the Vrefint readings, weight 1 / 2^n */
+#define SUP_FILTER_SHIFT       3U
+/* Readings outside of VDDA = 2.0 .. 3.6 V are discarded */
+#define SUP_VDDA_MIN_UV        2000000U
+#define SUP_VDDA_MAX_UV        3600000U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Supply monitor counters
+  */
+typedef struct
+{
+  uint32_t conversions;    /*!< Vrefint readings taken                       */
+  uint32_t rejected;       /*!< Readings outside the plausible VDDA range    */
+  uint32_t skipped;        /*!< Periods without a reading (dual modes)       */
+} SUP_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void SUP_Enable(uint8_t enable);
+void SUP_Process(void);
+uint32_t SUP_GetMicrovolts(void);
+void SUP_GetStats(SUP_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SUPPLY_H */
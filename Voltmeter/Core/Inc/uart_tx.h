@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file           : uart_tx.h
+  * @brief          : Header for uart_tx.c file.
+  *                   Non-blocking UART transmit through a ring buffer drained
+  *                   by the USART1 TX DMA channel.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __UART_TX_H
+#define __UART_TX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Ring size in bytes, must be a power of two. Holds six full stream
+   frames; one second of text reports at 115200 baud is well below it. */
+#define UTX_BUFFER_SIZE        2048U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Transmit overflow accounting
+  */
+typedef struct
+{
+  uint32_t dropped_writes; /*!< UTX_Write() calls rejected for lack of room */
+  uint32_t dropped_bytes;  /*!< Bytes of those writes and of failed DMA chunks */
+  uint16_t high_water;     /*!< Highest ring fill level seen, in bytes       */
+} UTX_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void UTX_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef UTX_Write(const void *data, uint16_t length);
+uint16_t UTX_GetFree(void);
+uint8_t UTX_IsIdle(void);
+void UTX_GetStats(UTX_StatsTypeDef *stats);
+
+/* Called from HAL_UART_TxCpltCallback / HAL_UART_ErrorCallback */
+void UTX_TxCpltHandler(void);
+void UTX_ErrorHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UART_TX_H */
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file           : voltage.h
+  * @brief          : Header for voltage.c file.
+  *                   Integer conversion of ADC counts to micro/millivolts.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __VOLTAGE_H
+#define __VOLTAGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define VOLT_VREF_UV           3300000U
+#define VOLT_ADC_MAX           4095U
+
+/* Microvolts per ADC count in Q22 at the nominal reference (about 806.0 uV),
+   folded by the compiler. 4095 * scale stays below 2^44, the product is
+   taken in 64 bits. VOLT_SetSupply() replaces it with the measured VDDA. */
+#define VOLT_SCALE_Q22         ((uint32_t)((((uint64_t)VOLT_VREF_UV << 22) + \
+                                            (VOLT_ADC_MAX / 2U)) / VOLT_ADC_MAX))
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t VOLT_ToMicrovolts(uint16_t raw);
+uint32_t VOLT_ToMillivolts(uint16_t raw);
+uint32_t VOLT_OversampledToMicrovolts(uint32_t value, uint8_t extra_bits);
+void VOLT_SetSupply(uint32_t vdda_uv);
+uint32_t VOLT_GetSupply(void);
+uint32_t VOLT_Compensate(uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VOLTAGE_H */
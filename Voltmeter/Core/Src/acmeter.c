@@ -0,0 +1,345 @@
+/**
+  ******************************************************************************
+  * @file           : acmeter.c
+  * @brief          : AC measurement: true RMS, peak-to-peak and frequency.
+  *
+  *                   Like stats.c, every block is reduced on its own
+  *                   (AC_Block) and merged into the window totals once the
+  *                   block is known to be intact (AC_Merge), so the cost per
+  *                   block does not depend on the window length. RMS comes
+  *                   from the integer sums of samples and squares, the square
+  *                   root is taken once per report.
+  *
+  *                   The frequency is counted from rising crossings of the
+  *                   previous window's mean with a hysteresis against noise.
+  *                   Each crossing is placed between its two samples by linear
+  *                   interpolation, and the frequency is the number of whole
+  *                   periods between the first and the last crossing divided
+  *                   by the time between them.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "acmeter.h"
+
+/* Private function prototypes -----------------------------------------------*/
+static void AC_Clear(AC_ChannelTypeDef *ac);
+
+/* Private user code ---------------------------------------------------------*/
+static void AC_Clear(AC_ChannelTypeDef *ac)
+{
+  ac->sum = 0U;
+  ac->sum_sq = 0U;
+  ac->count = 0U;
+  ac->min = UINT16_MAX;
+  ac->max = 0U;
+  ac->crossings = 0U;
+  ac->first_cross = 0U;
+  ac->last_cross = 0U;
+}
+
+/**
+  * @brief  Clears the accumulators and the crossing state
+  * @param  ac: array of channels entries
+  * @param  channels: number of channels
+  * @retval None
+  */
+void AC_Reset(AC_ChannelTypeDef *ac, uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    AC_Clear(&ac[ch]);
+    ac[ch].level = 0U;
+    ac[ch].hysteresis = AC_HYST_MIN;
+    ac[ch].prev = 0U;
+    ac[ch].flags = 0U;
+  }
+}
+
+/**
+  * @brief  Starts a new window; its crossing level is the mean of the last one
+  * @param  ac: array of channels entries (window totals)
+  * @param  channels: number of channels
+  * @retval None
+  */
+void AC_NextWindow(AC_ChannelTypeDef *ac, uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    if (ac[ch].count != 0U)
+    {
+      uint16_t hysteresis = (uint16_t)((ac[ch].max - ac[ch].min) / 8U);
+
+      ac[ch].level = (uint16_t)(ac[ch].sum / ac[ch].count);
+      ac[ch].hysteresis = (hysteresis > AC_HYST_MIN) ? hysteresis : AC_HYST_MIN;
+      ac[ch].flags |= AC_FLAG_LEVEL;
+    }
+    AC_Clear(&ac[ch]);
+  }
+}
+
+/**
+  * @brief  Reduces one interleaved block
+  * @param  block: array of channels entries, overwritten
+  * @param  window: running totals, provide the crossing state
+  * @param  data: interleaved samples
+  * @param  length: total number of samples, a multiple of channels
+  * @param  channels: interleave stride
+  * @retval None
+  */
+void AC_Block(AC_ChannelTypeDef *block, const AC_ChannelTypeDef *window,
+              const uint16_t *data, uint16_t length, uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    AC_ChannelTypeDef *acc = &block[ch];
+    uint32_t sum = 0U;
+    uint32_t sum_sq = 0U;
+    uint16_t min = UINT16_MAX;
+    uint16_t max = 0U;
+    uint32_t count = 0U;
+    uint16_t level;
+    uint16_t rearm;
+    uint16_t prev;
+    uint8_t flags = window[ch].flags;
+
+    /* 4095^2 * 192 samples still fits the 32-bit sums */
+    for (uint16_t i = ch; i < length; i += channels)
+    {
+      uint16_t sample = data[i];
+
+      sum += sample;
+      sum_sq += (uint32_t)sample * sample;
+      if (sample < min)
+      {
+        min = sample;
+      }
+      if (sample > max)
+      {
+        max = sample;
+      }
+      count++;
+    }
+
+    AC_Clear(acc);
+    acc->sum = sum;
+    acc->sum_sq = sum_sq;
+    acc->count = count;
+    acc->min = min;
+    acc->max = max;
+    if (count == 0U)
+    {
+      acc->level = window[ch].level;
+      acc->hysteresis = window[ch].hysteresis;
+      acc->prev = window[ch].prev;
+      acc->flags = flags;
+      continue;
+    }
+
+    if ((flags & AC_FLAG_LEVEL) != 0U)
+    {
+      acc->level = window[ch].level;
+      acc->hysteresis = window[ch].hysteresis;
+    }
+    else
+    {
+      /* No window yet: cross the mean of this block */
+      uint16_t hysteresis = (uint16_t)((max - min) / 8U);
+
+      acc->level = (uint16_t)(sum / count);
+      acc->hysteresis = (hysteresis > AC_HYST_MIN) ? hysteresis : AC_HYST_MIN;
+      flags |= AC_FLAG_LEVEL;
+    }
+    level = acc->level;
+    rearm = (level > acc->hysteresis) ? (uint16_t)(level - acc->hysteresis) : 0U;
+    prev = window[ch].prev;
+
+    /* Sample k of the block sits at (k + 1) in Q16, prev at 0 */
+    count = 0U;
+    for (uint16_t i = ch; i < length; i += channels)
+    {
+      uint16_t sample = data[i];
+
+      if (sample < rearm)
+      {
+        flags |= AC_FLAG_ARMED;
+      }
+      else if ((sample >= level) &&
+               ((flags & (AC_FLAG_ARMED | AC_FLAG_PREV)) == (AC_FLAG_ARMED | AC_FLAG_PREV)) &&
+               (prev < level))
+      {
+        uint64_t position = ((uint64_t)count << 16) +
+                            ((((uint32_t)(level - prev)) << 16) / (uint32_t)(sample - prev));
+
+        if (acc->crossings == 0U)
+        {
+          acc->first_cross = position;
+        }
+        acc->last_cross = position;
+        acc->crossings++;
+        flags &= (uint8_t)~AC_FLAG_ARMED;
+      }
+      prev = sample;
+      flags |= AC_FLAG_PREV;
+      count++;
+    }
+    acc->prev = prev;
+    acc->flags = flags;
+  }
+}
+
+/**
+  * @brief  Adds block results to the window totals
+  * @param  window: running totals
+  * @param  block: results of one block (AC_Block)
+  * @param  channels: number of channels
+  * @retval None
+  */
+void AC_Merge(AC_ChannelTypeDef *window, const AC_ChannelTypeDef *block, uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    AC_ChannelTypeDef *total = &window[ch];
+    const AC_ChannelTypeDef *part = &block[ch];
+    uint64_t offset = (uint64_t)total->count << 16;
+
+    if (part->crossings != 0U)
+    {
+      if (total->crossings == 0U)
+      {
+        total->first_cross = offset + part->first_cross;
+      }
+      total->last_cross = offset + part->last_cross;
+      total->crossings += part->crossings;
+    }
+    total->sum += part->sum;
+    total->sum_sq += part->sum_sq;
+    total->count += part->count;
+    if (part->min < total->min)
+    {
+      total->min = part->min;
+    }
+    if (part->max > total->max)
+    {
+      total->max = part->max;
+    }
+    total->level = part->level;
+    total->hysteresis = part->hysteresis;
+    total->prev = part->prev;
+    total->flags = part->flags;
+  }
+}
+
+/**
+  * @brief  Accounts for a block that was lost
+  * @note   Crossings may have been missed in the gap, so the frequency is
+  *         measured again from the next crossing on. The sums are unaffected.
+  * @param  window: running totals
+  * @param  channels: number of channels
+  * @retval None
+  */
+void AC_Skip(AC_ChannelTypeDef *window, uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    window[ch].crossings = 0U;
+    window[ch].first_cross = 0U;
+    window[ch].last_cross = 0U;
+    window[ch].flags &= (uint8_t)~(AC_FLAG_PREV | AC_FLAG_ARMED);
+  }
+}
+
+/**
+  * @brief  RMS of the window
+  * @param  ac: one channel
+  * @param  include_dc: 0 - AC component only, 1 - AC + DC
+  * @retval RMS in ADC counts, Q8
+  */
+uint32_t AC_RmsQ8(const AC_ChannelTypeDef *ac, uint8_t include_dc)
+{
+  uint64_t mean_sq_q16;
+  uint64_t mean_q8;
+
+  if (ac->count == 0U)
+  {
+    return 0U;
+  }
+  /* Divided before scaling: sum_sq << 16 would overflow from 2^48 on, about
+     16.8 M full-scale samples */
+  mean_sq_q16 = ((ac->sum_sq / ac->count) << 16) +
+                (((ac->sum_sq % ac->count) << 16) / ac->count);
+  if (include_dc != 0U)
+  {
+    return AC_Isqrt(mean_sq_q16);
+  }
+
+  mean_q8 = ((ac->sum / ac->count) << 8) + (((ac->sum % ac->count) << 8) / ac->count);
+  if ((mean_q8 * mean_q8) >= mean_sq_q16)
+  {
+    return 0U;
+  }
+  return AC_Isqrt(mean_sq_q16 - (mean_q8 * mean_q8));
+}
+
+/**
+  * @brief  Peak-to-peak amplitude of the window
+  * @param  ac: one channel
+  * @retval max - min in ADC counts
+  */
+uint16_t AC_PeakToPeak(const AC_ChannelTypeDef *ac)
+{
+  return (ac->count != 0U) ? (uint16_t)(ac->max - ac->min) : 0U;
+}
+
+/**
+  * @brief  Signal frequency from the crossings of the window
+  * @param  ac: one channel
+  * @param  rate_mhz: per-channel sample rate in mHz
+  * @retval Frequency in mHz, 0 with fewer than two crossings
+  */
+uint32_t AC_FrequencyMilliHz(const AC_ChannelTypeDef *ac, uint32_t rate_mhz)
+{
+  uint64_t span;
+
+  if (ac->crossings < 2U)
+  {
+    return 0U;
+  }
+  span = ac->last_cross - ac->first_cross;
+  if (span == 0U)
+  {
+    return 0U;
+  }
+  /* periods * rate / (span / 2^16) */
+  return (uint32_t)(((((uint64_t)(ac->crossings - 1U) * rate_mhz) << 16) + (span / 2U)) / span);
+}
+
+/**
+  * @brief  Integer square root
+  * @param  value: radicand
+  * @retval floor(sqrt(value))
+  */
+uint32_t AC_Isqrt(uint64_t value)
+{
+  uint64_t root = 0U;
+  uint64_t bit = 1ULL << 62;
+
+  while (bit > value)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0U)
+  {
+    if (value >= (root + bit))
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
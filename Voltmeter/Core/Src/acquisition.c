@@ -0,0 +1,532 @@
+/**
+  ******************************************************************************
+  * @file           : acquisition.c
+  * @brief          : Double-buffered (ping-pong) ADC acquisition.
+  *
+  *                   The ADC fills acq_buffer through a circular DMA channel.
+  *                   The half-transfer interrupt hands the first half to the
+  *                   main loop, the transfer-complete interrupt hands the
+  *                   second half. The consumer therefore always works on the
+  *                   half the DMA is not writing, as long as it finishes
+  *                   before the next block completes.
+  *
+  *                   With several channels in the list the ADC scans them in
+  *                   rank order on every trigger, so each block holds
+  *                   ACQ_SCANS_PER_HALF interleaved scans.
+  *
+  *                   In the dual modes ADC1 and ADC2 work as a pair and the
+  *                   DMA transfers one 32-bit word per conversion pair.
+  *
+  *                   Every block carries its sequence number and the DWT
+  *                   cycle count of its DMA interrupt. A block the consumer
+  *                   never saw is counted as missed, one the DMA overwrote
+  *                   during processing as torn; together with the longest
+  *                   interrupt-to-consumer latency this shows how close the
+  *                   main loop runs to losing samples.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "acquisition.h"
+#include "samplerate.h"
+#include "cycle.h"
+
+/* Private variables ---------------------------------------------------------*/
+/* Word aligned: in dual mode the DMA stores one 32-bit word per ADC pair */
+static uint16_t acq_buffer[ACQ_BUFFER_SIZE] __ALIGNED(4);
+static ADC_HandleTypeDef *acq_hadc = NULL;
+static ADC_HandleTypeDef *acq_hadc_slave = NULL;
+static ACQ_ModeTypeDef acq_mode = ACQ_MODE_INDEPENDENT;
+static uint8_t acq_channels[ACQ_MAX_CHANNELS] = { ADC_CHANNEL_0 };
+static uint8_t acq_channel_count = 1U;
+static uint16_t acq_half_length = ACQ_SCANS_PER_HALF;
+static uint8_t acq_running = 0U;
+
+/* Last completed block: (sequence << 1) | half. Written only by the DMA
+   interrupt, a single word so the main loop reads it without locking. */
+static volatile uint32_t acq_last = 0U;
+static uint32_t acq_consumed = 0U;
+/* DWT cycle count at the completion of each half, written before acq_last */
+static volatile uint32_t acq_stamp[2] = { 0U, 0U };
+static uint32_t acq_missed = 0U;
+static uint32_t acq_torn = 0U;
+static uint32_t acq_latency_max = 0U;
+
+/* Private function prototypes -----------------------------------------------*/
+static void ACQ_Complete(uint32_t half);
+static void ACQ_ConfigPin(uint8_t channel);
+static HAL_StatusTypeDef ACQ_ConfigAdc(ADC_HandleTypeDef *hadc, uint32_t trigger,
+                                       uint32_t continuous, uint8_t count);
+static HAL_StatusTypeDef ACQ_ConfigDma(uint32_t periph_align, uint32_t mem_align);
+static HAL_StatusTypeDef ACQ_ConfigMultiMode(uint32_t mode);
+
+/* Private user code ---------------------------------------------------------*/
+static void ACQ_Complete(uint32_t half)
+{
+  acq_stamp[half] = CYCLE_Now();
+  acq_last = ((acq_last & ~1U) + 2U) | half;
+}
+
+static void ACQ_ConfigPin(uint8_t channel)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+
+  /* IN0..IN7 are PA0..PA7, IN8/IN9 are PB0/PB1, the temperature sensor and
+     Vrefint have no pin */
+  if (channel <= ADC_CHANNEL_7)
+  {
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    GPIO_InitStruct.Pin = (uint32_t)GPIO_PIN_0 << channel;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+  }
+  else if (channel <= ADC_CHANNEL_9)
+  {
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    GPIO_InitStruct.Pin = (uint32_t)GPIO_PIN_0 << (channel - ADC_CHANNEL_8);
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+  }
+}
+
+static HAL_StatusTypeDef ACQ_ConfigAdc(ADC_HandleTypeDef *hadc, uint32_t trigger,
+                                       uint32_t continuous, uint8_t count)
+{
+  hadc->Init.ScanConvMode = (count > 1U) ? ADC_SCAN_ENABLE : ADC_SCAN_DISABLE;
+  hadc->Init.ContinuousConvMode = continuous;
+  hadc->Init.ExternalTrigConv = trigger;
+  hadc->Init.NbrOfConversion = count;
+  return HAL_ADC_Init(hadc);
+}
+
+static HAL_StatusTypeDef ACQ_ConfigDma(uint32_t periph_align, uint32_t mem_align)
+{
+  DMA_HandleTypeDef *hdma = acq_hadc->DMA_Handle;
+
+  if ((hdma->Init.PeriphDataAlignment == periph_align) &&
+      (hdma->Init.MemDataAlignment == mem_align))
+  {
+    return HAL_OK;
+  }
+  hdma->Init.PeriphDataAlignment = periph_align;
+  hdma->Init.MemDataAlignment = mem_align;
+  return HAL_DMA_Init(hdma);
+}
+
+static HAL_StatusTypeDef ACQ_ConfigMultiMode(uint32_t mode)
+{
+  ADC_MultiModeTypeDef multimode = {0};
+
+  /* The dual mode can only be changed with both ADCs disabled */
+  if (ADC_ConversionStop_Disable(acq_hadc) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  if ((acq_hadc_slave != NULL) && (ADC_ConversionStop_Disable(acq_hadc_slave) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  multimode.Mode = mode;
+  return HAL_ADCEx_MultiModeConfigChannel(acq_hadc, &multimode);
+}
+
+/**
+  * @brief  Binds the acquisition to the ADCs
+  * @param  hadc: master ADC (ADC1), already initialized and calibrated
+  * @param  hadc_slave: ADC2 for the dual modes, NULL if not used
+  * @retval HAL status
+  */
+HAL_StatusTypeDef ACQ_Init(ADC_HandleTypeDef *hadc, ADC_HandleTypeDef *hadc_slave)
+{
+  acq_hadc = hadc;
+  acq_hadc_slave = hadc_slave;
+  acq_running = 0U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Sets the regular channel list (independent mode, ADC1 only)
+  * @note   A running acquisition is stopped and restarted with the new list.
+  *         The trigger rate stays the same, so every channel is sampled at
+  *         the configured rate, or at the maximum while the scan does not
+  *         fit it (the configured rate returns with a shorter scan).
+  * @param  channels: ADC_CHANNEL_x numbers in conversion order, each at
+  *                   most once
+  * @param  count: 1..ACQ_MAX_CHANNELS
+  * @retval HAL status
+  */
+HAL_StatusTypeDef ACQ_ConfigChannels(const uint8_t *channels, uint8_t count)
+{
+  ADC_ChannelConfTypeDef sConfig = {0};
+  uint8_t running = acq_running;
+
+  if ((acq_hadc == NULL) || (count == 0U) || (count > ACQ_MAX_CHANNELS))
+  {
+    return HAL_ERROR;
+  }
+  for (uint8_t i = 0U; i < count; i++)
+  {
+    if (!IS_ACQ_CHANNEL(channels[i]))
+    {
+      return HAL_ERROR;
+    }
+    for (uint8_t j = 0U; j < i; j++)
+    {
+      if (channels[j] == channels[i])
+      {
+        return HAL_ERROR;
+      }
+    }
+  }
+
+  if (running != 0U)
+  {
+    (void)ACQ_Stop();
+  }
+
+  if ((ACQ_ConfigMultiMode(ADC_MODE_INDEPENDENT) != HAL_OK) ||
+      (ACQ_ConfigDma(DMA_PDATAALIGN_HALFWORD, DMA_MDATAALIGN_HALFWORD) != HAL_OK) ||
+      (ACQ_ConfigAdc(acq_hadc, ADC_EXTERNALTRIGCONV_T2_CC2, DISABLE, count) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+
+  for (uint8_t i = 0U; i < count; i++)
+  {
+    ACQ_ConfigPin(channels[i]);
+    sConfig.Channel = channels[i];
+    sConfig.Rank = ADC_REGULAR_RANK_1 + i;
+    sConfig.SamplingTime = SRATE_GetSampleTime();
+    if (HAL_ADC_ConfigChannel(acq_hadc, &sConfig) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+    acq_channels[i] = channels[i];
+  }
+  acq_mode = ACQ_MODE_INDEPENDENT;
+  acq_channel_count = count;
+  acq_half_length = (uint16_t)(ACQ_SCANS_PER_HALF * count);
+
+  if (SRATE_SetConversions(count) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  return (running != 0U) ? ACQ_Start() : HAL_OK;
+}
+
+/**
+  * @brief  Switches to one of the ADC1 + ADC2 dual modes
+  * @note   ACQ_MODE_DUAL_SIMULT: on every TIM2 trigger ADC1 converts
+  *         channel_a and ADC2 channel_b at the same instant; blocks hold
+  *         the two channels interleaved [a, b].
+  *         ACQ_MODE_DUAL_INTERLEAVED: both ADCs free-run on channel_a with
+  *         a 7 ADC clock offset, 1.5 cycles sampling, giving one sample
+  *         every 7 ADC clocks (adc clock / 7); channel_b is ignored and
+  *         the timer does not pace the ADC.
+  *         In both modes the DMA moves one 32-bit word (ADC2 << 16 | ADC1)
+  *         per pair, ACQ_UnpackBlock() turns it back into samples.
+  * @param  mode: ACQ_MODE_DUAL_SIMULT or ACQ_MODE_DUAL_INTERLEAVED
+  * @param  channel_a: ADC1 channel
+  * @param  channel_b: ADC2 channel, ADC_CHANNEL_0..ADC_CHANNEL_9
+  * @retval HAL status
+  */
+HAL_StatusTypeDef ACQ_ConfigDual(ACQ_ModeTypeDef mode, uint8_t channel_a, uint8_t channel_b)
+{
+  ADC_ChannelConfTypeDef sConfig = {0};
+  uint8_t running = acq_running;
+  uint8_t interleaved = (mode == ACQ_MODE_DUAL_INTERLEAVED) ? 1U : 0U;
+  uint32_t trigger = (interleaved != 0U) ? ADC_SOFTWARE_START : ADC_EXTERNALTRIGCONV_T2_CC2;
+  uint32_t continuous = (interleaved != 0U) ? ENABLE : DISABLE;
+
+  if (interleaved != 0U)
+  {
+    channel_b = channel_a;
+  }
+  /* Only ADC1 reaches the internal channels */
+  if ((acq_hadc == NULL) || (acq_hadc_slave == NULL) || (mode == ACQ_MODE_INDEPENDENT) ||
+      !IS_ACQ_CHANNEL(channel_a) || (channel_b > ADC_CHANNEL_9))
+  {
+    return HAL_ERROR;
+  }
+
+  if (running != 0U)
+  {
+    (void)ACQ_Stop();
+  }
+
+  /* Scan length 1 for the trigger timer; in interleaved mode it keeps
+     running but the ADCs ignore it */
+  if (SRATE_SetConversions(1U) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  if ((ACQ_ConfigMultiMode((interleaved != 0U) ? ADC_DUALMODE_INTERLFAST : ADC_DUALMODE_REGSIMULT) != HAL_OK) ||
+      (ACQ_ConfigDma(DMA_PDATAALIGN_WORD, DMA_MDATAALIGN_WORD) != HAL_OK) ||
+      (ACQ_ConfigAdc(acq_hadc, trigger, continuous, 1U) != HAL_OK) ||
+      (ACQ_ConfigAdc(acq_hadc_slave, ADC_SOFTWARE_START, continuous, 1U) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+
+  /* Simultaneous channels need identical sampling times; fast interleaved
+     allows at most 7 cycles so the two ADCs never sample together */
+  sConfig.Rank = ADC_REGULAR_RANK_1;
+  sConfig.SamplingTime = (interleaved != 0U) ? ADC_SAMPLETIME_1CYCLE_5 : SRATE_GetSampleTime();
+  ACQ_ConfigPin(channel_a);
+  sConfig.Channel = channel_a;
+  if (HAL_ADC_ConfigChannel(acq_hadc, &sConfig) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  ACQ_ConfigPin(channel_b);
+  sConfig.Channel = channel_b;
+  if (HAL_ADC_ConfigChannel(acq_hadc_slave, &sConfig) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  acq_mode = mode;
+  acq_channels[0] = channel_a;
+  acq_channels[1] = channel_b;
+  acq_channel_count = (interleaved != 0U) ? 1U : 2U;
+  acq_half_length = (uint16_t)(2U * ACQ_SCANS_PER_HALF);
+
+  return (running != 0U) ? ACQ_Start() : HAL_OK;
+}
+
+/**
+  * @brief  Current ADC arrangement
+  * @retval Acquisition mode
+  */
+ACQ_ModeTypeDef ACQ_GetMode(void)
+{
+  return acq_mode;
+}
+
+/**
+  * @brief  Current channel list, in the order samples appear in a block
+  * @param  channels: receives up to ACQ_MAX_CHANNELS channel numbers
+  * @retval Number of channels
+  */
+uint8_t ACQ_GetChannels(uint8_t *channels)
+{
+  for (uint8_t i = 0U; i < acq_channel_count; i++)
+  {
+    channels[i] = acq_channels[i];
+  }
+  return acq_channel_count;
+}
+
+/**
+  * @brief  Sets the per-channel sample rate (trigger timer rate)
+  * @note   Not available in fast interleaved mode, where the ADCs free-run
+  *         and the sampling time must stay at 1.5 cycles.
+  * @param  rate_hz: requested rate
+  * @retval HAL status
+  */
+HAL_StatusTypeDef ACQ_SetSampleRate(uint32_t rate_hz)
+{
+  if (acq_mode == ACQ_MODE_DUAL_INTERLEAVED)
+  {
+    return HAL_ERROR;
+  }
+  return SRATE_SetRate(rate_hz);
+}
+
+/**
+  * @brief  Per-channel sample rate of the running configuration
+  * @retval Rate in mHz
+  */
+uint32_t ACQ_GetSampleRateMilliHz(void)
+{
+  if (acq_mode == ACQ_MODE_DUAL_INTERLEAVED)
+  {
+    return (uint32_t)(((uint64_t)HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_ADC) * 1000U) / 7U);
+  }
+  return SRATE_GetActualRateMilliHz();
+}
+
+/**
+  * @brief  Starts the circular DMA acquisition into the ping-pong buffer
+  * @retval HAL status
+  */
+HAL_StatusTypeDef ACQ_Start(void)
+{
+  HAL_StatusTypeDef status;
+
+  if (acq_hadc == NULL)
+  {
+    return HAL_ERROR;
+  }
+
+  acq_last = 0U;
+  acq_consumed = 0U;
+  acq_missed = 0U;
+  acq_torn = 0U;
+  acq_latency_max = 0U;
+
+  if (acq_mode == ACQ_MODE_INDEPENDENT)
+  {
+    status = HAL_ADC_Start_DMA(acq_hadc, (uint32_t*)acq_buffer, 2U * acq_half_length);
+  }
+  else
+  {
+    /* One word per ADC pair: the length in words equals one half in samples */
+    status = HAL_ADCEx_MultiModeStart_DMA(acq_hadc, (uint32_t*)acq_buffer, acq_half_length);
+  }
+  acq_running = (status == HAL_OK) ? 1U : 0U;
+  return status;
+}
+
+/**
+  * @brief  Stops the acquisition started by ACQ_Start()
+  * @retval HAL status
+  */
+HAL_StatusTypeDef ACQ_Stop(void)
+{
+  if (acq_hadc == NULL)
+  {
+    return HAL_ERROR;
+  }
+  acq_running = 0U;
+  if (acq_mode == ACQ_MODE_INDEPENDENT)
+  {
+    return HAL_ADC_Stop_DMA(acq_hadc);
+  }
+  return HAL_ADCEx_MultiModeStop_DMA(acq_hadc);
+}
+
+/**
+  * @brief  Checks whether the DMA acquisition is running
+  * @retval 1 between ACQ_Start() and ACQ_Stop()
+  */
+uint8_t ACQ_IsRunning(void)
+{
+  return acq_running;
+}
+
+/**
+  * @brief  Takes the most recent completed block, if any
+  * @note   Blocks completed while the consumer was busy and never handed
+  *         out are counted as missed.
+  * @param  block: filled with the block descriptor
+  * @retval 1 if a new block is available, 0 otherwise
+  */
+uint8_t ACQ_GetBlock(ACQ_BlockTypeDef *block)
+{
+  uint32_t last = acq_last;
+  uint32_t sequence = last >> 1;
+  uint32_t latency;
+
+  if (sequence == acq_consumed)
+  {
+    return 0U;
+  }
+  if ((sequence - acq_consumed) > 1U)
+  {
+    acq_missed += sequence - acq_consumed - 1U;
+  }
+  acq_consumed = sequence;
+
+  /* A newer completion of the same half would make this block torn anyway */
+  block->timestamp = acq_stamp[last & 1U];
+  latency = CYCLE_Now() - block->timestamp;
+  if (latency > acq_latency_max)
+  {
+    acq_latency_max = latency;
+  }
+
+  block->data = &acq_buffer[((last & 1U) != 0U) ? acq_half_length : 0U];
+  block->length = acq_half_length;
+  block->channels = acq_channel_count;
+  block->sequence = sequence;
+  return 1U;
+}
+
+/**
+  * @brief  Unpacks the 32-bit dual-mode words of a block in place
+  * @note   Processing stage, called on a block obtained by ACQ_GetBlock()
+  *         (the DMA is writing the other half). Each word holds ADC1 in the
+  *         low and ADC2 in the high half-word.
+  *         Simultaneous mode: on the little-endian core the half-word view
+  *         already reads [ADC1, ADC2] = [channel a, channel b], nothing to do.
+  *         Fast interleaved mode: ADC2 samples 7 ADC clocks before ADC1, the
+  *         halves are swapped so the block reads in time order.
+  * @param  block: block descriptor
+  * @retval None
+  */
+void ACQ_UnpackBlock(const ACQ_BlockTypeDef *block)
+{
+  if (acq_mode == ACQ_MODE_DUAL_INTERLEAVED)
+  {
+    uint32_t *words = (uint32_t*)(uintptr_t)block->data;
+    uint16_t count = block->length / 2U;
+
+    for (uint16_t i = 0U; i < count; i++)
+    {
+      words[i] = __ROR(words[i], 16U);
+    }
+  }
+}
+
+/**
+  * @brief  Hands a block back after processing
+  * @note   If the next block completed meanwhile, the DMA has already started
+  *         writing into this half: the results are torn and must be dropped.
+  * @param  block: descriptor returned by ACQ_GetBlock()
+  * @retval 1 if the data stayed intact during processing, 0 on overrun
+  */
+uint8_t ACQ_ReleaseBlock(const ACQ_BlockTypeDef *block)
+{
+  if ((acq_last >> 1) != block->sequence)
+  {
+    acq_torn++;
+    return 0U;
+  }
+  return 1U;
+}
+
+/**
+  * @brief  Number of blocks lost or torn since ACQ_Start()
+  * @retval Overrun count
+  */
+uint32_t ACQ_GetOverruns(void)
+{
+  return acq_missed + acq_torn;
+}
+
+/**
+  * @brief  Block counters since ACQ_Start()
+  * @param  stats: filled with the counters
+  * @retval None
+  */
+void ACQ_GetStats(ACQ_StatsTypeDef *stats)
+{
+  uint32_t rate_mhz = ACQ_GetSampleRateMilliHz();
+  uint32_t scans = acq_half_length / acq_channel_count;
+
+  stats->blocks = acq_last >> 1;
+  stats->missed = acq_missed;
+  stats->torn = acq_torn;
+  stats->latency_max = acq_latency_max;
+  stats->period = (rate_mhz != 0U) ?
+                  (uint32_t)(((uint64_t)scans * SystemCoreClock * 1000U) / rate_mhz) : 0U;
+}
+
+/**
+  * @brief  First half of the buffer is ready (DMA half-transfer interrupt)
+  */
+void ACQ_HalfCpltHandler(void)
+{
+  ACQ_Complete(0U);
+}
+
+/**
+  * @brief  Second half of the buffer is ready (DMA transfer-complete interrupt)
+  */
+void ACQ_CpltHandler(void)
+{
+  ACQ_Complete(1U);
+}
@@ -0,0 +1,240 @@
+/**
+  ******************************************************************************
+  * @file           : alarm.c
+  * @brief          : Over/under-voltage alarms.
+  *
+  *                   The F103 has one analog watchdog per ADC with a single
+  *                   threshold pair. The first configured channel gets the
+  *                   ADC1 watchdog: the ADC compares every conversion of it
+  *                   in hardware and the CPU only runs on an event, which
+  *                   also wakes it from WFI sleep. The event is latched with
+  *                   the tick and the offending sample, and the interrupt is
+  *                   held off for ALM_HOLDOFF_MS.
+  *
+  *                   The further channels have their own windows and are
+  *                   checked against the min/max the main loop computes for
+  *                   every block anyway, so they cost a compare per block
+  *                   and are reported at most one half-buffer late. Each of
+  *                   them raises an event when it leaves its window and
+  *                   again only after a block fully inside it.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "alarm.h"
+#include "acquisition.h"
+
+/* Private define ------------------------------------------------------------*/
+#define ALM_ADC_MAX            4095U
+
+/* Private variables ---------------------------------------------------------*/
+static ADC_HandleTypeDef *alm_hadc = NULL;
+static ALM_ChannelTypeDef alm_channels[ALM_MAX_CHANNELS];
+static uint8_t alm_count = 0U;
+static uint8_t alm_outside[ALM_MAX_CHANNELS];
+static ALM_EventTypeDef alm_queue[ALM_QUEUE_SIZE];
+static volatile uint8_t alm_head = 0U;
+static volatile uint8_t alm_tail = 0U;
+static volatile uint8_t alm_holdoff = 0U;
+static volatile uint32_t alm_holdoff_tick = 0U;
+static ALM_StatsTypeDef alm_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static void ALM_Push(const ALM_EventTypeDef *event);
+
+/* Private user code ---------------------------------------------------------*/
+/* Queues an event; called from the main loop and from the ADC interrupt */
+static void ALM_Push(const ALM_EventTypeDef *event)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  if ((uint8_t)(alm_head - alm_tail) < ALM_QUEUE_SIZE)
+  {
+    alm_queue[alm_head % ALM_QUEUE_SIZE] = *event;
+    alm_head++;
+  }
+  else
+  {
+    alm_stats.lost_events++;
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Binds the alarms to the ADC carrying the analog watchdog
+  * @param  hadc: ADC1 handle
+  * @retval None
+  */
+void ALM_Init(ADC_HandleTypeDef *hadc)
+{
+  alm_hadc = hadc;
+  alm_count = 0U;
+}
+
+/**
+  * @brief  Sets the monitored channels and their windows
+  * @note   list[0] must be converted by ADC1 (scan list or DUAL_CHANNEL_A).
+  *         A count of 0 switches the alarms off.
+  * @param  list: channel windows, copied
+  * @param  count: number of entries, 0..ALM_MAX_CHANNELS
+  * @retval HAL status
+  */
+HAL_StatusTypeDef ALM_Config(const ALM_ChannelTypeDef *list, uint8_t count)
+{
+  ADC_AnalogWDGConfTypeDef awd = {0};
+
+  if ((alm_hadc == NULL) || (count > ALM_MAX_CHANNELS))
+  {
+    return HAL_ERROR;
+  }
+  for (uint8_t i = 0U; i < count; i++)
+  {
+    if ((list[i].low > list[i].high) || (list[i].high > ALM_ADC_MAX))
+    {
+      return HAL_ERROR;
+    }
+  }
+
+  for (uint8_t i = 0U; i < count; i++)
+  {
+    alm_channels[i] = list[i];
+    alm_outside[i] = 0U;
+  }
+  alm_count = count;
+  alm_holdoff = 0U;
+
+  awd.WatchdogMode = (count != 0U) ? ADC_ANALOGWATCHDOG_SINGLE_REG : ADC_ANALOGWATCHDOG_NONE;
+  awd.Channel = (count != 0U) ? list[0].channel : ADC_CHANNEL_0;
+  awd.ITMode = (count != 0U) ? ENABLE : DISABLE;
+  awd.HighThreshold = (count != 0U) ? list[0].high : ALM_ADC_MAX;
+  awd.LowThreshold = (count != 0U) ? list[0].low : 0U;
+  __HAL_ADC_CLEAR_FLAG(alm_hadc, ADC_FLAG_AWD);
+  return HAL_ADC_AnalogWDGConfig(alm_hadc, &awd);
+}
+
+/**
+  * @brief  Checks the channels without a watchdog against one block
+  * @note   Call only for blocks confirmed by ACQ_ReleaseBlock().
+  * @param  stats: per-rank results of STATS_Block
+  * @param  channels: entries in stats
+  * @retval None
+  */
+void ALM_CheckBlock(const STATS_ChannelTypeDef *stats, uint8_t channels)
+{
+  uint8_t channel_list[ACQ_MAX_CHANNELS];
+
+  if (alm_count < 2U)
+  {
+    return;
+  }
+  (void)ACQ_GetChannels(channel_list);
+
+  for (uint8_t i = 1U; i < alm_count; i++)
+  {
+    const ALM_ChannelTypeDef *window = &alm_channels[i];
+
+    for (uint8_t rank = 0U; rank < channels; rank++)
+    {
+      const STATS_ChannelTypeDef *block = &stats[rank];
+      uint8_t over;
+
+      if ((channel_list[rank] != window->channel) || (block->count == 0U))
+      {
+        continue;
+      }
+      over = (block->max > window->high) ? 1U : 0U;
+      if ((over == 0U) && (block->min >= window->low))
+      {
+        alm_outside[i] = 0U;
+      }
+      else if (alm_outside[i] == 0U)
+      {
+        ALM_EventTypeDef event;
+
+        event.tick = HAL_GetTick();
+        event.value = (over != 0U) ? block->max : block->min;
+        event.channel = window->channel;
+        event.over = over;
+        event.watchdog = 0U;
+        alm_outside[i] = 1U;
+        alm_stats.block_events++;
+        ALM_Push(&event);
+      }
+      break;
+    }
+  }
+}
+
+/**
+  * @brief  Re-enables the watchdog interrupt after the holdoff
+  * @note   Call from the main loop.
+  * @retval None
+  */
+void ALM_Process(void)
+{
+  if ((alm_holdoff != 0U) && ((HAL_GetTick() - alm_holdoff_tick) >= ALM_HOLDOFF_MS))
+  {
+    alm_holdoff = 0U;
+    __HAL_ADC_CLEAR_FLAG(alm_hadc, ADC_FLAG_AWD);
+    __HAL_ADC_ENABLE_IT(alm_hadc, ADC_IT_AWD);
+  }
+}
+
+/**
+  * @brief  Takes the oldest latched event
+  * @param  event: destination
+  * @retval 1 if an event was returned
+  */
+uint8_t ALM_GetEvent(ALM_EventTypeDef *event)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint8_t found = 0U;
+
+  __disable_irq();
+  if (alm_head != alm_tail)
+  {
+    *event = alm_queue[alm_tail % ALM_QUEUE_SIZE];
+    alm_tail++;
+    found = 1U;
+  }
+  __set_PRIMASK(primask);
+  return found;
+}
+
+/**
+  * @brief  Copies the alarm counters
+  * @param  stats: destination
+  * @retval None
+  */
+void ALM_GetStats(ALM_StatsTypeDef *stats)
+{
+  *stats = alm_stats;
+}
+
+/**
+  * @brief  Latches an analog watchdog event (ADC interrupt)
+  * @note   DR still holds the monitored conversion: the next conversion
+  *         ends at least 14 ADC clocks later.
+  * @retval None
+  */
+void ALM_WatchdogHandler(void)
+{
+  ALM_EventTypeDef event;
+
+  if (alm_count == 0U)
+  {
+    return;
+  }
+  __HAL_ADC_DISABLE_IT(alm_hadc, ADC_IT_AWD);
+  alm_holdoff_tick = HAL_GetTick();
+  alm_holdoff = 1U;
+
+  event.tick = alm_holdoff_tick;
+  event.value = (uint16_t)(alm_hadc->Instance->DR & ALM_ADC_MAX);
+  event.channel = alm_channels[0].channel;
+  event.over = (event.value > alm_channels[0].high) ? 1U : 0U;
+  event.watchdog = 1U;
+  alm_stats.watchdog_events++;
+  ALM_Push(&event);
+}
@@ -0,0 +1,280 @@
+/**
+  ******************************************************************************
+  * @file           : calib.c
+  * @brief          : Per-channel calibration with persistent points.
+  *
+  *                   The points of every channel are kept sorted by reading
+  *                   in the emulated EEPROM (eeprom.c). At boot and after
+  *                   every change they are turned into a table of segments
+  *                   with a start, a base voltage and a Q16 slope, so that
+  *                   a conversion is a short compare chain, one 32x32->64
+  *                   multiply and a shift; all divisions happen when the
+  *                   table is built. Readings beyond the outer points follow
+  *                   the first or last segment. Readings are referred to
+  *                   the nominal 3.3 V supply (VOLT_Compensate) before the
+  *                   lookup, so the points stay valid when VDDA moves.
+  *
+  *                   EEPROM layout per channel (13 virtual addresses from
+  *                   1 + 13 * channel): point count, then raw, microvolts
+  *                   low and high half of every point. An update first
+  *                   writes count 0, then the points and the new count
+  *                   last: a reset in between drops the channel's points
+  *                   (nominal conversion) but never loads a mix of the old
+  *                   and the new set.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "calib.h"
+#include "eeprom.h"
+#include "voltage.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CAL_EE_STRIDE          (1U + (3U * CAL_MAX_POINTS))
+#define CAL_EE_BASE(channel)   (1U + ((channel) * CAL_EE_STRIDE))
+
+#if ((CAL_CHANNELS * CAL_EE_STRIDE) > EE_MAX_VADDR)
+#error "Calibration points do not fit into the emulated EEPROM"
+#endif
+
+/* Nominal slope: uV per raw unit in Q16 */
+#define CAL_NOMINAL_SLOPE      ((int32_t)(VOLT_SCALE_Q22 >> (22U - 16U + CAL_RAW_SHIFT)))
+
+/* Private variables ---------------------------------------------------------*/
+static CAL_PointTypeDef cal_points[CAL_CHANNELS][CAL_MAX_POINTS];
+static uint8_t cal_count[CAL_CHANNELS];
+static CAL_TableTypeDef cal_table[CAL_CHANNELS];
+
+/* Private function prototypes -----------------------------------------------*/
+static void CAL_Build(uint8_t channel);
+static void CAL_Load(uint8_t channel);
+static HAL_StatusTypeDef CAL_Store(uint8_t channel);
+
+/* Private user code ---------------------------------------------------------*/
+static void CAL_Build(uint8_t channel)
+{
+  const CAL_PointTypeDef *p = cal_points[channel];
+  CAL_TableTypeDef *table = &cal_table[channel];
+  uint8_t count = cal_count[channel];
+
+  table->segments = 0U;
+  if (count == 1U)
+  {
+    /* Offset only: nominal slope through the point */
+    table->segments = 1U;
+    table->start[0] = p[0].raw;
+    table->base[0] = (int32_t)p[0].microvolts;
+    table->slope[0] = CAL_NOMINAL_SLOPE;
+    return;
+  }
+
+  for (uint8_t s = 0U; (s + 1U) < count; s++)
+  {
+    int64_t rise = (int64_t)p[s + 1U].microvolts - (int64_t)p[s].microvolts;
+    int32_t run = (int32_t)p[s + 1U].raw - (int32_t)p[s].raw;
+
+    table->start[s] = p[s].raw;
+    table->base[s] = (int32_t)p[s].microvolts;
+    table->slope[s] = (int32_t)((rise * 65536) / run);
+    table->segments++;
+  }
+}
+
+static void CAL_Load(uint8_t channel)
+{
+  const uint16_t base = (uint16_t)CAL_EE_BASE(channel);
+  uint16_t count = 0U;
+
+  cal_count[channel] = 0U;
+  if ((EE_Read(base, &count) != 0U) && (count <= CAL_MAX_POINTS))
+  {
+    for (uint8_t i = 0U; i < count; i++)
+    {
+      uint16_t raw = 0U;
+      uint16_t low = 0U;
+      uint16_t high = 0U;
+
+      (void)EE_Read((uint16_t)(base + 1U + (3U * i)), &raw);
+      (void)EE_Read((uint16_t)(base + 2U + (3U * i)), &low);
+      (void)EE_Read((uint16_t)(base + 3U + (3U * i)), &high);
+      cal_points[channel][i].raw = raw;
+      cal_points[channel][i].microvolts = ((uint32_t)high << 16) | low;
+    }
+    cal_count[channel] = (uint8_t)count;
+  }
+  CAL_Build(channel);
+}
+
+static HAL_StatusTypeDef CAL_Store(uint8_t channel)
+{
+  const uint16_t base = (uint16_t)CAL_EE_BASE(channel);
+  HAL_StatusTypeDef status;
+
+  /* The points are rewritten in place: invalidate the old set first */
+  status = EE_Write(base, 0U);
+  for (uint8_t i = 0U; (i < cal_count[channel]) && (status == HAL_OK); i++)
+  {
+    const CAL_PointTypeDef *point = &cal_points[channel][i];
+
+    status = EE_Write((uint16_t)(base + 1U + (3U * i)), point->raw);
+    if (status == HAL_OK)
+    {
+      status = EE_Write((uint16_t)(base + 2U + (3U * i)), (uint16_t)point->microvolts);
+    }
+    if (status == HAL_OK)
+    {
+      status = EE_Write((uint16_t)(base + 3U + (3U * i)), (uint16_t)(point->microvolts >> 16));
+    }
+  }
+  if (status == HAL_OK)
+  {
+    status = EE_Write(base, cal_count[channel]);
+  }
+  return status;
+}
+
+/**
+  * @brief  Loads the stored points of all channels and builds the tables
+  * @note   Call once at startup; formats the EEPROM pages if blank.
+  * @retval HAL status of the EEPROM; the nominal conversion is used for
+  *         channels without points either way
+  */
+HAL_StatusTypeDef CAL_Init(void)
+{
+  HAL_StatusTypeDef status = EE_Init();
+
+  for (uint8_t channel = 0U; channel < CAL_CHANNELS; channel++)
+  {
+    if (status == HAL_OK)
+    {
+      CAL_Load(channel);
+    }
+    else
+    {
+      cal_count[channel] = 0U;
+      CAL_Build(channel);
+    }
+  }
+  return status;
+}
+
+/**
+  * @brief  Adds a point and stores the set
+  * @note   A point with the same reading replaces the old one.
+  * @param  channel: ADC_CHANNEL_x
+  * @param  raw: averaged reading referred to the nominal supply
+  *              (VOLT_Compensate), ADC counts << CAL_RAW_SHIFT
+  * @param  microvolts: reference voltage applied during the reading
+  * @retval HAL_ERROR if the channel already has CAL_MAX_POINTS points
+  */
+HAL_StatusTypeDef CAL_AddPoint(uint8_t channel, uint16_t raw, uint32_t microvolts)
+{
+  CAL_PointTypeDef *p;
+  uint8_t count;
+  uint8_t pos = 0U;
+
+  if ((channel >= CAL_CHANNELS) || (microvolts > INT32_MAX))
+  {
+    return HAL_ERROR;
+  }
+  p = cal_points[channel];
+  count = cal_count[channel];
+
+  while ((pos < count) && (p[pos].raw < raw))
+  {
+    pos++;
+  }
+  if ((pos < count) && (p[pos].raw == raw))
+  {
+    p[pos].microvolts = microvolts;
+  }
+  else
+  {
+    if (count >= CAL_MAX_POINTS)
+    {
+      return HAL_ERROR;
+    }
+    for (uint8_t i = count; i > pos; i--)
+    {
+      p[i] = p[i - 1U];
+    }
+    p[pos].raw = raw;
+    p[pos].microvolts = microvolts;
+    cal_count[channel] = (uint8_t)(count + 1U);
+  }
+
+  CAL_Build(channel);
+  return CAL_Store(channel);
+}
+
+/**
+  * @brief  Removes all points of a channel (back to nominal)
+  * @param  channel: ADC_CHANNEL_x
+  * @retval HAL status
+  */
+HAL_StatusTypeDef CAL_Clear(uint8_t channel)
+{
+  if (channel >= CAL_CHANNELS)
+  {
+    return HAL_ERROR;
+  }
+  cal_count[channel] = 0U;
+  CAL_Build(channel);
+  return EE_Write((uint16_t)CAL_EE_BASE(channel), 0U);
+}
+
+/**
+  * @brief  Copies the points of a channel
+  * @param  channel: ADC_CHANNEL_x
+  * @param  points: destination, CAL_MAX_POINTS entries
+  * @retval Number of points
+  */
+uint8_t CAL_GetPoints(uint8_t channel, CAL_PointTypeDef *points)
+{
+  if (channel >= CAL_CHANNELS)
+  {
+    return 0U;
+  }
+  for (uint8_t i = 0U; i < cal_count[channel]; i++)
+  {
+    points[i] = cal_points[channel][i];
+  }
+  return cal_count[channel];
+}
+
+/**
+  * @brief  Converts a reading to microvolts with the channel calibration
+  * @param  channel: ADC_CHANNEL_x the reading comes from
+  * @param  value: ADC counts with extra_bits more bits
+  * @param  extra_bits: resolution above 12 bits, 0..8
+  * @retval Input voltage in uV, 0 for results below zero
+  */
+uint32_t CAL_ToMicrovolts(uint8_t channel, uint32_t value, uint8_t extra_bits)
+{
+  const CAL_TableTypeDef *table;
+  int32_t x;
+  int64_t uv;
+  uint8_t s = 0U;
+
+  if ((channel >= CAL_CHANNELS) || (cal_table[channel].segments == 0U))
+  {
+    return VOLT_OversampledToMicrovolts(value, extra_bits);
+  }
+  table = &cal_table[channel];
+
+  x = (extra_bits <= CAL_RAW_SHIFT) ? (int32_t)(value << (CAL_RAW_SHIFT - extra_bits))
+                                    : (int32_t)(value >> (extra_bits - CAL_RAW_SHIFT));
+  x = (int32_t)VOLT_Compensate((uint32_t)x);
+  while (((s + 1U) < table->segments) && (x >= (int32_t)table->start[s + 1U]))
+  {
+    s++;
+  }
+
+  uv = (int64_t)table->base[s] +
+       ((((int64_t)table->slope[s] * (x - (int32_t)table->start[s])) + 32768) >> 16);
+  if (uv < 0)
+  {
+    return 0U;
+  }
+  return (uv > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)uv;
+}
@@ -0,0 +1,345 @@
+/**
+  ******************************************************************************
+  * @file           : capture.c
+  * @brief          : Oscilloscope-style triggered capture.
+  *
+  *                   While armed, every acquisition block is copied into a
+  *                   history ring and the trigger channel of the block is
+  *                   checked scan by scan, once pre_scans of history are
+  *                   there. After the trigger the ring takes post_scans more
+  *                   scans and is frozen. CAP_Process then sends the record
+  *                   as SFRAME_TYPE_CAPTURE frames, one frame whenever the TX
+  *                   ring has room for it, so nothing of a record is dropped
+  *                   and the UART is quiet until something happens.
+  *
+  *                   A block overwritten by the DMA while it was copied
+  *                   (CAP_Release with valid 0) makes the history
+  *                   discontinuous: the record is dropped and the capture
+  *                   arms again.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "capture.h"
+#include "stream_frame.h"
+#include "uart_tx.h"
+
+/* Private define ------------------------------------------------------------*/
+#if (SFRAME_ENCODED_MAX > UTX_BUFFER_SIZE)
+#error "UTX_BUFFER_SIZE cannot hold one capture frame"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static CAP_ConfigTypeDef cap_config;
+static volatile CAP_StateTypeDef cap_state = CAP_STATE_IDLE;
+static uint16_t cap_buffer[CAP_BUFFER_SAMPLES];
+static uint8_t cap_channels = 0U;
+static uint16_t cap_capacity = 0U;     /* ring size in scans */
+static uint16_t cap_head = 0U;         /* next scan written */
+static uint32_t cap_stored = 0U;       /* scans written since arming */
+static uint16_t cap_remaining = 0U;    /* post-trigger scans still to record */
+static uint16_t cap_prev = 0U;
+static uint8_t cap_edge_armed = 0U;
+static uint8_t cap_touched = 0U;
+/* Dump of the frozen record */
+static uint16_t cap_start = 0U;        /* ring position of the first scan */
+static uint16_t cap_sent = 0U;         /* scans already framed */
+static uint8_t cap_frame[SFRAME_ENCODED_MAX];
+static uint16_t cap_frame_length = 0U;
+static uint16_t cap_frame_scans = 0U;
+static CAP_StatsTypeDef cap_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t CAP_Fits(const CAP_ConfigTypeDef *config, uint8_t channels);
+static void CAP_Restart(uint8_t channels);
+static uint8_t CAP_Trigger(uint16_t sample);
+static uint16_t CAP_EncodeNext(void);
+
+/* Private user code ---------------------------------------------------------*/
+/* The trigger rank is in the scan list and the record fits into the ring */
+static uint8_t CAP_Fits(const CAP_ConfigTypeDef *config, uint8_t channels)
+{
+  return (uint8_t)((channels != 0U) && (config->rank < channels) &&
+                   (((uint32_t)config->pre_scans + config->post_scans) <=
+                    (CAP_BUFFER_SAMPLES / channels)));
+}
+
+/* Empties the history and waits for a trigger again */
+static void CAP_Restart(uint8_t channels)
+{
+  cap_channels = channels;
+  cap_capacity = (uint16_t)(CAP_BUFFER_SAMPLES / channels);
+  cap_head = 0U;
+  cap_stored = 0U;
+  cap_edge_armed = 0U;
+  cap_frame_length = 0U;
+  cap_sent = 0U;
+  cap_state = CAP_STATE_ARMED;
+}
+
+/* Trigger condition for one sample of the trigger channel */
+static uint8_t CAP_Trigger(uint16_t sample)
+{
+  const CAP_ConfigTypeDef *cfg = &cap_config;
+  uint8_t fire = 0U;
+
+  switch (cfg->trigger)
+  {
+    case CAP_TRIG_RISING:
+      fire = (cap_edge_armed != 0U) && (sample >= cfg->level) && (cap_prev < cfg->level);
+      if ((uint32_t)sample + cfg->hysteresis < cfg->level)
+      {
+        cap_edge_armed = 1U;
+      }
+      break;
+    case CAP_TRIG_FALLING:
+      fire = (cap_edge_armed != 0U) && (sample <= cfg->level) && (cap_prev > cfg->level);
+      if (sample > ((uint32_t)cfg->level + cfg->hysteresis))
+      {
+        cap_edge_armed = 1U;
+      }
+      break;
+    case CAP_TRIG_ABOVE:
+      fire = (sample > cfg->level);
+      break;
+    case CAP_TRIG_BELOW:
+      fire = (sample < cfg->level);
+      break;
+    default:
+      fire = (sample < cfg->level) || (sample > cfg->level_high);
+      break;
+  }
+  cap_prev = sample;
+  return fire;
+}
+
+/* Frames the next part of the frozen record */
+static uint16_t CAP_EncodeNext(void)
+{
+  SFRAME_HeaderTypeDef header;
+  uint8_t channel_list[ACQ_MAX_CHANNELS];
+  uint16_t samples[SFRAME_MAX_SAMPLES];
+  uint16_t total = (uint16_t)(cap_config.pre_scans + cap_config.post_scans);
+  uint16_t scans = (uint16_t)(SFRAME_MAX_SAMPLES / cap_channels);
+  uint16_t pos = (uint16_t)((cap_start + cap_sent) % cap_capacity);
+  uint16_t count = 0U;
+
+  if (scans > (total - cap_sent))
+  {
+    scans = (uint16_t)(total - cap_sent);
+  }
+  for (uint16_t s = 0U; s < scans; s++)
+  {
+    const uint16_t *src = &cap_buffer[pos * cap_channels];
+
+    for (uint8_t ch = 0U; ch < cap_channels; ch++)
+    {
+      samples[count++] = src[ch];
+    }
+    if (++pos == cap_capacity)
+    {
+      pos = 0U;
+    }
+  }
+
+  (void)ACQ_GetChannels(channel_list);
+  header.type = SFRAME_TYPE_CAPTURE;
+  header.channels = cap_channels;
+  header.samples = count;
+  /* Scan offset from the trigger, negative before it */
+  header.sequence = (uint32_t)((int32_t)cap_sent - (int32_t)cap_config.pre_scans);
+  header.rate_mhz = ACQ_GetSampleRateMilliHz();
+
+  cap_frame_scans = scans;
+  cap_frame_length = SFRAME_Encode(cap_frame, NULL, &header, channel_list, samples);
+  return cap_frame_length;
+}
+
+/**
+  * @brief  Sets the trigger and the record length, disarms the capture
+  * @param  config: settings, copied
+  * @retval HAL_ERROR if the trigger rank is not in the current channel
+  *         list or the record does not fit into the ring with it
+  */
+HAL_StatusTypeDef CAP_Config(const CAP_ConfigTypeDef *config)
+{
+  uint8_t channel_list[ACQ_MAX_CHANNELS];
+  uint8_t channels = ACQ_GetChannels(channel_list);
+
+  if ((config->post_scans == 0U) || (CAP_Fits(config, channels) == 0U))
+  {
+    return HAL_ERROR;
+  }
+  cap_state = CAP_STATE_IDLE;
+  cap_config = *config;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Starts filling the history and watching for the trigger
+  * @retval HAL_ERROR if not configured or the configuration no longer fits
+  *         the channel list
+  */
+HAL_StatusTypeDef CAP_Arm(void)
+{
+  uint8_t channel_list[ACQ_MAX_CHANNELS];
+  uint8_t channels = ACQ_GetChannels(channel_list);
+
+  if ((cap_config.post_scans == 0U) || (CAP_Fits(&cap_config, channels) == 0U))
+  {
+    return HAL_ERROR;
+  }
+  CAP_Restart(channels);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Stops the capture, a record being sent is abandoned
+  * @retval None
+  */
+void CAP_Disarm(void)
+{
+  cap_state = CAP_STATE_IDLE;
+}
+
+/**
+  * @brief  Capture state
+  * @retval CAP_STATE_x
+  */
+CAP_StateTypeDef CAP_GetState(void)
+{
+  return cap_state;
+}
+
+/**
+  * @brief  Takes one acquisition block into the history
+  * @note   Call before ACQ_ReleaseBlock(), the samples are read from the
+  *         DMA buffer.
+  * @param  block: unpacked block
+  * @retval None
+  */
+void CAP_Block(const ACQ_BlockTypeDef *block)
+{
+  const uint16_t pre = cap_config.pre_scans;
+  uint16_t scans;
+
+  cap_touched = 0U;
+  if ((cap_state != CAP_STATE_ARMED) && (cap_state != CAP_STATE_TRIGGERED))
+  {
+    return;
+  }
+  if (block->channels != cap_channels)
+  {
+    /* Scan list changed: the trigger channel must still be scanned and
+       the record must still fit */
+    if (CAP_Fits(&cap_config, block->channels) == 0U)
+    {
+      cap_stats.disarmed++;
+      cap_state = CAP_STATE_IDLE;
+      return;
+    }
+    CAP_Restart(block->channels);
+  }
+
+  cap_touched = 1U;
+  scans = (uint16_t)(block->length / cap_channels);
+  for (uint16_t s = 0U; s < scans; s++)
+  {
+    const uint16_t *src = &block->data[s * cap_channels];
+    uint16_t *dst = &cap_buffer[cap_head * cap_channels];
+
+    for (uint8_t ch = 0U; ch < cap_channels; ch++)
+    {
+      dst[ch] = src[ch];
+    }
+
+    if (cap_state == CAP_STATE_ARMED)
+    {
+      /* The trigger counts only with a full pre-trigger history */
+      if ((CAP_Trigger(src[cap_config.rank]) != 0U) && (cap_stored >= pre))
+      {
+        cap_start = (uint16_t)((cap_head + cap_capacity - pre) % cap_capacity);
+        cap_remaining = cap_config.post_scans;
+        cap_state = CAP_STATE_TRIGGERED;
+      }
+    }
+    if (++cap_head == cap_capacity)
+    {
+      cap_head = 0U;
+    }
+    cap_stored++;
+
+    if ((cap_state == CAP_STATE_TRIGGERED) && (--cap_remaining == 0U))
+    {
+      cap_sent = 0U;
+      cap_frame_length = 0U;
+      cap_state = CAP_STATE_FROZEN;
+      break;
+    }
+  }
+}
+
+/**
+  * @brief  Confirms the block taken by CAP_Block
+  * @param  valid: ACQ_ReleaseBlock() result, 0 drops the history
+  * @retval None
+  */
+void CAP_Release(uint8_t valid)
+{
+  if ((cap_touched != 0U) && (valid == 0U))
+  {
+    cap_stats.restarts++;
+    CAP_Restart(cap_channels);
+  }
+  cap_touched = 0U;
+}
+
+/**
+  * @brief  Sends the frozen record, one frame per call if the TX ring has room
+  * @note   Call from the main loop; re-arms or goes idle (single) at the end.
+  * @retval None
+  */
+void CAP_Process(void)
+{
+  uint16_t total = (uint16_t)(cap_config.pre_scans + cap_config.post_scans);
+
+  if (cap_state != CAP_STATE_FROZEN)
+  {
+    return;
+  }
+  if (cap_frame_length == 0U)
+  {
+    (void)CAP_EncodeNext();
+  }
+  /* Not enough room yet: the same frame is tried again on the next call */
+  if ((UTX_GetFree() < cap_frame_length) || (UTX_Write(cap_frame, cap_frame_length) != HAL_OK))
+  {
+    return;
+  }
+  cap_stats.frames_sent++;
+  cap_sent += cap_frame_scans;
+  cap_frame_length = 0U;
+
+  if (cap_sent >= total)
+  {
+    cap_stats.captures++;
+    if (cap_config.single != 0U)
+    {
+      cap_state = CAP_STATE_IDLE;
+    }
+    else
+    {
+      CAP_Restart(cap_channels);
+    }
+  }
+}
+
+/**
+  * @brief  Copies the capture counters
+  * @param  stats: destination
+  * @retval None
+  */
+void CAP_GetStats(CAP_StatsTypeDef *stats)
+{
+  *stats = cap_stats;
+}
@@ -0,0 +1,298 @@
+/**
+  ******************************************************************************
+  * @file           : clock.c
+  * @brief          : Clock tree profiles switched at runtime.
+  *
+  *                   SystemClock_Config() starts the device on HSI/2 x 16 =
+  *                   64 MHz with the ADC at PCLK2/8 = 8 MHz. CLK_SetProfile()
+  *                   moves to another tree:
+  *
+  *                   - HSE72: 8 MHz crystal x 9, ADC at 72/6 = 12 MHz (the
+  *                     ADC limit is 14 MHz), 50 % more conversions per
+  *                     second than HSI64
+  *                   - HSI8: HSI alone, PLL and HSE off, ADC at 4 MHz
+  *
+  *                   Everything derived from the clocks is set again for the
+  *                   new tree: the TIM2 dividers and the ADC sampling time
+  *                   (SRATE_Refresh() with the requested rate, lowered if
+  *                   the slower ADC cannot keep up), the USART BRR for the same
+  *                   baud rate and, through HAL_RCC_ClockConfig(), SysTick.
+  *                   DWT figures are converted with SystemCoreClock and
+  *                   follow by themselves; the cycle profile is cleared.
+  *
+  *                   The switch waits until the queued text has left the
+  *                   UART at the old baud rate and stops the acquisition
+  *                   while the clocks change; the blocks in between are
+  *                   lost. A crystal that does not start leaves the device
+  *                   on the previous profile, and so does a tree whose PCLK
+  *                   cannot make the baud rate within CLK_BAUD_TOLERANCE
+  *                   (HSI8 with 460800 baud or more): the command link
+  *                   would be lost with it.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "clock.h"
+#include "acquisition.h"
+#include "inject.h"
+#include "prof.h"
+#include "samplerate.h"
+#include "uart_tx.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *name;
+  uint32_t sysclk;         /*!< SYSCLK = HCLK in Hz                          */
+  uint8_t hse;             /*!< 1 - crystal oscillator on                    */
+  uint8_t pll;             /*!< 1 - SYSCLK from the PLL, 0 - from HSI        */
+  uint32_t pll_source;     /*!< RCC_PLLSOURCE_x                              */
+  uint32_t pll_mul;        /*!< RCC_PLL_MULx                                 */
+  uint32_t apb1_divider;   /*!< RCC_HCLK_DIVx, PCLK1 at most 36 MHz          */
+  uint32_t apb2_divider;   /*!< RCC_HCLK_DIVx                                */
+  uint32_t adc_divider;    /*!< RCC_ADCPCLK2_DIVx, ADC clock at most 14 MHz  */
+  uint32_t latency;        /*!< FLASH_LATENCY_x for SYSCLK                   */
+} CLK_ConfigTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const CLK_ConfigTypeDef clk_configs[CLK_PROFILE_COUNT] =
+{
+  { "HSI64", (HSI_VALUE / 2U) * 16U, 0U, 1U, RCC_PLLSOURCE_HSI_DIV2, RCC_PLL_MUL16,
+    RCC_HCLK_DIV2, RCC_HCLK_DIV1, RCC_ADCPCLK2_DIV8, FLASH_LATENCY_2 },
+  { "HSE72", HSE_VALUE * 9U, 1U, 1U, RCC_PLLSOURCE_HSE, RCC_PLL_MUL9,
+    RCC_HCLK_DIV2, RCC_HCLK_DIV1, RCC_ADCPCLK2_DIV6, FLASH_LATENCY_2 },
+  { "HSI8", HSI_VALUE, 0U, 0U, RCC_PLLSOURCE_HSI_DIV2, RCC_PLL_MUL2,
+    RCC_HCLK_DIV1, RCC_HCLK_DIV1, RCC_ADCPCLK2_DIV2, FLASH_LATENCY_0 }
+};
+
+static UART_HandleTypeDef *clk_huart = NULL;
+static CLK_ProfileTypeDef clk_profile = CLK_PROFILE_HSI64;
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef CLK_Apply(const CLK_ConfigTypeDef *config);
+static HAL_StatusTypeDef CLK_Drain(void);
+static void CLK_Derive(void);
+static uint8_t CLK_BaudFits(const CLK_ConfigTypeDef *config);
+
+/* Private user code ---------------------------------------------------------*/
+static HAL_StatusTypeDef CLK_Apply(const CLK_ConfigTypeDef *config)
+{
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+  RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
+
+  /* The PLL can only be set up while SYSCLK comes from elsewhere */
+  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+                              |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+  RCC_OscInitStruct.HSEState = (config->hse != 0U) ? RCC_HSE_ON : RCC_HSE_OFF;
+  RCC_OscInitStruct.HSEPredivValue = RCC_HSE_PREDIV_DIV1;
+  RCC_OscInitStruct.PLL.PLLState = (config->pll != 0U) ? RCC_PLL_ON : RCC_PLL_OFF;
+  RCC_OscInitStruct.PLL.PLLSource = config->pll_source;
+  RCC_OscInitStruct.PLL.PLLMUL = config->pll_mul;
+  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  RCC_ClkInitStruct.SYSCLKSource = (config->pll != 0U) ? RCC_SYSCLKSOURCE_PLLCLK : RCC_SYSCLKSOURCE_HSI;
+  RCC_ClkInitStruct.APB1CLKDivider = config->apb1_divider;
+  RCC_ClkInitStruct.APB2CLKDivider = config->apb2_divider;
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, config->latency) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_ADC;
+  PeriphClkInit.AdcClockSelection = config->adc_divider;
+  return HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit);
+}
+
+/* Waits until the transmit ring and the shift register are empty and no
+   injected conversion is under way */
+static HAL_StatusTypeDef CLK_Drain(void)
+{
+  uint32_t start = HAL_GetTick();
+
+  while ((UTX_IsIdle() == 0U) || (INJ_IsIdle() == 0U) ||
+         ((clk_huart != NULL) && (__HAL_UART_GET_FLAG(clk_huart, UART_FLAG_TC) == RESET)))
+  {
+    if ((HAL_GetTick() - start) > CLK_DRAIN_TIMEOUT_MS)
+    {
+      return HAL_BUSY;
+    }
+    INJ_Process();
+  }
+  return HAL_OK;
+}
+
+/* Checks that the tree can clock the bound UART at its baud rate */
+static uint8_t CLK_BaudFits(const CLK_ConfigTypeDef *config)
+{
+  uint32_t divider;
+  uint32_t pclk;
+  uint32_t baud;
+  uint32_t brr;
+  uint32_t actual;
+  uint32_t error;
+
+  if (clk_huart == NULL)
+  {
+    return 1U;
+  }
+
+  /* USART1 is on APB2, the other USARTs on APB1 */
+  divider = (clk_huart->Instance == USART1) ? config->apb2_divider : config->apb1_divider;
+  switch (divider)
+  {
+    case RCC_HCLK_DIV2:
+      pclk = config->sysclk / 2U;
+      break;
+    case RCC_HCLK_DIV4:
+      pclk = config->sysclk / 4U;
+      break;
+    case RCC_HCLK_DIV8:
+      pclk = config->sysclk / 8U;
+      break;
+    case RCC_HCLK_DIV16:
+      pclk = config->sysclk / 16U;
+      break;
+    default:
+      pclk = config->sysclk;
+      break;
+  }
+
+  /* USARTDIV below 1 is not a valid divider */
+  baud = clk_huart->Init.BaudRate;
+  if ((baud == 0U) || ((pclk / 16U) < baud))
+  {
+    return 0U;
+  }
+  brr = UART_BRR_SAMPLING16(pclk, baud);
+  if (brr < 16U)
+  {
+    return 0U;
+  }
+  actual = pclk / brr;
+  error = (actual > baud) ? (actual - baud) : (baud - actual);
+  return (((uint64_t)error * 1000U) <= ((uint64_t)baud * CLK_BAUD_TOLERANCE)) ? 1U : 0U;
+}
+
+/* Recomputes the dividers that depend on the clock tree */
+static void CLK_Derive(void)
+{
+  uint32_t pclk;
+
+  if (clk_huart != NULL)
+  {
+    /* USART1 is on APB2, the other USARTs on APB1 */
+    pclk = (clk_huart->Instance == USART1) ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+    clk_huart->Instance->BRR = UART_BRR_SAMPLING16(pclk, clk_huart->Init.BaudRate);
+  }
+
+  /* The interleaved mode runs without the timer at a fixed sampling time */
+  if (ACQ_GetMode() != ACQ_MODE_DUAL_INTERLEAVED)
+  {
+    (void)SRATE_Refresh();
+  }
+}
+
+/**
+  * @brief  Binds the UART whose baud rate is kept across a switch
+  * @param  huart: initialized UART, or NULL
+  * @retval None
+  */
+void CLK_Init(UART_HandleTypeDef *huart)
+{
+  clk_huart = huart;
+  clk_profile = CLK_PROFILE_HSI64;
+}
+
+/**
+  * @brief  Switches the clock tree
+  * @note   Main loop only. Blocks until the queued UART output is sent
+  *         (up to CLK_DRAIN_TIMEOUT_MS) and stops a running acquisition for
+  *         the switch itself, a few hundred us (up to 100 ms more if the
+  *         crystal is slow to start).
+  * @param  profile: CLK_PROFILE_x
+  * @retval HAL_BUSY if the UART did not drain, HAL_ERROR if the new tree
+  *         cannot keep the baud rate or could not be set up (the previous
+  *         one is kept)
+  */
+HAL_StatusTypeDef CLK_SetProfile(CLK_ProfileTypeDef profile)
+{
+  HAL_StatusTypeDef status;
+  uint8_t running;
+
+  if (profile >= CLK_PROFILE_COUNT)
+  {
+    return HAL_ERROR;
+  }
+  if (profile == clk_profile)
+  {
+    return HAL_OK;
+  }
+  if (CLK_BaudFits(&clk_configs[profile]) == 0U)
+  {
+    return HAL_ERROR;
+  }
+  if (CLK_Drain() != HAL_OK)
+  {
+    return HAL_BUSY;
+  }
+
+  running = ACQ_IsRunning();
+  if (running != 0U)
+  {
+    (void)ACQ_Stop();
+  }
+
+  status = CLK_Apply(&clk_configs[profile]);
+  if (status == HAL_OK)
+  {
+    clk_profile = profile;
+  }
+  else if (CLK_Apply(&clk_configs[clk_profile]) != HAL_OK)
+  {
+    /* HSI is always there */
+    (void)CLK_Apply(&clk_configs[CLK_PROFILE_HSI64]);
+    clk_profile = CLK_PROFILE_HSI64;
+  }
+  CLK_Derive();
+  /* Cycle counts from two clocks do not compare */
+  PROF_Reset();
+
+  if ((running != 0U) && (ACQ_Start() != HAL_OK))
+  {
+    status = HAL_ERROR;
+  }
+  return status;
+}
+
+/**
+  * @brief  Profile in use
+  * @retval CLK_PROFILE_x
+  */
+CLK_ProfileTypeDef CLK_GetProfile(void)
+{
+  return clk_profile;
+}
+
+/**
+  * @brief  Name of a profile, as used by the CLOCK command
+  * @param  profile: CLK_PROFILE_x
+  * @retval Upper-case name, "" for an invalid profile
+  */
+const char *CLK_Name(CLK_ProfileTypeDef profile)
+{
+  return (profile < CLK_PROFILE_COUNT) ? clk_configs[profile].name : "";
+}
@@ -0,0 +1,759 @@
+/**
+  ******************************************************************************
+  * @file           : command.c
+  * @brief          : Runtime commands over USART1 RX.
+  *
+  *                   The receiver runs on a circular DMA channel that is
+  *                   never stopped; the HAL reports the DMA position on the
+  *                   idle line, half and full transfer events and the
+  *                   interrupt only stores it. The main loop copies the new
+  *                   bytes into a line buffer and executes a line when CR or
+  *                   LF arrives, so a slow or half-typed command never holds
+  *                   up the acquisition, and nothing waits for the UART.
+  *
+  *                   Commands (case-insensitive, arguments separated by
+  *                   spaces or commas), answered with "OK ..." or "ERR":
+  *                     RATE <hz>               per-channel sample rate
+  *                     CH <n> [<n> ...]        scan list, ADC_CHANNEL_x
+  *                     FILTER NONE|LOWPASS|NOTCH50|NOTCH60
+  *                     FORMAT TEXT|AC|STREAM|FFT
+  *                     PERIOD <ms>             report period
+  *                     CAL <n> <volts>|CLEAR   calibration point from the
+  *                                             next report window
+  *                     FFT <points> [<rank>]   spectrum record length and
+  *                                             channel (position in CH)
+  *                     LOG [ON [<n>]|OFF|DUMP|ERASE]
+  *                                             flash log of n-scan averages;
+  *                                             no argument: log state
+  *                     PROF [RESET]            DWT cycles per profiled
+  *                                             region (PROF_ENABLE 1)
+  *                     READ <n>                one injected conversion of
+  *                                             ADC_CHANNEL_n, scan running
+  *                     ROBUST <rank> NONE|MEDIAN|TRIM [8|16|32]
+  *                                             spike rejection of a channel
+  *                                             (position in CH), window
+  *                                             of 16 by default
+  *                     AVG <n>                 moving average of the last n
+  *                                             samples per channel, 0: off
+  *                     CLOCK [HSI64|HSE72|HSI8]
+  *                                             clock profile; no argument:
+  *                                             current profile
+  *                     STATUS                  current settings
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "command.h"
+#include "acquisition.h"
+#include "calib.h"
+#include "clock.h"
+#include "datalog.h"
+#include "format.h"
+#include "inject.h"
+#include "prof.h"
+#include "spectrum.h"
+#include "stream.h"
+#include "uart_tx.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CMD_REPLY_MAX          96U
+/* Longest STATUS reply: "OK RATE " 8, rate 11, " Hz CH" 6, " 17" per
+   channel, " FILTER " 8, name 7, " FORMAT " 8, name 6, " PERIOD " 8,
+   period 10, " ms\r\n" 5 */
+#define CMD_STATUS_MAX         (77U + (3U * ACQ_MAX_CHANNELS))
+/* READ answers ERR if its injected conversion has not finished by then;
+   the queued ones take a few tens of us each */
+#define CMD_READ_TIMEOUT_MS    5U
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef *cmd_huart = NULL;
+static CMD_SettingsTypeDef *cmd_settings = NULL;
+static uint8_t cmd_rx_buffer[CMD_RX_BUFFER_SIZE];
+/* Written by the RX interrupt, read by the main loop */
+static volatile uint16_t cmd_rx_head = 0U;
+static uint16_t cmd_rx_tail = 0U;
+static char cmd_line[CMD_LINE_MAX + 1U];
+static uint8_t cmd_line_length = 0U;
+static uint8_t cmd_line_overlong = 0U;
+static CMD_StatsTypeDef cmd_stats;
+/* READ in flight, answered by CMD_ReadProcess() */
+static INJ_RequestTypeDef cmd_read_request;
+static uint8_t cmd_read_pending = 0U;
+static uint32_t cmd_read_tick = 0U;
+
+static const char *const cmd_filter_names[FLT_PRESET_COUNT] =
+{
+  "NONE", "LOWPASS", "NOTCH50", "NOTCH60"
+};
+static const char *const cmd_format_names[] =
+{
+  "TEXT", "AC", "STREAM", "FFT"
+};
+
+static const char *const cmd_robust_names[ROB_MODE_COUNT] =
+{
+  "NONE", "MEDIAN", "TRIM"
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef CMD_StartReceive(void);
+static uint8_t CMD_Match(const char *token, const char *name);
+static uint8_t CMD_ParseUint(const char *token, uint32_t *value);
+static uint8_t CMD_ParseMicrovolts(const char *token, uint32_t *microvolts);
+static uint8_t CMD_Split(char *line, char **argv);
+static uint8_t CMD_Execute(uint8_t argc, char **argv);
+static void CMD_Reply(const char *text, uint16_t length);
+static void CMD_Status(void);
+static void CMD_LogStatus(void);
+static void CMD_Profile(void);
+static uint8_t CMD_Read(uint8_t channel);
+static void CMD_ReadReply(uint8_t channel, uint16_t raw);
+static void CMD_Clock(void);
+
+/* Private user code ---------------------------------------------------------*/
+static HAL_StatusTypeDef CMD_StartReceive(void)
+{
+  cmd_rx_head = 0U;
+  cmd_rx_tail = 0U;
+  return HAL_UARTEx_ReceiveToIdle_DMA(cmd_huart, cmd_rx_buffer, CMD_RX_BUFFER_SIZE);
+}
+
+/* Case-insensitive compare of a token with an upper-case name */
+static uint8_t CMD_Match(const char *token, const char *name)
+{
+  while ((*token != '\0') && (*name != '\0'))
+  {
+    char c = *token;
+
+    if ((c >= 'a') && (c <= 'z'))
+    {
+      c = (char)(c - ('a' - 'A'));
+    }
+    if (c != *name)
+    {
+      return 0U;
+    }
+    token++;
+    name++;
+  }
+  return ((*token == '\0') && (*name == '\0')) ? 1U : 0U;
+}
+
+static uint8_t CMD_ParseUint(const char *token, uint32_t *value)
+{
+  uint32_t result = 0U;
+
+  if (*token == '\0')
+  {
+    return 0U;
+  }
+  for (; *token != '\0'; token++)
+  {
+    uint32_t digit = (uint32_t)(*token - '0');
+
+    if ((digit > 9U) || (result > ((UINT32_MAX - digit) / 10U)))
+    {
+      return 0U;
+    }
+    result = (result * 10U) + digit;
+  }
+  *value = result;
+  return 1U;
+}
+
+/* Decimal volts with up to 6 decimals, e.g. "2.5" or "0.125000" */
+static uint8_t CMD_ParseMicrovolts(const char *token, uint32_t *microvolts)
+{
+  uint32_t volts = 0U;
+  uint32_t fraction = 0U;
+  uint32_t scale = 1000000U;
+  uint8_t digits = 0U;
+
+  for (; (*token >= '0') && (*token <= '9'); token++)
+  {
+    volts = (volts * 10U) + (uint32_t)(*token - '0');
+    digits++;
+    if (volts > 100U)
+    {
+      return 0U;
+    }
+  }
+  if (*token == '.')
+  {
+    for (token++; (*token >= '0') && (*token <= '9'); token++)
+    {
+      if (scale > 1U)
+      {
+        scale /= 10U;
+        fraction += (uint32_t)(*token - '0') * scale;
+      }
+      digits++;
+    }
+  }
+  if ((*token != '\0') || (digits == 0U))
+  {
+    return 0U;
+  }
+  *microvolts = (volts * 1000000U) + fraction;
+  return 1U;
+}
+
+/* Splits a line in place at spaces, tabs and commas; 0 for a blank line,
+   CMD_MAX_ARGS + 1 for a line with too many arguments */
+static uint8_t CMD_Split(char *line, char **argv)
+{
+  uint8_t argc = 0U;
+
+  while (*line != '\0')
+  {
+    while ((*line == ' ') || (*line == '\t') || (*line == ','))
+    {
+      *line++ = '\0';
+    }
+    if (*line == '\0')
+    {
+      break;
+    }
+    if (argc == CMD_MAX_ARGS)
+    {
+      return (uint8_t)(CMD_MAX_ARGS + 1U);
+    }
+    argv[argc++] = line;
+    while ((*line != '\0') && (*line != ' ') && (*line != '\t') && (*line != ','))
+    {
+      line++;
+    }
+  }
+  return argc;
+}
+
+static void CMD_Reply(const char *text, uint16_t length)
+{
+  (void)UTX_Write(text, length);
+}
+
+static void CMD_Status(void)
+{
+  uint8_t channels[ACQ_MAX_CHANNELS];
+  uint8_t count = ACQ_GetChannels(channels);
+  char msg[CMD_STATUS_MAX];
+  char *p = msg;
+
+  p = FMT_Str(p, "OK RATE ");
+  p = FMT_Fixed(p, ACQ_GetSampleRateMilliHz(), 3U);
+  p = FMT_Str(p, " Hz CH");
+  for (uint8_t i = 0U; i < count; i++)
+  {
+    p = FMT_Str(p, " ");
+    p = FMT_Uint(p, channels[i]);
+  }
+  p = FMT_Str(p, " FILTER ");
+  p = FMT_Str(p, cmd_filter_names[cmd_settings->filter]);
+  p = FMT_Str(p, " FORMAT ");
+  p = FMT_Str(p, cmd_format_names[cmd_settings->format]);
+  p = FMT_Str(p, " PERIOD ");
+  p = FMT_Uint(p, cmd_settings->report_ms);
+  p = FMT_Str(p, " ms\r\n");
+  CMD_Reply(msg, (uint16_t)(p - msg));
+}
+
+static void CMD_LogStatus(void)
+{
+  LOG_StatsTypeDef stats;
+  char msg[CMD_REPLY_MAX];
+  char *p = msg;
+
+  LOG_GetStats(&stats);
+  p = FMT_Str(p, (LOG_IsRunning() != 0U) ? "OK LOG ON PAGES " : "OK LOG OFF PAGES ");
+  p = FMT_Uint(p, stats.pages);
+  p = FMT_Str(p, " SCANS ");
+  p = FMT_Uint(p, stats.scans);
+  p = FMT_Str(p, " BITS/SAMPLE ");
+  p = FMT_Fixed(p, (stats.samples != 0U) ?
+                (uint32_t)(((uint64_t)stats.nibbles * 400U) / stats.samples) : 0U, 2U);
+  p = FMT_Str(p, " DROPPED ");
+  p = FMT_Uint(p, stats.dropped_scans);
+  p = FMT_Str(p, "\r\n");
+  CMD_Reply(msg, (uint16_t)(p - msg));
+}
+
+/* Converts one channel on the injected group and replies with the value */
+/* Queues the conversion; the reply follows from CMD_ReadProcess() */
+static uint8_t CMD_Read(uint8_t channel)
+{
+  if ((cmd_read_pending != 0U) || (INJ_Submit(&cmd_read_request, channel) != HAL_OK))
+  {
+    return 0U;
+  }
+  cmd_read_pending = 1U;
+  cmd_read_tick = HAL_GetTick();
+  return 1U;
+}
+
+static void CMD_ReadReply(uint8_t channel, uint16_t raw)
+{
+  char msg[CMD_REPLY_MAX];
+  char *p = msg;
+
+  p = FMT_Str(p, "OK READ CH");
+  p = FMT_Uint(p, channel);
+  p = FMT_Str(p, " ");
+  p = FMT_Volts(p, CAL_ToMicrovolts(channel, raw, 0U), 4U);
+  p = FMT_Str(p, " V RAW ");
+  p = FMT_Uint(p, raw);
+  p = FMT_Str(p, "\r\n");
+  CMD_Reply(msg, (uint16_t)(p - msg));
+}
+
+/* Profile with the resulting core and ADC clocks */
+static void CMD_Clock(void)
+{
+  char msg[CMD_REPLY_MAX];
+  char *p = msg;
+
+  p = FMT_Str(p, "OK CLOCK ");
+  p = FMT_Str(p, CLK_Name(CLK_GetProfile()));
+  p = FMT_Str(p, " SYSCLK ");
+  p = FMT_Uint(p, SystemCoreClock / 1000000U);
+  p = FMT_Str(p, " MHz ADC ");
+  p = FMT_Fixed(p, HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_ADC) / 1000U, 3U);
+  p = FMT_Str(p, " MHz RATE ");
+  p = FMT_Fixed(p, ACQ_GetSampleRateMilliHz(), 3U);
+  p = FMT_Str(p, " Hz\r\n");
+  CMD_Reply(msg, (uint16_t)(p - msg));
+}
+
+/* One line per region, then OK with the core clock */
+static void CMD_Profile(void)
+{
+  PROF_StatsTypeDef stats;
+  char msg[CMD_REPLY_MAX];
+  char *p;
+
+  for (uint8_t i = 0U; i < (uint8_t)PROF_REGION_COUNT; i++)
+  {
+    PROF_Get((PROF_RegionTypeDef)i, &stats);
+    p = FMT_Str(msg, "PROF ");
+    p = FMT_Str(p, PROF_Name((PROF_RegionTypeDef)i));
+    p = FMT_Str(p, " N ");
+    p = FMT_Uint(p, stats.count);
+    p = FMT_Str(p, " MIN ");
+    p = FMT_Uint(p, stats.min);
+    p = FMT_Str(p, " AVG ");
+    p = FMT_Uint(p, (stats.count != 0U) ? (uint32_t)(stats.total / stats.count) : 0U);
+    p = FMT_Str(p, " MAX ");
+    p = FMT_Uint(p, stats.max);
+    p = FMT_Str(p, "\r\n");
+    CMD_Reply(msg, (uint16_t)(p - msg));
+  }
+  p = FMT_Str(msg, "OK PROF CYCLES AT ");
+  p = FMT_Uint(p, SystemCoreClock / 1000000U);
+  p = FMT_Str(p, " MHz\r\n");
+  CMD_Reply(msg, (uint16_t)(p - msg));
+}
+
+/* Returns 1 if the command was accepted; replies to the accepted ones */
+static uint8_t CMD_Execute(uint8_t argc, char **argv)
+{
+  CMD_SettingsTypeDef *settings = cmd_settings;
+  uint32_t value;
+
+  if ((CMD_Match(argv[0], "STATUS") != 0U) && (argc == 1U))
+  {
+    CMD_Status();
+    return 1U;
+  }
+
+  if ((CMD_Match(argv[0], "RATE") != 0U) && (argc == 2U))
+  {
+    if ((CMD_ParseUint(argv[1], &value) == 0U) || (value == 0U) ||
+        (ACQ_SetSampleRate(value) != HAL_OK))
+    {
+      return 0U;
+    }
+    settings->restart = 1U;
+  }
+  else if ((CMD_Match(argv[0], "CH") != 0U) && (argc >= 2U))
+  {
+    uint8_t channels[ACQ_MAX_CHANNELS];
+    uint8_t count = (uint8_t)(argc - 1U);
+
+    if (count > ACQ_MAX_CHANNELS)
+    {
+      return 0U;
+    }
+    for (uint8_t i = 0U; i < count; i++)
+    {
+      if ((CMD_ParseUint(argv[i + 1U], &value) == 0U) || !IS_ACQ_CHANNEL(value))
+      {
+        return 0U;
+      }
+      channels[i] = (uint8_t)value;
+    }
+    /* Rejects a repeated channel; stops and restarts the DMA, the blocks
+       in between are lost */
+    if (ACQ_ConfigChannels(channels, count) != HAL_OK)
+    {
+      return 0U;
+    }
+    settings->restart = 1U;
+  }
+  else if ((CMD_Match(argv[0], "FILTER") != 0U) && (argc == 2U))
+  {
+    uint8_t preset = 0U;
+
+    while ((preset < FLT_PRESET_COUNT) && (CMD_Match(argv[1], cmd_filter_names[preset]) == 0U))
+    {
+      preset++;
+    }
+    if (preset == FLT_PRESET_COUNT)
+    {
+      return 0U;
+    }
+    settings->filter = (FLT_PresetTypeDef)preset;
+    settings->restart = 1U;
+  }
+  else if ((CMD_Match(argv[0], "FORMAT") != 0U) && (argc == 2U))
+  {
+    if (CMD_Match(argv[1], "TEXT") != 0U)
+    {
+      settings->format = CMD_FORMAT_TEXT;
+    }
+    else if (CMD_Match(argv[1], "AC") != 0U)
+    {
+      settings->format = CMD_FORMAT_AC;
+    }
+    else if (CMD_Match(argv[1], "STREAM") != 0U)
+    {
+      settings->format = CMD_FORMAT_STREAM;
+    }
+    else if (CMD_Match(argv[1], "FFT") != 0U)
+    {
+      settings->format = CMD_FORMAT_FFT;
+    }
+    else
+    {
+      return 0U;
+    }
+    STREAM_Enable((settings->format == CMD_FORMAT_STREAM) ? 1U : 0U);
+    SPEC_Enable((settings->format == CMD_FORMAT_FFT) ? 1U : 0U);
+    settings->restart = 1U;
+  }
+  else if ((CMD_Match(argv[0], "PERIOD") != 0U) && (argc == 2U))
+  {
+    if ((CMD_ParseUint(argv[1], &value) == 0U) ||
+        (value < CMD_PERIOD_MIN_MS) || (value > CMD_PERIOD_MAX_MS))
+    {
+      return 0U;
+    }
+    settings->report_ms = value;
+    settings->restart = 1U;
+  }
+  else if ((CMD_Match(argv[0], "CAL") != 0U) && (argc == 3U))
+  {
+    if ((CMD_ParseUint(argv[1], &value) == 0U) || (value >= CAL_CHANNELS))
+    {
+      return 0U;
+    }
+    if (CMD_Match(argv[2], "CLEAR") != 0U)
+    {
+      if (CAL_Clear((uint8_t)value) != HAL_OK)
+      {
+        return 0U;
+      }
+    }
+    else
+    {
+      uint32_t microvolts;
+
+      if (CMD_ParseMicrovolts(argv[2], &microvolts) == 0U)
+      {
+        return 0U;
+      }
+      /* The main loop takes the point at the end of the report window and
+         answers then */
+      settings->cal_channel = (uint8_t)value;
+      settings->cal_microvolts = microvolts;
+      settings->cal_pending = 1U;
+      return 1U;
+    }
+  }
+  else if ((CMD_Match(argv[0], "FFT") != 0U) && ((argc == 2U) || (argc == 3U)))
+  {
+    uint32_t rank = 0U;
+
+    if ((CMD_ParseUint(argv[1], &value) == 0U) ||
+        ((argc == 3U) && (CMD_ParseUint(argv[2], &rank) == 0U)) ||
+        (value > SPEC_MAX_POINTS) || (rank >= ACQ_MAX_CHANNELS) ||
+        (SPEC_Config((uint16_t)value, (uint8_t)rank) != HAL_OK))
+    {
+      return 0U;
+    }
+  }
+  else if ((CMD_Match(argv[0], "PROF") != 0U) && (argc <= 2U))
+  {
+    if (PROF_ENABLE == 0)
+    {
+      CMD_Reply("OK PROF OFF\r\n", 13U);
+      return 1U;
+    }
+    if (argc == 1U)
+    {
+      CMD_Profile();
+      return 1U;
+    }
+    if (CMD_Match(argv[1], "RESET") == 0U)
+    {
+      return 0U;
+    }
+    PROF_Reset();
+  }
+  else if ((CMD_Match(argv[0], "READ") != 0U) && (argc == 2U))
+  {
+    if ((CMD_ParseUint(argv[1], &value) == 0U) || !IS_ACQ_CHANNEL(value))
+    {
+      return 0U;
+    }
+    return CMD_Read((uint8_t)value);
+  }
+  else if ((CMD_Match(argv[0], "ROBUST") != 0U) && ((argc == 3U) || (argc == 4U)))
+  {
+    uint8_t mode = 0U;
+    uint32_t window = ROB_DEFAULT_WINDOW;
+
+    while ((mode < (uint8_t)ROB_MODE_COUNT) && (CMD_Match(argv[2], cmd_robust_names[mode]) == 0U))
+    {
+      mode++;
+    }
+    if ((CMD_ParseUint(argv[1], &value) == 0U) || (value >= ROB_MAX_CHANNELS) ||
+        (mode == (uint8_t)ROB_MODE_COUNT) ||
+        ((argc == 4U) && (CMD_ParseUint(argv[3], &window) == 0U)) || !IS_ROB_WINDOW(window))
+    {
+      return 0U;
+    }
+    settings->robust[value].mode = (ROB_ModeTypeDef)mode;
+    settings->robust[value].window = (uint8_t)window;
+    settings->restart = 1U;
+  }
+  else if ((CMD_Match(argv[0], "AVG") != 0U) && (argc == 2U))
+  {
+    if ((CMD_ParseUint(argv[1], &value) == 0U) || (value > UINT16_MAX))
+    {
+      return 0U;
+    }
+    settings->avg_window = (uint16_t)value;
+    settings->restart = 1U;
+  }
+  else if ((CMD_Match(argv[0], "CLOCK") != 0U) && (argc <= 2U))
+  {
+    if (argc == 2U)
+    {
+      uint8_t profile = 0U;
+
+      while ((profile < (uint8_t)CLK_PROFILE_COUNT) &&
+             (CMD_Match(argv[1], CLK_Name((CLK_ProfileTypeDef)profile)) == 0U))
+      {
+        profile++;
+      }
+      /* The reply goes out at the same baud rate on the new clocks */
+      if ((profile == (uint8_t)CLK_PROFILE_COUNT) ||
+          (CLK_SetProfile((CLK_ProfileTypeDef)profile) != HAL_OK))
+      {
+        return 0U;
+      }
+      settings->restart = 1U;
+    }
+    CMD_Clock();
+    return 1U;
+  }
+  else if (CMD_Match(argv[0], "LOG") != 0U)
+  {
+    if (argc == 1U)
+    {
+      CMD_LogStatus();
+      return 1U;
+    }
+    if ((CMD_Match(argv[1], "ON") != 0U) && (argc <= 3U))
+    {
+      value = LOG_DEFAULT_DECIMATION;
+      if (((argc == 3U) && (CMD_ParseUint(argv[2], &value) == 0U)) ||
+          (value > LOG_MAX_DECIMATION) || (LOG_Start((uint16_t)value) != HAL_OK))
+      {
+        return 0U;
+      }
+    }
+    else if ((CMD_Match(argv[1], "OFF") != 0U) && (argc == 2U))
+    {
+      LOG_Stop();
+    }
+    else if ((CMD_Match(argv[1], "DUMP") != 0U) && (argc == 2U))
+    {
+      /* The frames follow the reply once the pending flash writes are done */
+      if (LOG_Dump() != HAL_OK)
+      {
+        return 0U;
+      }
+    }
+    else if ((CMD_Match(argv[1], "ERASE") != 0U) && (argc == 2U))
+    {
+      if (LOG_Erase() != HAL_OK)
+      {
+        return 0U;
+      }
+    }
+    else
+    {
+      return 0U;
+    }
+  }
+  else
+  {
+    return 0U;
+  }
+
+  CMD_Reply("OK\r\n", 4U);
+  return 1U;
+}
+
+/**
+  * @brief  Starts the reception of commands
+  * @param  huart: USART1 handle, RX DMA channel linked in circular mode
+  * @param  settings: settings the commands change, owned by the caller
+  * @retval HAL status
+  */
+HAL_StatusTypeDef CMD_Init(UART_HandleTypeDef *huart, CMD_SettingsTypeDef *settings)
+{
+  cmd_huart = huart;
+  cmd_settings = settings;
+  cmd_line_length = 0U;
+  cmd_line_overlong = 0U;
+  return CMD_StartReceive();
+}
+
+/**
+  * @brief  Executes the complete lines received so far
+  * @note   Call from the main loop; never waits for the UART.
+  * @retval None
+  */
+void CMD_Process(void)
+{
+  uint16_t head;
+
+  if (cmd_huart == NULL)
+  {
+    return;
+  }
+  /* A receive error ends the DMA reception in the HAL: start over */
+  if (cmd_huart->RxState == HAL_UART_STATE_READY)
+  {
+    cmd_line_length = 0U;
+    (void)CMD_StartReceive();
+    return;
+  }
+
+  head = cmd_rx_head;
+  while (cmd_rx_tail != head)
+  {
+    char c = (char)cmd_rx_buffer[cmd_rx_tail];
+
+    cmd_rx_tail = (uint16_t)((cmd_rx_tail + 1U) % CMD_RX_BUFFER_SIZE);
+    if ((c != '\r') && (c != '\n'))
+    {
+      if (cmd_line_length < CMD_LINE_MAX)
+      {
+        cmd_line[cmd_line_length++] = c;
+      }
+      else
+      {
+        cmd_line_overlong = 1U;
+      }
+      continue;
+    }
+
+    if (cmd_line_overlong != 0U)
+    {
+      cmd_stats.overlong++;
+      CMD_Reply("ERR\r\n", 5U);
+    }
+    else if (cmd_line_length != 0U)
+    {
+      char *argv[CMD_MAX_ARGS];
+      uint8_t argc;
+
+      cmd_line[cmd_line_length] = '\0';
+      argc = CMD_Split(cmd_line, argv);
+      if (argc != 0U)
+      {
+        cmd_stats.commands++;
+        if ((argc > CMD_MAX_ARGS) || (CMD_Execute(argc, argv) == 0U))
+        {
+          cmd_stats.rejected++;
+          CMD_Reply("ERR\r\n", 5U);
+        }
+      }
+    }
+    cmd_line_length = 0U;
+    cmd_line_overlong = 0U;
+  }
+}
+
+/**
+  * @brief  Answers a READ once its injected conversion has finished
+  * @note   Call from the main loop, which SCHED_EVENT_INJECTED wakes when
+  *         the conversion ends.
+  * @retval None
+  */
+void CMD_ReadProcess(void)
+{
+  if (cmd_read_pending == 0U)
+  {
+    return;
+  }
+  if (cmd_read_request.state == INJ_STATE_DONE)
+  {
+    CMD_ReadReply(cmd_read_request.channel, cmd_read_request.value);
+  }
+  else if ((cmd_read_request.state == INJ_STATE_ERROR) ||
+           ((HAL_GetTick() - cmd_read_tick) > CMD_READ_TIMEOUT_MS))
+  {
+    cmd_stats.rejected++;
+    CMD_Reply("ERR\r\n", 5U);
+  }
+  else
+  {
+    return;
+  }
+  cmd_read_pending = 0U;
+}
+
+/**
+  * @brief  Copies the command counters
+  * @param  stats: destination
+  * @retval None
+  */
+void CMD_GetStats(CMD_StatsTypeDef *stats)
+{
+  *stats = cmd_stats;
+}
+
+/**
+  * @brief  Takes the DMA position of a reception event (interrupt)
+  * @param  position: bytes written into the buffer, 1..CMD_RX_BUFFER_SIZE
+  * @retval None
+  */
+void CMD_RxEventHandler(uint16_t position)
+{
+  cmd_rx_head = (uint16_t)(position % CMD_RX_BUFFER_SIZE);
+}
+
+/**
+  * @brief  Counts a receive error; CMD_Process restarts the reception
+  * @retval None
+  */
+void CMD_ErrorHandler(void)
+{
+  if ((cmd_huart != NULL) && (cmd_huart->RxState == HAL_UART_STATE_READY))
+  {
+    cmd_stats.rx_errors++;
+  }
+}
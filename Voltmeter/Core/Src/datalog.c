@@ -0,0 +1,980 @@
+/**
+  ******************************************************************************
+  * @file           : datalog.c
+  * @brief          : Compressed sample log in on-chip flash.
+  *
+  *                   Every decimation scans of the acquisition are averaged
+  *                   into one 12-bit scan, which is appended to a ring of the
+  *                   1 KB flash pages between the end of the program image
+  *                   and the emulated EEPROM. A page holds:
+  *
+  *                        0  u16  magic 0x474C ("LG")
+  *                        2  u8   channels N, u8 format version
+  *                        4  u32  page sequence number, +1 per page
+  *                        8  u32  HAL tick (ms) of the first scan
+  *                       12  u32  logged scan rate in mHz
+  *                       16  u8   ADC channel numbers [12]
+  *                       28  u16  CRC-16 of bytes 0..27
+  *                       30  ...  payload, 4-bit units (nibbles)
+  *                     1020  u16  payload nibble count, 0xFFFF while open
+  *                     1022  u16  CRC-16 of the payload halfwords
+  *
+  *                   Each sample is stored as the difference to the
+  *                   previous sample of its channel (2048 at the start of a
+  *                   page, so every page decodes on its own), zigzag mapped
+  *                   to an unsigned value and written 3 bits per nibble, the
+  *                   fourth bit set when more nibbles follow. A slow signal
+  *                   takes 1..2 nibbles per sample instead of 12 bits. Nibble
+  *                   k is bits 4 * (k % 4) of payload halfword k / 4. A
+  *                   difference needs at most 5 nibbles and only the last
+  *                   one has bit 3 clear, so 0xFFFF never occurs in a
+  *                   payload: an open page ends at its first erased
+  *                   halfword, which is how a page left open by a reset is
+  *                   closed again at start-up.
+  *
+  *                   The flash is written from the main loop through a
+  *                   queue, LOG_PROGRAM_BURST halfwords per LOG_Process call.
+  *                   A page erase stops the CPU (not the DMA) for about
+  *                   20 ms; it runs alone, right after a block was taken, so
+  *                   the next half-buffer has the most time left, and the
+  *                   next page is erased once the current one is half full.
+  *                   A block the DMA overwrote meanwhile only leaves its
+  *                   scans out of the average, the logged scans stay evenly
+  *                   spaced. A scan without any valid sample, or one the
+  *                   queue has no room for, is dropped and closes the page:
+  *                   the next page starts with a fresh timestamp.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog.h"
+#include "eeprom.h"
+#include "stream_frame.h"
+#include "uart_tx.h"
+
+/* Private define ------------------------------------------------------------*/
+#define LOG_MAGIC              0x474CU
+#define LOG_VERSION            1U
+#define LOG_ERASED             0xFFFFU
+
+#define LOG_HEADER_CRC         28U
+#define LOG_PAYLOAD            30U
+#define LOG_TRAILER            (LOG_PAGE_SIZE - 4U)
+#define LOG_PAYLOAD_NIBBLES    (((LOG_TRAILER - LOG_PAYLOAD) / 2U) * 4U)
+
+#define LOG_PREDICT_START      2048U
+#define LOG_NIBBLE_BITS        3U
+#define LOG_NIBBLE_MORE        0x08U
+/* A 12-bit difference zigzags to 13 bits */
+#define LOG_MAX_NIBBLES        5U
+#define LOG_SCAN_NIBBLES       (LOG_MAX_NIBBLES * ACQ_MAX_CHANNELS)
+
+/* Queue entries of LOG_ClosePage(): last halfword and trailer */
+#define LOG_CLOSE_ENTRIES      2U
+/* Queue entries one scan may need: the scan itself, closing the page,
+   erasing the next one and its header; plus one more close, so that
+   LOG_Block() and LOG_Stop() always find room to close the page */
+#define LOG_SCAN_RESERVE       (((LOG_SCAN_NIBBLES + 3U) / 4U) + LOG_CLOSE_ENTRIES + 1U + \
+                                (LOG_PAYLOAD / 2U) + LOG_CLOSE_ENTRIES)
+
+/* Logged scans one block can produce */
+#define LOG_OUT_SIZE           ((ACQ_BUFFER_SIZE / 2U) / LOG_MIN_DECIMATION)
+
+#if (LOG_QUEUE_SIZE < LOG_SCAN_RESERVE)
+#error "LOG_QUEUE_SIZE cannot hold one scan and a page change"
+#endif
+#if (SFRAME_ENCODED_MAX > UTX_BUFFER_SIZE)
+#error "UTX_BUFFER_SIZE cannot hold one log frame"
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+#define LOG_HALFWORD(address)  (*(__IO uint16_t *)(address))
+#define LOG_WORD(address)      (*(__IO uint32_t *)(address))
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  LOG_OP_PROGRAM = 0U,     /* halfword data at address                    */
+  LOG_OP_ERASE,            /* page at address                             */
+  LOG_OP_TRAILER           /* data nibbles and payload CRC of page address */
+} LOG_OpCodeTypeDef;
+
+typedef struct
+{
+  uint32_t address;
+  uint16_t data;
+  uint8_t op;
+} LOG_OpTypeDef;
+
+typedef enum
+{
+  LOG_DUMP_IDLE = 0U,
+  LOG_DUMP_WAIT,           /* for the queue to drain                      */
+  LOG_DUMP_RUN
+} LOG_DumpStateTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+/* Program image end, from the linker script (see the startup code) */
+extern uint32_t _sidata;
+extern uint32_t _sdata;
+extern uint32_t _edata;
+
+static uint32_t log_base = 0U;         /* first page of the ring */
+static uint32_t log_pages = 0U;        /* 0 before LOG_Init or without room */
+static uint32_t log_head = 0U;         /* page written last */
+static uint32_t log_sequence = 0U;     /* its sequence number */
+
+/* Page being written */
+static uint8_t log_open = 0U;
+static uint16_t log_nibbles = 0U;
+static uint16_t log_word = 0U;
+static uint8_t log_word_nibbles = 0U;
+static uint16_t log_predict[ACQ_MAX_CHANNELS];
+
+/* Decimation */
+static uint8_t log_running = 0U;
+static uint8_t log_touched = 0U;
+static uint8_t log_after_block = 0U;
+static uint16_t log_decimation = LOG_DEFAULT_DECIMATION;
+static uint8_t log_channels = 0U;
+static uint8_t log_channel_list[ACQ_MAX_CHANNELS];
+static uint32_t log_rate_mhz = 0U;
+/* Sums of the scan being averaged, and the same with the current block
+   until LOG_Release() confirms it */
+static uint32_t log_acc[ACQ_MAX_CHANNELS];
+static uint16_t log_count = 0U;        /* scans summed in log_acc */
+static uint16_t log_phase = 0U;        /* scans since the last logged one */
+static uint32_t log_block_acc[ACQ_MAX_CHANNELS];
+static uint16_t log_block_count = 0U;
+static uint16_t log_block_phase = 0U;
+static uint16_t log_block_scans = 0U;
+static uint16_t log_out[LOG_OUT_SIZE];
+static uint16_t log_out_scans = 0U;
+static uint64_t log_time_base_us = 0U;
+static uint32_t log_time_scans = 0U;   /* logged scans since log_time_base_us */
+static uint8_t log_gap = 0U;
+static uint8_t log_next_erased = 0U;   /* page after log_head queued for erase */
+
+/* Flash operations */
+static LOG_OpTypeDef log_queue[LOG_QUEUE_SIZE];
+static uint16_t log_queue_head = 0U;
+static uint16_t log_queue_count = 0U;
+static uint32_t log_erase_left = 0U;
+
+/* Dump */
+static LOG_DumpStateTypeDef log_dump_state = LOG_DUMP_IDLE;
+static uint32_t log_dump_index = 0U;   /* pages walked */
+static uint32_t log_dump_page = 0U;    /* page being sent, 0 for none */
+static uint16_t log_dump_pos = 0U;     /* next nibble */
+static uint16_t log_dump_end = 0U;
+static uint32_t log_dump_scan = 0U;    /* scans of the page already sent */
+static uint16_t log_dump_predict[ACQ_MAX_CHANNELS];
+static uint8_t log_frame[SFRAME_ENCODED_MAX];
+static uint16_t log_frame_length = 0U;
+
+static LOG_StatsTypeDef log_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t LOG_PageAddress(uint32_t index);
+static uint8_t LOG_IsBlank(uint32_t page);
+static uint8_t LOG_HeaderValid(uint32_t page);
+static uint16_t LOG_OpenNibbles(uint32_t page);
+static uint16_t LOG_PayloadCrc(uint32_t page, uint16_t nibbles);
+static void LOG_Push(uint8_t op, uint32_t address, uint16_t data);
+static HAL_StatusTypeDef LOG_Execute(const LOG_OpTypeDef *op);
+static void LOG_Restart(void);
+static void LOG_OpenPage(uint64_t time_us);
+static void LOG_ClosePage(void);
+static void LOG_PushNibble(uint8_t nibble);
+static uint8_t LOG_EncodeScan(const uint16_t *scan, uint8_t *nibbles);
+static void LOG_Append(const uint16_t *scan, uint64_t time_us);
+static void LOG_Emit(const uint16_t *scan);
+static uint8_t LOG_Nibble(uint32_t page, uint16_t pos);
+static uint8_t LOG_DecodeScan(uint16_t *scan);
+static uint8_t LOG_DumpLoadPage(uint32_t page);
+static void LOG_DumpNext(void);
+
+/* Private user code ---------------------------------------------------------*/
+static uint32_t LOG_PageAddress(uint32_t index)
+{
+  return log_base + (index * LOG_PAGE_SIZE);
+}
+
+static uint8_t LOG_IsBlank(uint32_t page)
+{
+  for (uint32_t offset = 0U; offset < LOG_PAGE_SIZE; offset += 4U)
+  {
+    if (LOG_WORD(page + offset) != 0xFFFFFFFFU)
+    {
+      return 0U;
+    }
+  }
+  return 1U;
+}
+
+static uint8_t LOG_HeaderValid(uint32_t page)
+{
+  const uint8_t *header = (const uint8_t *)page;
+
+  return (uint8_t)((LOG_HALFWORD(page) == LOG_MAGIC) && (header[3] == LOG_VERSION) &&
+                   (header[2] != 0U) && (header[2] <= ACQ_MAX_CHANNELS) &&
+                   (LOG_HALFWORD(page + 12U) != 0U) &&
+                   (SFRAME_Crc16(header, LOG_HEADER_CRC) == LOG_HALFWORD(page + LOG_HEADER_CRC)));
+}
+
+/* Payload of a page left open: everything before the first erased halfword */
+static uint16_t LOG_OpenNibbles(uint32_t page)
+{
+  uint32_t address = page + LOG_PAYLOAD;
+
+  while ((address < (page + LOG_TRAILER)) && (LOG_HALFWORD(address) != LOG_ERASED))
+  {
+    address += 2U;
+  }
+  return (uint16_t)(((address - (page + LOG_PAYLOAD)) / 2U) * 4U);
+}
+
+static uint16_t LOG_PayloadCrc(uint32_t page, uint16_t nibbles)
+{
+  return SFRAME_Crc16((const uint8_t *)(page + LOG_PAYLOAD),
+                      (uint16_t)(((nibbles + 3U) / 4U) * 2U));
+}
+
+/* The callers check for room first: LOG_Append() takes a scan only with
+   LOG_SCAN_RESERVE entries free, which leaves LOG_CLOSE_ENTRIES for the
+   next close of the page it opened or extended */
+static void LOG_Push(uint8_t op, uint32_t address, uint16_t data)
+{
+  LOG_OpTypeDef *entry = &log_queue[(log_queue_head + log_queue_count) % LOG_QUEUE_SIZE];
+
+  entry->address = address;
+  entry->data = data;
+  entry->op = op;
+  log_queue_count++;
+}
+
+static HAL_StatusTypeDef LOG_Execute(const LOG_OpTypeDef *op)
+{
+  FLASH_EraseInitTypeDef erase = {0};
+  uint32_t error = 0U;
+  HAL_StatusTypeDef status;
+
+  HAL_FLASH_Unlock();
+  if (op->op == LOG_OP_ERASE)
+  {
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.PageAddress = op->address;
+    erase.NbPages = 1U;
+    status = HAL_FLASHEx_Erase(&erase, &error);
+    log_stats.erases++;
+  }
+  else if (op->op == LOG_OP_TRAILER)
+  {
+    /* Count first: a page with a count but no CRC is rejected by the dump,
+       one without a count is closed again by LOG_Init */
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, op->address + LOG_TRAILER, op->data);
+    if (status == HAL_OK)
+    {
+      status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, op->address + LOG_TRAILER + 2U,
+                                 LOG_PayloadCrc(op->address, op->data));
+    }
+  }
+  else
+  {
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, op->address, op->data);
+  }
+  HAL_FLASH_Lock();
+
+  if (status != HAL_OK)
+  {
+    log_stats.flash_errors++;
+  }
+  return status;
+}
+
+/* Takes the current scan list and rate, empties the decimator and starts
+   the time count from now */
+static void LOG_Restart(void)
+{
+  log_channels = ACQ_GetChannels(log_channel_list);
+  log_rate_mhz = ACQ_GetSampleRateMilliHz();
+  for (uint8_t ch = 0U; ch < ACQ_MAX_CHANNELS; ch++)
+  {
+    log_acc[ch] = 0U;
+  }
+  log_count = 0U;
+  log_phase = 0U;
+  log_time_base_us = (uint64_t)HAL_GetTick() * 1000U;
+  log_time_scans = 0U;
+}
+
+/* Moves to the next page of the ring and queues its header */
+static void LOG_OpenPage(uint64_t time_us)
+{
+  uint8_t header[LOG_PAYLOAD];
+  uint32_t tick = (uint32_t)(time_us / 1000U);
+  uint32_t rate_mhz = log_rate_mhz / log_decimation;
+  uint32_t page;
+  uint16_t crc;
+
+  log_head = (log_head + 1U) % log_pages;
+  log_sequence++;
+  page = LOG_PageAddress(log_head);
+  if ((log_next_erased == 0U) && (LOG_IsBlank(page) == 0U))
+  {
+    LOG_Push(LOG_OP_ERASE, page, 0U);
+  }
+  log_next_erased = 0U;
+
+  header[0] = (uint8_t)LOG_MAGIC;
+  header[1] = (uint8_t)(LOG_MAGIC >> 8);
+  header[2] = log_channels;
+  header[3] = LOG_VERSION;
+  for (uint8_t i = 0U; i < 4U; i++)
+  {
+    header[4U + i] = (uint8_t)(log_sequence >> (8U * i));
+    header[8U + i] = (uint8_t)(tick >> (8U * i));
+    header[12U + i] = (uint8_t)(rate_mhz >> (8U * i));
+  }
+  for (uint8_t ch = 0U; ch < ACQ_MAX_CHANNELS; ch++)
+  {
+    header[16U + ch] = (ch < log_channels) ? log_channel_list[ch] : 0xFFU;
+    log_predict[ch] = LOG_PREDICT_START;
+  }
+  crc = SFRAME_Crc16(header, LOG_HEADER_CRC);
+  header[LOG_HEADER_CRC] = (uint8_t)crc;
+  header[LOG_HEADER_CRC + 1U] = (uint8_t)(crc >> 8);
+
+  for (uint8_t i = 0U; i < LOG_PAYLOAD; i += 2U)
+  {
+    LOG_Push(LOG_OP_PROGRAM, page + i, (uint16_t)(header[i] | ((uint16_t)header[i + 1U] << 8)));
+  }
+
+  log_nibbles = 0U;
+  log_word = 0U;
+  log_word_nibbles = 0U;
+  log_open = 1U;
+}
+
+/* Flushes the last halfword, zero padded, and queues the trailer; at most
+   LOG_CLOSE_ENTRIES entries, one close per LOG_Append() */
+static void LOG_ClosePage(void)
+{
+  uint32_t page = LOG_PageAddress(log_head);
+
+  if (log_open == 0U)
+  {
+    return;
+  }
+  if (log_word_nibbles != 0U)
+  {
+    LOG_Push(LOG_OP_PROGRAM, page + LOG_PAYLOAD + ((log_nibbles / 4U) * 2U), log_word);
+  }
+  LOG_Push(LOG_OP_TRAILER, page, log_nibbles);
+  log_open = 0U;
+}
+
+static void LOG_PushNibble(uint8_t nibble)
+{
+  log_word |= (uint16_t)nibble << (4U * log_word_nibbles);
+  log_nibbles++;
+  if (++log_word_nibbles == 4U)
+  {
+    LOG_Push(LOG_OP_PROGRAM,
+             LOG_PageAddress(log_head) + LOG_PAYLOAD + (((log_nibbles / 4U) - 1U) * 2U), log_word);
+    log_word = 0U;
+    log_word_nibbles = 0U;
+  }
+}
+
+/* Delta, zigzag and 3-bit varint against the page predictors, which are
+   left unchanged */
+static uint8_t LOG_EncodeScan(const uint16_t *scan, uint8_t *nibbles)
+{
+  uint8_t count = 0U;
+
+  for (uint8_t ch = 0U; ch < log_channels; ch++)
+  {
+    int32_t delta = (int32_t)scan[ch] - (int32_t)log_predict[ch];
+    uint32_t value = (delta >= 0) ? ((uint32_t)delta << 1) : (((uint32_t)(-delta) << 1) - 1U);
+
+    while (value > ((1UL << LOG_NIBBLE_BITS) - 1U))
+    {
+      nibbles[count++] = (uint8_t)((value & ((1UL << LOG_NIBBLE_BITS) - 1U)) | LOG_NIBBLE_MORE);
+      value >>= LOG_NIBBLE_BITS;
+    }
+    nibbles[count++] = (uint8_t)value;
+  }
+  return count;
+}
+
+static void LOG_Append(const uint16_t *scan, uint64_t time_us)
+{
+  uint8_t nibbles[LOG_SCAN_NIBBLES];
+  uint8_t count = 0U;
+
+  if ((LOG_QUEUE_SIZE - log_queue_count) < LOG_SCAN_RESERVE)
+  {
+    log_stats.dropped_scans++;
+    log_gap = 1U;
+    return;
+  }
+  if ((log_gap != 0U) && (log_open != 0U))
+  {
+    log_stats.gaps++;
+    LOG_ClosePage();
+  }
+  log_gap = 0U;
+
+  if (log_open != 0U)
+  {
+    count = LOG_EncodeScan(scan, nibbles);
+    if ((log_nibbles + count) > LOG_PAYLOAD_NIBBLES)
+    {
+      LOG_ClosePage();
+    }
+  }
+  if (log_open == 0U)
+  {
+    LOG_OpenPage(time_us);
+    count = LOG_EncodeScan(scan, nibbles);
+  }
+
+  for (uint8_t i = 0U; i < count; i++)
+  {
+    LOG_PushNibble(nibbles[i]);
+  }
+  for (uint8_t ch = 0U; ch < log_channels; ch++)
+  {
+    log_predict[ch] = scan[ch];
+  }
+
+  /* Erase ahead, so a page change needs no erase */
+  if ((log_next_erased == 0U) && (log_nibbles >= (LOG_PAYLOAD_NIBBLES / 2U)))
+  {
+    uint32_t next = LOG_PageAddress((log_head + 1U) % log_pages);
+
+    if (LOG_IsBlank(next) == 0U)
+    {
+      LOG_Push(LOG_OP_ERASE, next, 0U);
+    }
+    log_next_erased = 1U;
+  }
+  log_stats.scans++;
+  log_stats.samples += log_channels;
+  log_stats.nibbles += count;
+}
+
+/* Logs the next scan at its place in time; NULL for a scan without data */
+static void LOG_Emit(const uint16_t *scan)
+{
+  if (scan != NULL)
+  {
+    LOG_Append(scan, log_time_base_us +
+               (((uint64_t)log_time_scans * log_decimation * 1000000000U) / log_rate_mhz));
+  }
+  else
+  {
+    log_stats.dropped_scans++;
+    log_gap = 1U;
+  }
+  log_time_scans++;
+}
+
+static uint8_t LOG_Nibble(uint32_t page, uint16_t pos)
+{
+  return (uint8_t)((LOG_HALFWORD(page + LOG_PAYLOAD + ((pos / 4U) * 2U)) >> (4U * (pos % 4U))) & 0x0FU);
+}
+
+/* Next scan of the page being dumped; 0 at the end of the payload or on
+   data that cannot have been written by LOG_EncodeScan */
+static uint8_t LOG_DecodeScan(uint16_t *scan)
+{
+  const uint8_t channels = ((const uint8_t *)log_dump_page)[2];
+  uint16_t pos = log_dump_pos;
+
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    uint32_t value = 0U;
+    uint8_t shift = 0U;
+    uint8_t nibble;
+    int32_t sample;
+
+    do
+    {
+      if ((pos >= log_dump_end) || (shift >= (LOG_MAX_NIBBLES * LOG_NIBBLE_BITS)))
+      {
+        return 0U;
+      }
+      nibble = LOG_Nibble(log_dump_page, pos++);
+      value |= (uint32_t)(nibble & ~LOG_NIBBLE_MORE) << shift;
+      shift += LOG_NIBBLE_BITS;
+    } while ((nibble & LOG_NIBBLE_MORE) != 0U);
+
+    sample = (int32_t)log_dump_predict[ch] +
+             (((value & 1U) != 0U) ? -(int32_t)((value + 1U) >> 1) : (int32_t)(value >> 1));
+    if ((sample < 0) || (sample > 4095))
+    {
+      return 0U;
+    }
+    scan[ch] = (uint16_t)sample;
+  }
+
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    log_dump_predict[ch] = scan[ch];
+  }
+  log_dump_pos = pos;
+  return 1U;
+}
+
+/* Checks a page and prepares its decoding; 0 if there is nothing to send */
+static uint8_t LOG_DumpLoadPage(uint32_t page)
+{
+  uint16_t nibbles;
+
+  if (LOG_HeaderValid(page) == 0U)
+  {
+    if (LOG_IsBlank(page) == 0U)
+    {
+      log_stats.bad_pages++;
+    }
+    return 0U;
+  }
+  nibbles = LOG_HALFWORD(page + LOG_TRAILER);
+  if (nibbles == LOG_ERASED)
+  {
+    nibbles = LOG_OpenNibbles(page);
+  }
+  else if ((nibbles > LOG_PAYLOAD_NIBBLES) ||
+           (LOG_PayloadCrc(page, nibbles) != LOG_HALFWORD(page + LOG_TRAILER + 2U)))
+  {
+    log_stats.bad_pages++;
+    return 0U;
+  }
+
+  log_dump_page = page;
+  log_dump_pos = 0U;
+  log_dump_end = nibbles;
+  log_dump_scan = 0U;
+  for (uint8_t ch = 0U; ch < ACQ_MAX_CHANNELS; ch++)
+  {
+    log_dump_predict[ch] = LOG_PREDICT_START;
+  }
+  return 1U;
+}
+
+/* Sends the next frame of the dump, or moves on to the next page */
+static void LOG_DumpNext(void)
+{
+  SFRAME_HeaderTypeDef header;
+  uint16_t samples[SFRAME_MAX_SAMPLES];
+  const uint8_t *info;
+  uint16_t count = 0U;
+  uint16_t scans = 0U;
+  uint16_t max_scans;
+
+  if (log_frame_length != 0U)
+  {
+    /* Not enough room yet: the same frame is tried again on the next call */
+    if ((UTX_GetFree() < log_frame_length) || (UTX_Write(log_frame, log_frame_length) != HAL_OK))
+    {
+      return;
+    }
+    log_frame_length = 0U;
+  }
+
+  if (log_dump_page == 0U)
+  {
+    if (log_dump_index == log_pages)
+    {
+      log_dump_state = LOG_DUMP_IDLE;
+      return;
+    }
+    /* Oldest page first */
+    if (LOG_DumpLoadPage(LOG_PageAddress((log_head + 1U + log_dump_index) % log_pages)) == 0U)
+    {
+      log_dump_index++;
+      return;
+    }
+    log_dump_index++;
+  }
+
+  info = (const uint8_t *)log_dump_page;
+  max_scans = (uint16_t)(SFRAME_MAX_SAMPLES / info[2]);
+  while ((scans < max_scans) && (LOG_DecodeScan(&samples[count]) != 0U))
+  {
+    count += info[2];
+    scans++;
+  }
+
+  if (scans != 0U)
+  {
+    header.type = SFRAME_TYPE_LOG;
+    header.channels = info[2];
+    header.samples = count;
+    header.rate_mhz = LOG_WORD(log_dump_page + 12U);
+    /* Tick of the first scan of the frame */
+    header.sequence = LOG_WORD(log_dump_page + 8U) +
+                      (uint32_t)(((uint64_t)log_dump_scan * 1000000U) / header.rate_mhz);
+    log_frame_length = SFRAME_Encode(log_frame, NULL, &header, &info[16], samples);
+    log_dump_scan += scans;
+  }
+  if (scans < max_scans)
+  {
+    log_dump_page = 0U;
+  }
+}
+
+/**
+  * @brief  Finds the log pages and the newest page
+  * @note   A page left open by a reset gets its trailer queued. Call once,
+  *         before the acquisition starts.
+  * @retval HAL_ERROR if fewer than LOG_MIN_PAGES pages are free
+  */
+HAL_StatusTypeDef LOG_Init(void)
+{
+  uint32_t end = (uint32_t)&_sidata + ((uint32_t)&_edata - (uint32_t)&_sdata);
+  uint8_t found = 0U;
+
+  log_base = (end + LOG_PAGE_SIZE - 1U) & ~(LOG_PAGE_SIZE - 1U);
+  log_pages = (log_base < EE_PAGE0_ADDRESS) ? ((EE_PAGE0_ADDRESS - log_base) / LOG_PAGE_SIZE) : 0U;
+  if (log_pages < LOG_MIN_PAGES)
+  {
+    log_pages = 0U;
+    return HAL_ERROR;
+  }
+  log_stats.pages = log_pages;
+
+  /* The newest page has the highest sequence number */
+  log_head = log_pages - 1U;
+  log_sequence = 0U;
+  for (uint32_t index = 0U; index < log_pages; index++)
+  {
+    uint32_t page = LOG_PageAddress(index);
+    uint32_t sequence = LOG_WORD(page + 4U);
+
+    if ((LOG_HeaderValid(page) != 0U) &&
+        ((found == 0U) || ((int32_t)(sequence - log_sequence) > 0)))
+    {
+      log_head = index;
+      log_sequence = sequence;
+      found = 1U;
+    }
+  }
+
+  if ((found != 0U) && (LOG_HALFWORD(LOG_PageAddress(log_head) + LOG_TRAILER) == LOG_ERASED))
+  {
+    LOG_Push(LOG_OP_TRAILER, LOG_PageAddress(log_head), LOG_OpenNibbles(LOG_PageAddress(log_head)));
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Starts logging, or restarts it with another decimation
+  * @note   The current scan list and rate are logged; changing them later
+  *         closes the page and continues on a new one.
+  * @param  decimation: scans averaged per logged scan,
+  *         LOG_MIN_DECIMATION..LOG_MAX_DECIMATION
+  * @retval HAL_BUSY during a dump or erase, HAL_ERROR on bad arguments, a
+  *         logged rate below 1 mHz or without log pages
+  */
+HAL_StatusTypeDef LOG_Start(uint16_t decimation)
+{
+  if ((log_pages == 0U) || (decimation < LOG_MIN_DECIMATION) || (decimation > LOG_MAX_DECIMATION) ||
+      ((ACQ_GetSampleRateMilliHz() / decimation) == 0U))
+  {
+    return HAL_ERROR;
+  }
+  if ((log_dump_state != LOG_DUMP_IDLE) || (log_erase_left != 0U))
+  {
+    return HAL_BUSY;
+  }
+  LOG_Stop();
+  log_decimation = decimation;
+  log_stats.scans = 0U;
+  log_stats.samples = 0U;
+  log_stats.nibbles = 0U;
+  log_gap = 0U;
+  LOG_Restart();
+  log_running = 1U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Stops logging and closes the page
+  * @retval None
+  */
+void LOG_Stop(void)
+{
+  log_running = 0U;
+  log_touched = 0U;
+  LOG_ClosePage();
+}
+
+/**
+  * @brief  Logging state
+  * @retval 1 while logging
+  */
+uint8_t LOG_IsRunning(void)
+{
+  return log_running;
+}
+
+/**
+  * @brief  Sends the whole log, oldest scan first, as SFRAME_TYPE_LOG frames
+  * @note   Stops logging. A single 0x00 delimiter goes first so the host
+  *         decoder starts on a frame boundary; pages with a bad CRC are
+  *         skipped and counted.
+  * @retval HAL_BUSY during an erase, HAL_ERROR without log pages
+  */
+HAL_StatusTypeDef LOG_Dump(void)
+{
+  if (log_pages == 0U)
+  {
+    return HAL_ERROR;
+  }
+  if ((log_dump_state != LOG_DUMP_IDLE) || (log_erase_left != 0U))
+  {
+    return HAL_BUSY;
+  }
+  LOG_Stop();
+  log_stats.bad_pages = 0U;
+  log_dump_state = LOG_DUMP_WAIT;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Dump state
+  * @retval 1 until the last frame of a dump is queued on the UART
+  */
+uint8_t LOG_IsDumping(void)
+{
+  return (log_dump_state != LOG_DUMP_IDLE) ? 1U : 0U;
+}
+
+/**
+  * @brief  Stops logging and erases all log pages, one per block
+  * @retval HAL_BUSY during a dump, HAL_ERROR without log pages
+  */
+HAL_StatusTypeDef LOG_Erase(void)
+{
+  if (log_pages == 0U)
+  {
+    return HAL_ERROR;
+  }
+  if (log_dump_state != LOG_DUMP_IDLE)
+  {
+    return HAL_BUSY;
+  }
+  LOG_Stop();
+  log_erase_left = log_pages;
+  log_next_erased = 0U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Averages one acquisition block into logged scans
+  * @note   Call before ACQ_ReleaseBlock(), the samples are read from the
+  *         DMA buffer; LOG_Release() stores the scans.
+  * @param  block: unpacked block
+  * @retval None
+  */
+void LOG_Block(const ACQ_BlockTypeDef *block)
+{
+  uint8_t channel_list[ACQ_MAX_CHANNELS];
+  uint8_t channels;
+  uint8_t changed;
+  uint16_t count;
+  uint16_t phase;
+
+  log_touched = 0U;
+  log_out_scans = 0U;
+  if (log_running == 0U)
+  {
+    return;
+  }
+
+  /* A new scan list or rate continues on a new page */
+  channels = ACQ_GetChannels(channel_list);
+  changed = (uint8_t)((channels != log_channels) || (block->channels != log_channels) ||
+                      (ACQ_GetSampleRateMilliHz() != log_rate_mhz));
+  for (uint8_t ch = 0U; (ch < channels) && (changed == 0U); ch++)
+  {
+    changed = (channel_list[ch] != log_channel_list[ch]) ? 1U : 0U;
+  }
+  if (changed != 0U)
+  {
+    LOG_ClosePage();
+    LOG_Restart();
+    if (block->channels != log_channels)
+    {
+      return;
+    }
+  }
+
+  for (uint8_t ch = 0U; ch < log_channels; ch++)
+  {
+    log_block_acc[ch] = log_acc[ch];
+  }
+  count = log_count;
+  phase = log_phase;
+  log_block_scans = (uint16_t)(block->length / log_channels);
+  for (uint16_t s = 0U; s < log_block_scans; s++)
+  {
+    const uint16_t *src = &block->data[s * log_channels];
+
+    for (uint8_t ch = 0U; ch < log_channels; ch++)
+    {
+      log_block_acc[ch] += src[ch];
+    }
+    count++;
+    if (++phase == log_decimation)
+    {
+      uint16_t *dst = &log_out[log_out_scans * log_channels];
+
+      /* count is below decimation after an overwritten block */
+      for (uint8_t ch = 0U; ch < log_channels; ch++)
+      {
+        dst[ch] = (uint16_t)((log_block_acc[ch] + (count / 2U)) / count);
+        log_block_acc[ch] = 0U;
+      }
+      log_out_scans++;
+      count = 0U;
+      phase = 0U;
+    }
+  }
+  log_block_count = count;
+  log_block_phase = phase;
+  log_touched = 1U;
+}
+
+/**
+  * @brief  Confirms the block taken by LOG_Block and logs its scans
+  * @param  valid: ACQ_ReleaseBlock() result; 0 leaves the samples of the
+  *         block out of the averages
+  * @retval None
+  */
+void LOG_Release(uint8_t valid)
+{
+  log_after_block = 1U;
+  if (log_touched == 0U)
+  {
+    return;
+  }
+  log_touched = 0U;
+
+  if (valid != 0U)
+  {
+    for (uint8_t ch = 0U; ch < log_channels; ch++)
+    {
+      log_acc[ch] = log_block_acc[ch];
+    }
+    log_count = log_block_count;
+    log_phase = log_block_phase;
+    for (uint16_t s = 0U; s < log_out_scans; s++)
+    {
+      LOG_Emit(&log_out[s * log_channels]);
+    }
+    return;
+  }
+
+  /* Same timing without the samples */
+  log_phase += log_block_scans;
+  while (log_phase >= log_decimation)
+  {
+    if (log_count != 0U)
+    {
+      for (uint8_t ch = 0U; ch < log_channels; ch++)
+      {
+        log_out[ch] = (uint16_t)((log_acc[ch] + (log_count / 2U)) / log_count);
+      }
+      LOG_Emit(log_out);
+    }
+    else
+    {
+      LOG_Emit(NULL);
+    }
+    for (uint8_t ch = 0U; ch < log_channels; ch++)
+    {
+      log_acc[ch] = 0U;
+    }
+    log_count = 0U;
+    log_phase -= log_decimation;
+  }
+}
+
+/**
+  * @brief  Runs the queued flash operations and the dump or erase
+  * @note   Call from the main loop after the block handling: an erase is
+  *         only started right after a block.
+  * @retval None
+  */
+void LOG_Process(void)
+{
+  uint8_t burst = 0U;
+
+  while ((log_queue_count != 0U) && (burst < LOG_PROGRAM_BURST))
+  {
+    const LOG_OpTypeDef *op = &log_queue[log_queue_head];
+
+    if (op->op == LOG_OP_ERASE)
+    {
+      /* Alone, and only with a whole half-buffer ahead */
+      if ((burst != 0U) || (log_after_block == 0U))
+      {
+        break;
+      }
+      burst = LOG_PROGRAM_BURST;
+    }
+    else
+    {
+      burst++;
+    }
+    (void)LOG_Execute(op);
+    log_queue_head = (uint16_t)((log_queue_head + 1U) % LOG_QUEUE_SIZE);
+    log_queue_count--;
+  }
+
+  if (log_queue_count == 0U)
+  {
+    if (log_erase_left != 0U)
+    {
+      uint32_t page = LOG_PageAddress(log_pages - log_erase_left);
+
+      if (LOG_IsBlank(page) == 0U)
+      {
+        LOG_Push(LOG_OP_ERASE, page, 0U);
+      }
+      if (--log_erase_left == 0U)
+      {
+        log_head = log_pages - 1U;
+      }
+    }
+    else if (log_dump_state == LOG_DUMP_WAIT)
+    {
+      if (UTX_Write("\0", 1U) == HAL_OK)
+      {
+        log_dump_index = 0U;
+        log_dump_page = 0U;
+        log_frame_length = 0U;
+        log_dump_state = LOG_DUMP_RUN;
+      }
+    }
+    else if (log_dump_state == LOG_DUMP_RUN)
+    {
+      LOG_DumpNext();
+    }
+  }
+  log_after_block = 0U;
+}
+
+/**
+  * @brief  Copies the logger counters
+  * @param  stats: destination
+  * @retval None
+  */
+void LOG_GetStats(LOG_StatsTypeDef *stats)
+{
+  *stats = log_stats;
+}
@@ -0,0 +1,288 @@
+/**
+  ******************************************************************************
+  * @file           : eeprom.c
+  * @brief          : EEPROM emulation in two flash pages (after ST AN2594).
+  *
+  *                   The active page starts with a status halfword and is
+  *                   filled from the front with 32-bit records: the value,
+  *                   then its virtual address. A write appends a record, a
+  *                   read takes the last record of the address. Only a full
+  *                   page is erased: the latest record of every address is
+  *                   copied to the other page first, so both pages wear out
+  *                   evenly and each erase serves about a page of writes.
+  *
+  *                   Page status and transfer order:
+  *
+  *                     ERASED  0xFFFF  empty
+  *                     RECEIVE 0xEEEE  transfer target, copy in progress
+  *                     VALID   0x0000  active page
+  *
+  *                   RECEIVE is set on the new page, the records are copied,
+  *                   the old page is erased and the new page is set VALID. A
+  *                   reset at any point leaves a combination EE_Init can
+  *                   finish or undo without losing the last completed write.
+  *
+  *                   Erasing a page stalls code fetched from flash for about
+  *                   20 ms; the ADC DMA keeps running, a block may be torn.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "eeprom.h"
+
+/* Private define ------------------------------------------------------------*/
+#define EE_ERASED              0xFFFFU
+#define EE_RECEIVE             0xEEEEU
+#define EE_VALID               0x0000U
+
+#define EE_FIRST_RECORD        4U
+#define EE_RECORD_SIZE         4U
+
+#if (EE_MAX_VADDR > ((EE_PAGE_SIZE - EE_FIRST_RECORD) / EE_RECORD_SIZE))
+#error "EE_MAX_VADDR records do not fit into one page"
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+#define EE_HALFWORD(address)   (*(__IO uint16_t *)(address))
+#define EE_WORD(address)       (*(__IO uint32_t *)(address))
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t ee_active = 0U;        /* active page, 0 before EE_Init */
+static uint32_t ee_next = 0U;          /* first free record of the active page */
+static uint32_t ee_transfers = 0U;
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef EE_Erase(uint32_t page);
+static HAL_StatusTypeDef EE_Program(uint32_t address, uint16_t data);
+static uint32_t EE_FindFree(uint32_t page);
+static uint8_t EE_Find(uint32_t page, uint16_t vaddr, uint16_t *data);
+static HAL_StatusTypeDef EE_Append(uint16_t vaddr, uint16_t data);
+static HAL_StatusTypeDef EE_Transfer(uint16_t vaddr, uint16_t data);
+
+/* Private user code ---------------------------------------------------------*/
+static HAL_StatusTypeDef EE_Erase(uint32_t page)
+{
+  FLASH_EraseInitTypeDef erase = {0};
+  uint32_t error = 0U;
+  HAL_StatusTypeDef status;
+
+  erase.TypeErase = FLASH_TYPEERASE_PAGES;
+  erase.PageAddress = page;
+  erase.NbPages = 1U;
+
+  HAL_FLASH_Unlock();
+  status = HAL_FLASHEx_Erase(&erase, &error);
+  HAL_FLASH_Lock();
+  return status;
+}
+
+static HAL_StatusTypeDef EE_Program(uint32_t address, uint16_t data)
+{
+  HAL_StatusTypeDef status;
+
+  HAL_FLASH_Unlock();
+  status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address, data);
+  HAL_FLASH_Lock();
+  return status;
+}
+
+/* After the last written record; a record half written at a reset is
+   skipped, not reused */
+static uint32_t EE_FindFree(uint32_t page)
+{
+  uint32_t address = page + EE_PAGE_SIZE;
+
+  while ((address > (page + EE_FIRST_RECORD)) && (EE_WORD(address - EE_RECORD_SIZE) == 0xFFFFFFFFU))
+  {
+    address -= EE_RECORD_SIZE;
+  }
+  return address;
+}
+
+static uint8_t EE_Find(uint32_t page, uint16_t vaddr, uint16_t *data)
+{
+  uint32_t end = EE_FindFree(page);
+
+  for (uint32_t address = end; address > (page + EE_FIRST_RECORD); address -= EE_RECORD_SIZE)
+  {
+    if (EE_HALFWORD(address - 2U) == vaddr)
+    {
+      *data = EE_HALFWORD(address - EE_RECORD_SIZE);
+      return 1U;
+    }
+  }
+  return 0U;
+}
+
+static HAL_StatusTypeDef EE_Append(uint16_t vaddr, uint16_t data)
+{
+  HAL_StatusTypeDef status;
+
+  /* Value first: a record without its address is ignored */
+  status = EE_Program(ee_next, data);
+  if (status == HAL_OK)
+  {
+    status = EE_Program(ee_next + 2U, vaddr);
+  }
+  ee_next += EE_RECORD_SIZE;
+  return status;
+}
+
+/* Moves the latest records to the other page, with vaddr set to data */
+static HAL_StatusTypeDef EE_Transfer(uint16_t vaddr, uint16_t data)
+{
+  uint32_t old = ee_active;
+  uint32_t page = (old == EE_PAGE0_ADDRESS) ? EE_PAGE1_ADDRESS : EE_PAGE0_ADDRESS;
+  HAL_StatusTypeDef status;
+
+  if (EE_HALFWORD(page) != EE_ERASED)
+  {
+    status = EE_Erase(page);
+    if (status != HAL_OK)
+    {
+      return status;
+    }
+  }
+  status = EE_Program(page, EE_RECEIVE);
+  ee_active = page;
+  ee_next = page + EE_FIRST_RECORD;
+  if (status == HAL_OK)
+  {
+    status = EE_Append(vaddr, data);
+  }
+
+  for (uint16_t v = 1U; (v <= EE_MAX_VADDR) && (status == HAL_OK); v++)
+  {
+    uint16_t value;
+
+    if ((v != vaddr) && (EE_Find(old, v, &value) != 0U))
+    {
+      status = EE_Append(v, value);
+    }
+  }
+  if (status == HAL_OK)
+  {
+    status = EE_Erase(old);
+  }
+  if (status == HAL_OK)
+  {
+    status = EE_Program(page, EE_VALID);
+  }
+  ee_transfers++;
+  return status;
+}
+
+/**
+  * @brief  Selects the active page, finishing or undoing an interrupted
+  *         page transfer; formats the pages if neither is usable
+  * @retval HAL status
+  */
+HAL_StatusTypeDef EE_Init(void)
+{
+  uint16_t status0 = EE_HALFWORD(EE_PAGE0_ADDRESS);
+  uint16_t status1 = EE_HALFWORD(EE_PAGE1_ADDRESS);
+  HAL_StatusTypeDef status = HAL_OK;
+
+  if ((status0 == EE_VALID) && (status1 != EE_VALID))
+  {
+    ee_active = EE_PAGE0_ADDRESS;
+  }
+  else if ((status1 == EE_VALID) && (status0 != EE_VALID))
+  {
+    ee_active = EE_PAGE1_ADDRESS;
+  }
+  else if ((status0 == EE_RECEIVE) && (status1 == EE_ERASED))
+  {
+    /* Reset after the old page was erased: the copy is complete */
+    ee_active = EE_PAGE0_ADDRESS;
+    status = EE_Program(EE_PAGE0_ADDRESS, EE_VALID);
+  }
+  else if ((status1 == EE_RECEIVE) && (status0 == EE_ERASED))
+  {
+    ee_active = EE_PAGE1_ADDRESS;
+    status = EE_Program(EE_PAGE1_ADDRESS, EE_VALID);
+  }
+  else
+  {
+    /* Blank or unknown: start over */
+    ee_active = EE_PAGE0_ADDRESS;
+    status = EE_Erase(EE_PAGE0_ADDRESS);
+    if (status == HAL_OK)
+    {
+      status = EE_Erase(EE_PAGE1_ADDRESS);
+    }
+    if (status == HAL_OK)
+    {
+      status = EE_Program(EE_PAGE0_ADDRESS, EE_VALID);
+    }
+  }
+
+  /* An unfinished copy next to the valid page is dropped */
+  if (status == HAL_OK)
+  {
+    uint32_t other = (ee_active == EE_PAGE0_ADDRESS) ? EE_PAGE1_ADDRESS : EE_PAGE0_ADDRESS;
+
+    if (EE_WORD(other) != 0xFFFFFFFFU)
+    {
+      status = EE_Erase(other);
+    }
+  }
+  ee_next = EE_FindFree(ee_active);
+  return status;
+}
+
+/**
+  * @brief  Reads the latest value of a virtual address
+  * @param  vaddr: 1..EE_MAX_VADDR
+  * @param  data: destination, unchanged if the address was never written
+  * @retval 1 if found
+  */
+uint8_t EE_Read(uint16_t vaddr, uint16_t *data)
+{
+  if ((ee_active == 0U) || (vaddr == 0U) || (vaddr > EE_MAX_VADDR))
+  {
+    return 0U;
+  }
+  return EE_Find(ee_active, vaddr, data);
+}
+
+/**
+  * @brief  Stores a value; an unchanged value is not written again
+  * @param  vaddr: 1..EE_MAX_VADDR
+  * @param  data: value
+  * @retval HAL status
+  */
+HAL_StatusTypeDef EE_Write(uint16_t vaddr, uint16_t data)
+{
+  uint16_t current;
+
+  if ((ee_active == 0U) || (vaddr == 0U) || (vaddr > EE_MAX_VADDR))
+  {
+    return HAL_ERROR;
+  }
+  if ((EE_Find(ee_active, vaddr, &current) != 0U) && (current == data))
+  {
+    return HAL_OK;
+  }
+  if (ee_next >= (ee_active + EE_PAGE_SIZE))
+  {
+    HAL_StatusTypeDef status = EE_Transfer(vaddr, data);
+
+    if (status != HAL_OK)
+    {
+      /* Fall back to whichever page is complete */
+      (void)EE_Init();
+    }
+    return status;
+  }
+  return EE_Append(vaddr, data);
+}
+
+/**
+  * @brief  Number of page transfers (erases) since EE_Init
+  * @retval Count
+  */
+uint32_t EE_GetTransfers(void)
+{
+  return ee_transfers;
+}
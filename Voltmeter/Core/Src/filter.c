@@ -0,0 +1,274 @@
+/**
+  ******************************************************************************
+  * @file           : filter.c
+  * @brief          : Fixed-point FIR/IIR filter stage.
+  *
+  *                   Each channel of a block is copied out of the interleaved
+  *                   DMA data into an int32 work buffer (ADC counts in Q16)
+  *                   and filtered stage by stage over the whole block: a
+  *                   cascade of Direct Form I biquads with Q30 coefficients,
+  *                   then an optional decimating FIR with Q15 taps. All
+  *                   products are 32x32->64 multiply-accumulates, which the
+  *                   compiler maps onto SMULL/SMLAL; the biquad loop handles
+  *                   two samples and the FIR loop four taps per pass.
+  *
+  *                   The cost per input sample is fixed by the preset (5
+  *                   MACs per biquad, taps / decimation MACs for the FIR).
+  *                   The coefficient tables come from Host/filter_design.py.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "filter.h"
+#include "filter_coeffs.h"
+
+/* Private define ------------------------------------------------------------*/
+#define FLT_COEFF_SHIFT        30U
+#define FLT_TAP_SHIFT          15U
+
+#if (FLT_LOWPASS_STAGES > FLT_MAX_STAGES) || (FLT_NOTCH50_STAGES > FLT_MAX_STAGES) || \
+    (FLT_NOTCH60_STAGES > FLT_MAX_STAGES) || (FLT_LOWPASS_TAPS > FLT_FIR_MAX_TAPS) || \
+    ((FLT_LOWPASS_TAPS % 4U) != 0U)
+#error "filter_coeffs.h does not fit the filter limits"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+/* Indexed by FLT_PresetTypeDef */
+static const FLT_DesignTypeDef flt_designs[FLT_PRESET_COUNT] =
+{
+  { NULL, 0U, NULL, 0U, 1U },
+  { flt_lowpass_sos, FLT_LOWPASS_STAGES, flt_lowpass_fir, FLT_LOWPASS_TAPS, FLT_LOWPASS_DECIMATION },
+  { flt_notch50_sos, FLT_NOTCH50_STAGES, NULL, 0U, 1U },
+  { flt_notch60_sos, FLT_NOTCH60_STAGES, NULL, 0U, 1U }
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void FLT_Biquad(const int32_t *coeffs, int32_t *state, int32_t *data, uint16_t count);
+static uint16_t FLT_FirDecimate(const FLT_DesignTypeDef *design, FLT_ChannelTypeDef *state,
+                                int32_t *data, uint16_t count);
+
+/* Private user code ---------------------------------------------------------*/
+/* One section over a block, in place. The delay line is kept in registers
+   and shifted by renaming over two samples. */
+static void FLT_Biquad(const int32_t *coeffs, int32_t *state, int32_t *data, uint16_t count)
+{
+  const int32_t b0 = coeffs[0];
+  const int32_t b1 = coeffs[1];
+  const int32_t b2 = coeffs[2];
+  const int32_t a1 = coeffs[3];
+  const int32_t a2 = coeffs[4];
+  const int64_t round = 1LL << (FLT_COEFF_SHIFT - 1U);
+  int32_t x1 = state[0];
+  int32_t x2 = state[1];
+  int32_t y1 = state[2];
+  int32_t y2 = state[3];
+  int32_t xa;
+  int32_t xb;
+  int32_t ya;
+  int32_t yb;
+  int64_t acc;
+  uint16_t i = 0U;
+
+  for (; (i + 1U) < count; i += 2U)
+  {
+    xa = data[i];
+    acc = round + ((int64_t)b0 * xa) + ((int64_t)b1 * x1) + ((int64_t)b2 * x2) +
+          ((int64_t)a1 * y1) + ((int64_t)a2 * y2);
+    ya = (int32_t)(acc >> FLT_COEFF_SHIFT);
+
+    xb = data[i + 1U];
+    acc = round + ((int64_t)b0 * xb) + ((int64_t)b1 * xa) + ((int64_t)b2 * x1) +
+          ((int64_t)a1 * ya) + ((int64_t)a2 * y1);
+    yb = (int32_t)(acc >> FLT_COEFF_SHIFT);
+
+    data[i] = ya;
+    data[i + 1U] = yb;
+    x2 = xa;
+    x1 = xb;
+    y2 = ya;
+    y1 = yb;
+  }
+  if (i < count)
+  {
+    xa = data[i];
+    acc = round + ((int64_t)b0 * xa) + ((int64_t)b1 * x1) + ((int64_t)b2 * x2) +
+          ((int64_t)a1 * y1) + ((int64_t)a2 * y2);
+    ya = (int32_t)(acc >> FLT_COEFF_SHIFT);
+    data[i] = ya;
+    x2 = x1;
+    x1 = xa;
+    y2 = y1;
+    y1 = ya;
+  }
+
+  state[0] = x1;
+  state[1] = x2;
+  state[2] = y1;
+  state[3] = y2;
+}
+
+/* Decimating FIR, in place: the outputs are written to the start of data */
+static uint16_t FLT_FirDecimate(const FLT_DesignTypeDef *design, FLT_ChannelTypeDef *state,
+                                int32_t *data, uint16_t count)
+{
+  const uint8_t taps = design->taps;
+  const int64_t round = 1LL << (FLT_TAP_SHIFT - 1U);
+  uint8_t pos = state->fir_pos;
+  uint8_t phase = state->phase;
+  uint16_t produced = 0U;
+
+  for (uint16_t i = 0U; i < count; i++)
+  {
+    const int16_t *h = design->fir;
+    const int32_t *x;
+    int64_t acc = round;
+
+    pos = (pos == 0U) ? (uint8_t)(taps - 1U) : (uint8_t)(pos - 1U);
+    state->fir[pos] = data[i];
+    state->fir[pos + taps] = data[i];
+
+    if (++phase < design->decimation)
+    {
+      continue;
+    }
+    phase = 0U;
+
+    /* x[0] is the newest input, h[0] its tap */
+    x = &state->fir[pos];
+    for (uint8_t k = 0U; k < taps; k += 4U)
+    {
+      acc += (int64_t)h[k] * x[k];
+      acc += (int64_t)h[k + 1U] * x[k + 1U];
+      acc += (int64_t)h[k + 2U] * x[k + 2U];
+      acc += (int64_t)h[k + 3U] * x[k + 3U];
+    }
+    data[produced++] = (int32_t)(acc >> FLT_TAP_SHIFT);
+  }
+
+  state->fir_pos = pos;
+  state->phase = phase;
+  return produced;
+}
+
+/**
+  * @brief  Selects a preset and clears the filter state
+  * @param  flt: filter stage
+  * @param  preset: FLT_PRESET_x
+  * @param  channels: interleaved channels of the input blocks
+  * @retval 1 if the configuration is valid
+  */
+uint8_t FLT_Config(FLT_HandleTypeDef *flt, FLT_PresetTypeDef preset, uint8_t channels)
+{
+  if ((preset >= FLT_PRESET_COUNT) || (channels == 0U) || (channels > FLT_MAX_CHANNELS))
+  {
+    return 0U;
+  }
+  flt->preset = preset;
+  flt->design = &flt_designs[preset];
+  flt->channels = channels;
+  FLT_Reset(flt);
+  return 1U;
+}
+
+/**
+  * @brief  Clears the delay lines, e.g. after a lost block
+  * @param  flt: filter stage
+  * @retval None
+  */
+void FLT_Reset(FLT_HandleTypeDef *flt)
+{
+  for (uint8_t ch = 0U; ch < FLT_MAX_CHANNELS; ch++)
+  {
+    FLT_ChannelTypeDef *state = &flt->channel[ch];
+
+    for (uint8_t stage = 0U; stage < FLT_MAX_STAGES; stage++)
+    {
+      for (uint8_t i = 0U; i < 4U; i++)
+      {
+        state->biquad[stage][i] = 0;
+      }
+    }
+    for (uint8_t i = 0U; i < (2U * FLT_FIR_MAX_TAPS); i++)
+    {
+      state->fir[i] = 0;
+    }
+    state->fir_pos = 0U;
+    state->phase = 0U;
+  }
+}
+
+/**
+  * @brief  Filters one interleaved block
+  * @note   The filters start from zero: after a reset the first outputs
+  *         ramp up for about the filter length.
+  * @param  flt: configured filter stage
+  * @param  data: interleaved 12-bit samples
+  * @param  length: total number of samples, a multiple of channels
+  * @param  out: filtered values, interleaved like the input, in ADC counts
+  *              with extra_bits fractional bits and clamped to the ADC range
+  * @param  out_size: capacity of out; further results are dropped
+  * @param  extra_bits: fractional bits kept in out, 0..4
+  * @retval Number of values written to out
+  */
+uint16_t FLT_Block(FLT_HandleTypeDef *flt, const uint16_t *data, uint16_t length,
+                   uint16_t *out, uint16_t out_size, uint8_t extra_bits)
+{
+  const FLT_DesignTypeDef *design = flt->design;
+  const uint8_t channels = flt->channels;
+  const uint8_t shift = (uint8_t)(FLT_SIGNAL_SHIFT - extra_bits);
+  const int32_t max = (int32_t)(FLT_ADC_MAX << extra_bits);
+  const uint16_t per_channel = out_size / channels;
+  int32_t work[FLT_MAX_BLOCK];
+  uint16_t produced = 0U;
+
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    FLT_ChannelTypeDef *state = &flt->channel[ch];
+    uint16_t count = 0U;
+
+    for (uint16_t i = ch; (i < length) && (count < FLT_MAX_BLOCK); i += channels)
+    {
+      work[count++] = (int32_t)data[i] << FLT_SIGNAL_SHIFT;
+    }
+
+    for (uint8_t stage = 0U; stage < design->stages; stage++)
+    {
+      FLT_Biquad(&design->sos[5U * stage], state->biquad[stage], work, count);
+    }
+    if (design->taps != 0U)
+    {
+      count = FLT_FirDecimate(design, state, work, count);
+    }
+    if (count > per_channel)
+    {
+      count = per_channel;
+    }
+
+    for (uint16_t k = 0U; k < count; k++)
+    {
+      int32_t value = (work[k] + (1L << (shift - 1U))) >> shift;
+
+      if (value < 0)
+      {
+        value = 0;
+      }
+      else if (value > max)
+      {
+        value = max;
+      }
+      out[(k * channels) + ch] = (uint16_t)value;
+    }
+    produced = count;
+  }
+  return (uint16_t)(produced * channels);
+}
+
+/**
+  * @brief  Sample rate the presets were designed for
+  * @retval Rate in Hz; other rates scale all corner frequencies
+  */
+uint32_t FLT_GetDesignRate(void)
+{
+  return FLT_DESIGN_FS_HZ;
+}
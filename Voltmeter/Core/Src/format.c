@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file           : format.c
+  * @brief          : Small integer-to-decimal text formatter.
+  *
+  *                   Used instead of snprintf for the report lines: no
+  *                   format string parsing and no float support pulled in
+  *                   from newlib.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "format.h"
+
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t fmt_pow10[] =
+{
+  1U, 10U, 100U, 1000U, 10000U, 100000U, 1000000U
+};
+
+/**
+  * @brief  Copies a string
+  * @param  dst: output position
+  * @param  str: zero-terminated text
+  * @retval Position after the copied text
+  */
+char *FMT_Str(char *dst, const char *str)
+{
+  while (*str != '\0')
+  {
+    *dst++ = *str++;
+  }
+  return dst;
+}
+
+/**
+  * @brief  Writes an unsigned integer in decimal
+  * @param  dst: output position, room for FMT_UINT_MAX_LEN characters
+  * @param  value: number to print
+  * @retval Position after the last digit
+  */
+char *FMT_Uint(char *dst, uint32_t value)
+{
+  char digits[FMT_UINT_MAX_LEN];
+  uint8_t count = 0U;
+
+  do
+  {
+    digits[count++] = (char)('0' + (value % 10U));
+    value /= 10U;
+  } while (value != 0U);
+
+  while (count > 0U)
+  {
+    *dst++ = digits[--count];
+  }
+  return dst;
+}
+
+/**
+  * @brief  Writes a fixed-point number
+  * @param  dst: output position
+  * @param  value: number scaled by 10^decimals
+  * @param  decimals: digits after the point, 0..6
+  * @retval Position after the last digit
+  */
+char *FMT_Fixed(char *dst, uint32_t value, uint8_t decimals)
+{
+  uint32_t scale = fmt_pow10[decimals];
+  uint32_t fraction = value % scale;
+
+  dst = FMT_Uint(dst, value / scale);
+  if (decimals > 0U)
+  {
+    *dst++ = '.';
+    while (decimals > 0U)
+    {
+      scale /= 10U;
+      *dst++ = (char)('0' + (fraction / scale));
+      fraction %= scale;
+      decimals--;
+    }
+  }
+  return dst;
+}
+
+/**
+  * @brief  Writes a voltage given in microvolts as volts
+  * @param  dst: output position
+  * @param  microvolts: voltage in uV
+  * @param  decimals: digits after the point, 0..6, rounded half up
+  * @retval Position after the last digit
+  */
+char *FMT_Volts(char *dst, uint32_t microvolts, uint8_t decimals)
+{
+  uint32_t divider = fmt_pow10[6U - decimals];
+
+  return FMT_Fixed(dst, (microvolts + (divider / 2U)) / divider, decimals);
+}
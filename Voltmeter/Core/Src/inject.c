@@ -0,0 +1,256 @@
+/**
+  ******************************************************************************
+  * @file           : inject.c
+  * @brief          : On-demand conversions on the ADC1 injected group.
+  *
+  *                   The regular group streams the scan list through DMA
+  *                   and is never stopped. A one-off reading (a battery
+  *                   divider, a sense resistor, Vrefint) is converted by the
+  *                   injected group instead: a software start interrupts
+  *                   the regular sequence between two conversions, converts
+  *                   the channel and lets the scan continue, which delays
+  *                   that one scan by the injected conversion time (32 us
+  *                   at 239.5 cycles) but loses no sample at moderate rates.
+  *
+  *                   Requests are queued and started from the main loop
+  *                   (INJ_Submit, INJ_Process), one at a time; the JEOC
+  *                   interrupt only stores the result. The HAL is called
+  *                   from the main loop only, so its lock is never taken
+  *                   from the interrupt.
+  *
+  *                   The sampling time register is shared by both groups: a
+  *                   channel that is also in the scan list keeps the scan's
+  *                   sampling time. In the dual modes an injected conversion
+  *                   would break the pairing of ADC1 and ADC2, so requests
+  *                   are refused there.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "inject.h"
+#include "acquisition.h"
+#include "samplerate.h"
+#include "cycle.h"
+
+/* Private variables ---------------------------------------------------------*/
+static ADC_HandleTypeDef *inj_hadc = NULL;
+static INJ_RequestTypeDef *inj_queue[INJ_QUEUE_SIZE];
+static uint8_t inj_head = 0U;
+static uint8_t inj_count = 0U;
+/* Request being converted; cleared by the interrupt when it is done */
+static INJ_RequestTypeDef *volatile inj_active = NULL;
+static INJ_RequestTypeDef inj_read_request;
+static INJ_StatsTypeDef inj_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t INJ_SampleTime(uint8_t channel);
+static void INJ_StartNext(void);
+
+/* Private user code ---------------------------------------------------------*/
+static uint32_t INJ_SampleTime(uint8_t channel)
+{
+  uint8_t channels[ACQ_MAX_CHANNELS];
+  uint8_t count = ACQ_GetChannels(channels);
+
+  for (uint8_t i = 0U; i < count; i++)
+  {
+    if (channels[i] == channel)
+    {
+      return SRATE_GetSampleTime();
+    }
+  }
+  return INJ_SAMPLE_TIME;
+}
+
+/* Starts the oldest queued request; main loop only, with no conversion
+   in progress */
+static void INJ_StartNext(void)
+{
+  ADC_InjectionConfTypeDef sConfigInjected = {0};
+
+  while ((inj_active == NULL) && (inj_count != 0U))
+  {
+    INJ_RequestTypeDef *request = inj_queue[inj_head];
+
+    inj_head = (uint8_t)((inj_head + 1U) % INJ_QUEUE_SIZE);
+    inj_count--;
+    if (ACQ_GetMode() != ACQ_MODE_INDEPENDENT)
+    {
+      request->state = INJ_STATE_ERROR;
+      continue;
+    }
+
+    sConfigInjected.InjectedChannel = request->channel;
+    sConfigInjected.InjectedRank = ADC_INJECTED_RANK_1;
+    sConfigInjected.InjectedNbrOfConversion = 1;
+    sConfigInjected.InjectedSamplingTime = INJ_SampleTime(request->channel);
+    sConfigInjected.ExternalTrigInjecConv = ADC_INJECTED_SOFTWARE_START;
+    sConfigInjected.AutoInjectedConv = DISABLE;
+    sConfigInjected.InjectedDiscontinuousConvMode = DISABLE;
+    sConfigInjected.InjectedOffset = 0;
+
+    request->state = INJ_STATE_BUSY;
+    inj_active = request;
+    if ((HAL_ADCEx_InjectedConfigChannel(inj_hadc, &sConfigInjected) != HAL_OK) ||
+        (HAL_ADCEx_InjectedStart_IT(inj_hadc) != HAL_OK))
+    {
+      inj_active = NULL;
+      request->state = INJ_STATE_ERROR;
+    }
+  }
+}
+
+/**
+  * @brief  Selects the software start for the injected group of ADC1
+  * @note   Call before the ADC is first enabled (before the calibration):
+  *         the injected trigger can only be selected while it is off.
+  * @param  hadc: ADC1 handle
+  * @retval HAL status
+  */
+HAL_StatusTypeDef INJ_Init(ADC_HandleTypeDef *hadc)
+{
+  ADC_InjectionConfTypeDef sConfigInjected = {0};
+
+  inj_hadc = hadc;
+  inj_head = 0U;
+  inj_count = 0U;
+  inj_active = NULL;
+
+  sConfigInjected.InjectedChannel = ADC_CHANNEL_VREFINT;
+  sConfigInjected.InjectedRank = ADC_INJECTED_RANK_1;
+  sConfigInjected.InjectedNbrOfConversion = 1;
+  sConfigInjected.InjectedSamplingTime = INJ_SAMPLE_TIME;
+  sConfigInjected.ExternalTrigInjecConv = ADC_INJECTED_SOFTWARE_START;
+  sConfigInjected.AutoInjectedConv = DISABLE;
+  sConfigInjected.InjectedDiscontinuousConvMode = DISABLE;
+  sConfigInjected.InjectedOffset = 0;
+  return HAL_ADCEx_InjectedConfigChannel(hadc, &sConfigInjected);
+}
+
+/**
+  * @brief  Queues one conversion of a channel
+  * @note   Main loop only. The request must stay valid until
+  *         INJ_IsFinished() returns 1.
+  * @param  request: caller-owned request, not queued or busy
+  * @param  channel: ADC_CHANNEL_x
+  * @retval HAL_BUSY if the request or the queue is busy, HAL_ERROR in the
+  *         dual modes
+  */
+HAL_StatusTypeDef INJ_Submit(INJ_RequestTypeDef *request, uint8_t channel)
+{
+  if ((inj_hadc == NULL) || !IS_ACQ_CHANNEL(channel) ||
+      (ACQ_GetMode() != ACQ_MODE_INDEPENDENT))
+  {
+    inj_stats.rejected++;
+    return HAL_ERROR;
+  }
+  if ((request->state == INJ_STATE_QUEUED) || (request->state == INJ_STATE_BUSY) ||
+      (inj_count == INJ_QUEUE_SIZE))
+  {
+    inj_stats.rejected++;
+    return HAL_BUSY;
+  }
+
+  request->channel = channel;
+  request->state = INJ_STATE_QUEUED;
+  inj_queue[(inj_head + inj_count) % INJ_QUEUE_SIZE] = request;
+  inj_count++;
+  inj_stats.requests++;
+  INJ_StartNext();
+  return HAL_OK;
+}
+
+/**
+  * @brief  Checks whether a request has been dealt with
+  * @param  request: submitted request
+  * @retval 1 if DONE (value valid) or ERROR
+  */
+uint8_t INJ_IsFinished(const INJ_RequestTypeDef *request)
+{
+  return ((request->state == INJ_STATE_DONE) || (request->state == INJ_STATE_ERROR)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Checks whether the injected group has nothing to do
+  * @retval 1 if no request is being converted or queued
+  */
+uint8_t INJ_IsIdle(void)
+{
+  return ((inj_active == NULL) && (inj_count == 0U)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Converts a channel and waits for the result
+  * @note   Main loop only; a conversion takes a few tens of us, plus the
+  *         requests queued before it.
+  * @param  channel: ADC_CHANNEL_x
+  * @param  timeout_ms: longest wait
+  * @param  value: 12-bit result
+  * @retval HAL status; HAL_BUSY while a timed-out read is still pending
+  */
+HAL_StatusTypeDef INJ_Read(uint8_t channel, uint32_t timeout_ms, uint16_t *value)
+{
+  INJ_RequestTypeDef *request = &inj_read_request;
+  uint32_t start = HAL_GetTick();
+  HAL_StatusTypeDef status = INJ_Submit(request, channel);
+
+  if (status != HAL_OK)
+  {
+    return status;
+  }
+  while (INJ_IsFinished(request) == 0U)
+  {
+    if ((HAL_GetTick() - start) > timeout_ms)
+    {
+      return HAL_TIMEOUT;
+    }
+    INJ_Process();
+  }
+  if (request->state != INJ_STATE_DONE)
+  {
+    return HAL_ERROR;
+  }
+  *value = request->value;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Starts the next queued request once the last one is done
+  * @note   Call from the main loop; returns at once.
+  * @retval None
+  */
+void INJ_Process(void)
+{
+  if (inj_hadc != NULL)
+  {
+    INJ_StartNext();
+  }
+}
+
+/**
+  * @brief  Copies the injected group counters
+  * @param  stats: destination
+  * @retval None
+  */
+void INJ_GetStats(INJ_StatsTypeDef *stats)
+{
+  *stats = inj_stats;
+}
+
+/**
+  * @brief  Injected conversion complete (ADC1 JEOC interrupt)
+  */
+void INJ_CpltHandler(void)
+{
+  INJ_RequestTypeDef *request = inj_active;
+
+  if (request == NULL)
+  {
+    return;
+  }
+  request->value = (uint16_t)HAL_ADCEx_InjectedGetValue(inj_hadc, ADC_INJECTED_RANK_1);
+  request->timestamp = CYCLE_Now();
+  request->state = INJ_STATE_DONE;
+  inj_stats.conversions++;
+  inj_active = NULL;
+}
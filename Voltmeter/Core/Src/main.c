@@ -23,6 +23,30 @@
 /* USER CODE BEGIN Includes */
 #include <stdio.h>
 #include <string.h>
+#include "acquisition.h"
+#include "samplerate.h"
+#include "stats.h"
+#include "voltage.h"
+#include "format.h"
+#include "cycle.h"
+#include "uart_tx.h"
+#include "stream.h"
+#include "oversample.h"
+#include "filter.h"
+#include "acmeter.h"
+#include "pipeline.h"
+#include "movavg.h"
+#include "capture.h"
+#include "alarm.h"
+#include "sched.h"
+#include "calib.h"
+#include "clock.h"
+#include "inject.h"
+#include "supply.h"
+#include "command.h"
+#include "datalog.h"
+#include "spectrum.h"
+#include "prof.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -32,29 +56,159 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-#define ADC_BUFFER_SIZE 16
+/* 1 - legacy float + snprintf("%.2f") report formatting, kept to compare
+   cycle counts (needs -u _printf_float); 0 - integer fixed-point path */
+#ifndef REPORT_FLOAT_FORMAT
+#define REPORT_FLOAT_FORMAT 0
+#endif
 #define VOLTAGE_REF 3.3f
 #define ADC_MAX_VALUE 4095.0f
 #define MEASUREMENT_FREQ_HZ 1000
+/* Startup values; the report period, filter and format can be changed at
+   runtime with the USART1 commands (command.c) */
 #define PRINT_DELAY_MS 1000
+/* USART1 speed; 115200 or more keeps the TX ring short at high report rates,
+   raw streaming needs 2000000 (USART1 runs from the 64 MHz APB2 clock) */
+#ifndef UART_BAUD_RATE
+#define UART_BAUD_RATE 9600
+#endif
+/* 1 - send every sample as binary frames (stream.c, decoded on the PC by
+   Host/stream_decode) instead of the text report */
+#ifndef STREAM_STARTUP
+#define STREAM_STARTUP 0
+#endif
+/* ACQ_MODE_INDEPENDENT scans scan_channels on ADC1; the dual modes pair
+   ADC1 (DUAL_CHANNEL_A) with ADC2 (DUAL_CHANNEL_B, simultaneous mode only) */
+#define ACQ_STARTUP_MODE ACQ_MODE_INDEPENDENT
+#define DUAL_CHANNEL_A ADC_CHANNEL_0
+#define DUAL_CHANNEL_B ADC_CHANNEL_1
+/* 1..4 - report 13..16 bit oversampled results, 4^n samples each, with the
+   ENOB of the report window; 0 - plain 12-bit mean */
+#ifndef OVERSAMPLE_BITS
+#define OVERSAMPLE_BITS 0
+#endif
+/* 1 - boxcar (sum and dump), 2 - second order CIC decimator */
+#define OVERSAMPLE_ORDER 1
+/* FLT_PRESET_LOWPASS, FLT_PRESET_NOTCH_50HZ or FLT_PRESET_NOTCH_60HZ report
+   the filtered signal instead (takes the place of the oversampling stage);
+   the coefficients are designed for MEASUREMENT_FREQ_HZ = 1000 */
+#define FILTER_PRESET FLT_PRESET_NONE
+/* 1 - report the AC true RMS, peak-to-peak and frequency of the raw samples
+   instead of the mean; 0 - DC report */
+#ifndef REPORT_AC
+#define REPORT_AC 0
+#endif
+/* 1 - arm the triggered capture (capture_config) at startup; the records
+   are sent as stream frames and the text report stays quiet meanwhile */
+#ifndef CAPTURE_STARTUP
+#define CAPTURE_STARTUP 0
+#endif
+/* 1 - watch the alarm_channels windows and report every excursion at once */
+#ifndef ALARM_STARTUP
+#define ALARM_STARTUP 0
+#endif
+/* 1 - add the CPU load (awake time between reports) to the report */
+#ifndef REPORT_LOAD
+#define REPORT_LOAD 0
+#endif
+/* 1 - add the block counters (missed, torn, worst latency) to the report */
+#ifndef REPORT_ACQ
+#define REPORT_ACQ 1
+#endif
+/* 1 - measure VDDA with Vrefint and scale the readings with it; 0 - fixed
+   3.3 V reference. Vrefint is only known to +-3.3 %, so enable it after
+   setting SUP_VREFINT_UV of the board (supply.h) */
+#ifndef SUPPLY_COMPENSATION
+#define SUPPLY_COMPENSATION 0
+#endif
+/* 1 - log LOG_DEFAULT_DECIMATION-scan averages to flash from startup */
+#ifndef LOG_STARTUP
+#define LOG_STARTUP 0
+#endif
+/* FORMAT FFT: record length (256..1024, a power of two) and the analysed
+   channel as position in the scan list */
+#ifndef FFT_POINTS
+#define FFT_POINTS 512
+#endif
+#ifndef FFT_RANK
+#define FFT_RANK 0
+#endif
+/* Moving average of the last MOVING_AVERAGE_WINDOW samples of every channel,
+   reported after the text report (0 - off, see the AVG command). The
+   history is the FFT record (SPEC_WORKSPACE_SIZE samples for all scan
+   channels together, which limits the window to that / scan length), so
+   the average pauses in FORMAT FFT. */
+#ifndef MOVING_AVERAGE_WINDOW
+#define MOVING_AVERAGE_WINDOW 0
+#endif
+/* Clock tree after startup: CLK_PROFILE_HSI64 (SystemClock_Config),
+   CLK_PROFILE_HSE72 (12 MHz ADC, needs the 8 MHz crystal) or
+   CLK_PROFILE_HSI8 (low power) */
+#ifndef CLOCK_PROFILE
+#define CLOCK_PROFILE CLK_PROFILE_HSI64
+#endif
+#if (ACQ_BUFFER_SIZE / 2U) > PIPE_MAX_BLOCK
+#error "PIPE_MAX_BLOCK is smaller than one ACQ block"
+#endif
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
 /* USER CODE BEGIN PM */
-
+/* Report values are ADC counts with OVERSAMPLE_BITS extra bits */
+#define ADC_FULL_SCALE (ADC_MAX_VALUE * (1 << OVERSAMPLE_BITS))
+#define REPORT_UV(channel, value) CAL_ToMicrovolts((channel), (value), OVERSAMPLE_BITS)
+#define REPORT_DECIMALS ((OVERSAMPLE_BITS > 0) ? 4 : 2)
 /* USER CODE END PM */
 
 /* Private variables ---------------------------------------------------------*/
 ADC_HandleTypeDef hadc1;
+ADC_HandleTypeDef hadc2;
 DMA_HandleTypeDef hdma_adc1;
 
 TIM_HandleTypeDef htim2;
 
 UART_HandleTypeDef huart1;
+DMA_HandleTypeDef hdma_usart1_rx;
+DMA_HandleTypeDef hdma_usart1_tx;
 
 /* USER CODE BEGIN PV */
-static uint16_t adc_buffer[ADC_BUFFER_SIZE];
-static volatile uint8_t measurement_ready = 0;
+/* Regular scan list in conversion order: up to ACQ_MAX_CHANNELS of
+   ADC_CHANNEL_0..ADC_CHANNEL_9, ADC_CHANNEL_TEMPSENSOR, ADC_CHANNEL_VREFINT */
+static const uint8_t scan_channels[] = { ADC_CHANNEL_0 };
+/* DWT cycles spent formatting the last report (watch it in the debugger) */
+volatile uint32_t report_format_cycles = 0;
+/* Statistics, AC meter, filter/oversampling and the report window */
+static PIPE_HandleTypeDef pipe;
+/* DWT cycles per input sample spent in the pipeline on the last filtered
+   block (statistics and filter) */
+volatile uint32_t filter_cycles_per_sample = 0;
+/* Sliding-window average across blocks */
+static MAVG_HandleTypeDef mavg;
+/* CPU load of the last report period in 1/100 %, the rest is WFI sleep */
+volatile uint16_t cpu_load = 0;
+/* DWT cycles of the last FFT and its analysis */
+volatile uint32_t fft_cycles = 0;
+/* Settings changed by the USART1 commands */
+static CMD_SettingsTypeDef settings =
+{
+  PRINT_DELAY_MS, FILTER_PRESET,
+  STREAM_STARTUP ? CMD_FORMAT_STREAM : (REPORT_AC ? CMD_FORMAT_AC : CMD_FORMAT_TEXT),
+  0, 0, 0, 0, MOVING_AVERAGE_WINDOW,
+  { { ROB_MODE_NONE, 0 } }
+};
+/* Brown-out hunt: first scan channel below 2.0 V, 256 scans of history and
+   768 after, re-armed after every record */
+static const CAP_ConfigTypeDef capture_config =
+{
+  CAP_TRIG_BELOW, 0, 2482, 4095, 16, 256, 768, 0
+};
+/* Alarm windows in ADC counts (4095 = 3.3 V). The first entry runs on the
+   ADC1 analog watchdog and must be converted by ADC1; the others are
+   checked on the min/max of every block */
+static const ALM_ChannelTypeDef alarm_channels[] =
+{
+  { ADC_CHANNEL_0, 620, 3723 }      /* 0.5 V .. 3.0 V */
+};
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -62,19 +216,93 @@ void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_DMA_Init(void);
 static void MX_ADC1_Init(void);
+static void MX_ADC2_Init(void);
 static void MX_TIM2_Init(void);
 static void MX_USART1_UART_Init(void);
 /* USER CODE BEGIN PFP */
-
+static uint16_t Report_Format(char *msg, const STATS_ChannelTypeDef *stats,
+                              const OVS_NoiseTypeDef *noise, uint8_t channel, uint8_t single);
+static void Report_Send(const STATS_ChannelTypeDef *stats, const OVS_NoiseTypeDef *noise,
+                        uint8_t count);
+static uint16_t Report_FormatAc(char *msg, const AC_ChannelTypeDef *ac, uint32_t rate_mhz,
+                                uint8_t channel, uint8_t single);
+static void Report_SendAc(const AC_ChannelTypeDef *ac, uint8_t count);
+static void Report_SendFft(void);
+static void Report_Alarm(const ALM_EventTypeDef *event);
+static void Report_Load(const SCHED_LoadTypeDef *load);
+static void Report_Acq(void);
+static void Report_Average(uint8_t count);
+static void Report_Calibrate(const STATS_ChannelTypeDef *stats, uint8_t count);
+static void Report_Clock(CLK_ProfileTypeDef wanted);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc)
+{
+  if(hadc->Instance == ADC1)
+  {
+    PROF_BEGIN(PROF_ADC_CALLBACK);
+    ACQ_HalfCpltHandler();
+    SCHED_Post(SCHED_EVENT_BLOCK);
+    PROF_END(PROF_ADC_CALLBACK);
+  }
+}
+
 void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc)
 {
   if(hadc->Instance == ADC1)
   {
-    measurement_ready = 1;
+    PROF_BEGIN(PROF_ADC_CALLBACK);
+    ACQ_CpltHandler();
+    SCHED_Post(SCHED_EVENT_BLOCK);
+    PROF_END(PROF_ADC_CALLBACK);
+  }
+}
+
+void HAL_ADCEx_InjectedConvCpltCallback(ADC_HandleTypeDef* hadc)
+{
+  if(hadc->Instance == ADC1)
+  {
+    INJ_CpltHandler();
+    SCHED_Post(SCHED_EVENT_INJECTED);
+  }
+}
+
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef* hadc)
+{
+  if(hadc->Instance == ADC1)
+  {
+    ALM_WatchdogHandler();
+    SCHED_Post(SCHED_EVENT_ALARM);
+  }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  if(huart->Instance == USART1)
+  {
+    UTX_TxCpltHandler();
+    SCHED_Post(SCHED_EVENT_UART_TX);
+  }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  if(huart->Instance == USART1)
+  {
+    UTX_ErrorHandler();
+    CMD_ErrorHandler();
+    SCHED_Post(SCHED_EVENT_COMMAND);
+  }
+}
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+  if(huart->Instance == USART1)
+  {
+    CMD_RxEventHandler(Size);
+    SCHED_Post(SCHED_EVENT_COMMAND);
   }
 }
 /* USER CODE END 0 */
@@ -103,56 +331,254 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  CYCLE_Init();
+  PROF_Init();
+  SCHED_Init();
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
   MX_DMA_Init();
   MX_ADC1_Init();
+  MX_ADC2_Init();
   MX_TIM2_Init();
   MX_USART1_UART_Init();
   /* USER CODE BEGIN 2 */
-  if (HAL_ADCEx_Calibration_Start(&hadc1) != HAL_OK)
+  /* The injected trigger of ADC1 is set while the ADC is still off */
+  if (INJ_Init(&hadc1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  UTX_Init(&huart1);
+  /* Before the sample rate is set, which then uses the new clocks */
+  CLK_Init(&huart1);
+  if (CLK_SetProfile(CLOCK_PROFILE) != HAL_OK)
+  {
+    /* No crystal for HSE72, or a baud rate HSI8 cannot make: CLK_SetProfile
+       stays on HSI64, keep going */
+    Report_Clock(CLOCK_PROFILE);
+  }
+  /* Stored calibration; channels without points use the nominal scale */
+  (void)CAL_Init();
+  /* Closes a log page left open by a reset */
+  (void)LOG_Init();
+  if (!PIPE_Config(&pipe, settings.filter, OVERSAMPLE_BITS, OVERSAMPLE_ORDER,
+                   settings.format == CMD_FORMAT_AC) ||
+      !PIPE_ConfigRobust(&pipe, settings.robust, ROB_MAX_CHANNELS))
+  {
+    Error_Handler();
+  }
+  MAVG_Init(&mavg, SPEC_GetWorkspace(), SPEC_WORKSPACE_SIZE);
+  MAVG_Config(&mavg, (settings.format == CMD_FORMAT_FFT) ? 0U : settings.avg_window);
+  if (SPEC_Config(FFT_POINTS, FFT_RANK) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  SPEC_Enable(settings.format == CMD_FORMAT_FFT);
+  if (CMD_Init(&huart1, &settings) != HAL_OK)
   {
     Error_Handler();
   }
+  STREAM_Enable(STREAM_STARTUP);
 
-  HAL_ADC_Start_DMA(&hadc1, (uint32_t*)adc_buffer, ADC_BUFFER_SIZE);
+  if ((HAL_ADCEx_Calibration_Start(&hadc1) != HAL_OK) ||
+      (HAL_ADCEx_Calibration_Start(&hadc2) != HAL_OK))
+  {
+    Error_Handler();
+  }
+
+  SRATE_Init(&htim2, &hadc1, &hadc2);
+  if (SRATE_SetRate(MEASUREMENT_FREQ_HZ) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (ACQ_Init(&hadc1, &hadc2) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  ALM_Init(&hadc1);
+  if (ALARM_STARTUP)
+  {
+    if (ALM_Config(alarm_channels, sizeof(alarm_channels) / sizeof(alarm_channels[0])) != HAL_OK)
+    {
+      Error_Handler();
+    }
+  }
+  if (ACQ_STARTUP_MODE == ACQ_MODE_INDEPENDENT)
+  {
+    if (ACQ_ConfigChannels(scan_channels, sizeof(scan_channels)) != HAL_OK)
+    {
+      Error_Handler();
+    }
+  }
+  else if (ACQ_ConfigDual(ACQ_STARTUP_MODE, DUAL_CHANNEL_A, DUAL_CHANNEL_B) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (ACQ_Start() != HAL_OK)
+  {
+    Error_Handler();
+  }
   HAL_TIM_Base_Start(&htim2);
-  HAL_TIM_OC_Start(&htim2, TIM_CHANNEL_2);
+  HAL_TIM_PWM_Start(&htim2, TIM_CHANNEL_2);
+  SUP_Enable(SUPPLY_COMPENSATION);
+  if (CAPTURE_STARTUP)
+  {
+    if ((CAP_Config(&capture_config) != HAL_OK) || (CAP_Arm() != HAL_OK))
+    {
+      Error_Handler();
+    }
+  }
+  if (LOG_STARTUP)
+  {
+    (void)LOG_Start(LOG_DEFAULT_DECIMATION);
+  }
   /* USER CODE END 2 */
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
   uint32_t last_tick = HAL_GetTick();
+  ACQ_BlockTypeDef block;
+  ALM_EventTypeDef alarm;
+  SCHED_LoadTypeDef load;
 
   while (1)
   {
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-	    if(measurement_ready)
+	    /* Sleeps until a block, a finished UART transfer or an alarm */
+	    (void)SCHED_Wait();
+
+	    PROF_BEGIN(PROF_COMMAND);
+	    CMD_Process();
+	    PROF_END(PROF_COMMAND);
+	    if(settings.restart)
 	    {
-	      measurement_ready = 0;
+	      /* New rate, channel list, filter or format: fresh report window */
+	      settings.restart = 0;
+	      (void)PIPE_Config(&pipe, settings.filter, OVERSAMPLE_BITS, OVERSAMPLE_ORDER,
+	                        settings.format == CMD_FORMAT_AC);
+	      (void)PIPE_ConfigRobust(&pipe, settings.robust, ROB_MAX_CHANNELS);
+	      MAVG_Config(&mavg, (settings.format == CMD_FORMAT_FFT) ? 0U : settings.avg_window);
+	      last_tick = HAL_GetTick();
+	    }
 
-	      uint32_t sum = 0;
-	      for(uint8_t i = 0; i < ADC_BUFFER_SIZE; i++)
+	    while(ACQ_GetBlock(&block))
+	    {
+	      PROF_BEGIN(PROF_BLOCK);
+	      ACQ_UnpackBlock(&block);
+	      PROF_BEGIN(PROF_STREAM);
+	      STREAM_Encode(&block);
+	      PROF_END(PROF_STREAM);
+	      PROF_BEGIN(PROF_CAPTURE);
+	      CAP_Block(&block);
+	      PROF_END(PROF_CAPTURE);
+	      PROF_BEGIN(PROF_LOG);
+	      LOG_Block(&block);
+	      PROF_END(PROF_LOG);
+	      PROF_BEGIN(PROF_SPECTRUM);
+	      SPEC_Block(&block);
+	      PROF_END(PROF_SPECTRUM);
+
+	      uint32_t start = CYCLE_Now();
+	      PROF_BEGIN(PROF_PIPELINE);
+	      PIPE_Block(&pipe, block.data, block.length, block.channels);
+	      PROF_END(PROF_PIPELINE);
+	      if(pipe.filter != FLT_PRESET_NONE)
 	      {
-	        sum += adc_buffer[i];
+	        filter_cycles_per_sample = (CYCLE_Now() - start) / block.length;
 	      }
-
-	      uint16_t average = sum / ADC_BUFFER_SIZE;
-	      float voltage = (average * VOLTAGE_REF) / ADC_MAX_VALUE;
-
-	      if((HAL_GetTick() - last_tick) >= PRINT_DELAY_MS)
+	      PROF_BEGIN(PROF_AVERAGE);
+	      MAVG_Block(&mavg, block.data, block.length, block.channels);
+	      PROF_END(PROF_AVERAGE);
+
+	      /* Keep the result only if the DMA did not reach this half meanwhile */
+	      PROF_BEGIN(PROF_RELEASE);
+	      uint8_t valid = ACQ_ReleaseBlock(&block);
+	      PIPE_Release(&pipe, valid);
+	      MAVG_Release(&mavg, valid);
+	      if(valid)
+	      {
+	        ALM_CheckBlock(pipe.block_stats, block.channels);
+	      }
+	      STREAM_Send(valid);
+	      CAP_Release(valid);
+	      LOG_Release(valid);
+	      SPEC_Release(valid);
+	      PROF_END(PROF_RELEASE);
+	      PROF_END(PROF_BLOCK);
+
+	      if((HAL_GetTick() - last_tick) >= settings.report_ms)
 	      {
-	        char msg[32];
-	        snprintf(msg, sizeof(msg), "Voltage: %.2f V\r\n", voltage);
-	        HAL_UART_Transmit(&huart1, (uint8_t*)msg, strlen(msg), HAL_MAX_DELAY);
+	        SCHED_GetLoad(&load);
+	        cpu_load = load.load;
+	        if(!STREAM_IsEnabled() && (CAP_GetState() == CAP_STATE_IDLE) && !LOG_IsDumping())
+	        {
+	          PROF_BEGIN(PROF_REPORT);
+	          if(settings.format == CMD_FORMAT_AC)
+	          {
+	            Report_SendAc(pipe.ac_window, block.channels);
+	          }
+	          else if(settings.format == CMD_FORMAT_FFT)
+	          {
+	            Report_SendFft();
+	          }
+	          else if(pipe.processed)
+	          {
+	            Report_Send(pipe.proc_stats, pipe.proc_noise, block.channels);
+	          }
+	          else
+	          {
+	            Report_Send(pipe.window_stats, NULL, block.channels);
+	          }
+	          if(REPORT_LOAD)
+	          {
+	            Report_Load(&load);
+	          }
+	          if(REPORT_ACQ)
+	          {
+	            Report_Acq();
+	          }
+	          if(mavg.window != 0U)
+	          {
+	            Report_Average(block.channels);
+	          }
+	          PROF_END(PROF_REPORT);
+	        }
+	        if(settings.cal_pending)
+	        {
+	          Report_Calibrate(pipe.window_stats, block.channels);
+	          settings.cal_pending = 0;
+	        }
+	        PIPE_NextWindow(&pipe);
 	        last_tick = HAL_GetTick();
 	      }
 	    }
+	    CAP_Process();
+	    /* Flash writes right after the blocks, an erase only then */
+	    PROF_BEGIN(PROF_FLASH);
+	    LOG_Process();
+	    PROF_END(PROF_FLASH);
+	    /* One record per call, a few ms for 1024 points */
+	    PROF_BEGIN(PROF_FFT);
+	    if(SPEC_Process())
+	    {
+	      PROF_END(PROF_FFT);
+	    }
+	    SUP_Process();
+	    INJ_Process();
+	    /* READ reply, the conversion end posts SCHED_EVENT_INJECTED */
+	    CMD_ReadProcess();
+
+	    ALM_Process();
+	    while(ALM_GetEvent(&alarm))
+	    {
+	      if(!STREAM_IsEnabled() && (CAP_GetState() == CAP_STATE_IDLE) && !LOG_IsDumping())
+	      {
+	        Report_Alarm(&alarm);
+	      }
+	    }
   }
   /* USER CODE END 3 */
 }
@@ -188,14 +614,14 @@ void SystemClock_Config(void)
   RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
   RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
   RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV2;
-  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV4;
+  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
 
   if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_2) != HAL_OK)
   {
     Error_Handler();
   }
   PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_ADC;
-  PeriphClkInit.AdcClockSelection = RCC_ADCPCLK2_DIV2;
+  PeriphClkInit.AdcClockSelection = RCC_ADCPCLK2_DIV8;
   if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
   {
     Error_Handler();
@@ -224,7 +650,7 @@ static void MX_ADC1_Init(void)
   */
   hadc1.Instance = ADC1;
   hadc1.Init.ScanConvMode = ADC_SCAN_DISABLE;
-  hadc1.Init.ContinuousConvMode = ENABLE;
+  hadc1.Init.ContinuousConvMode = DISABLE;
   hadc1.Init.DiscontinuousConvMode = DISABLE;
   hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T2_CC2;
   hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;
@@ -249,6 +675,53 @@ static void MX_ADC1_Init(void)
 
 }
 
+/**
+  * @brief ADC2 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_ADC2_Init(void)
+{
+
+  /* USER CODE BEGIN ADC2_Init 0 */
+
+  /* USER CODE END ADC2_Init 0 */
+
+  ADC_ChannelConfTypeDef sConfig = {0};
+
+  /* USER CODE BEGIN ADC2_Init 1 */
+
+  /* USER CODE END ADC2_Init 1 */
+
+  /** Common config
+  */
+  hadc2.Instance = ADC2;
+  hadc2.Init.ScanConvMode = ADC_SCAN_DISABLE;
+  hadc2.Init.ContinuousConvMode = DISABLE;
+  hadc2.Init.DiscontinuousConvMode = DISABLE;
+  hadc2.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+  hadc2.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+  hadc2.Init.NbrOfConversion = 1;
+  if (HAL_ADC_Init(&hadc2) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Configure Regular Channel
+  */
+  sConfig.Channel = ADC_CHANNEL_1;
+  sConfig.Rank = ADC_REGULAR_RANK_1;
+  sConfig.SamplingTime = ADC_SAMPLETIME_71CYCLES_5;
+  if (HAL_ADC_ConfigChannel(&hadc2, &sConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN ADC2_Init 2 */
+
+  /* USER CODE END ADC2_Init 2 */
+
+}
+
 /**
   * @brief TIM2 Initialization Function
   * @param None
@@ -266,11 +739,11 @@ static void MX_TIM2_Init(void)
   /* USER CODE BEGIN TIM2_Init 1 */
   /* USER CODE END TIM2_Init 1 */
   htim2.Instance = TIM2;
-  htim2.Init.Prescaler = 6400 - 1;
+  htim2.Init.Prescaler = 64 - 1;
   htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim2.Init.Period = 10 - 1;
+  htim2.Init.Period = 1000 - 1;
   htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
-  htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
   if (HAL_TIM_Base_Init(&htim2) != HAL_OK)
   {
     Error_Handler();
@@ -280,23 +753,24 @@ static void MX_TIM2_Init(void)
   {
     Error_Handler();
   }
-
-
-  sConfigOC.OCMode = TIM_OCMODE_TOGGLE;
-  sConfigOC.Pulse = 5;
-  sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
-  sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
-  if (HAL_TIM_OC_ConfigChannel(&htim2, &sConfigOC, TIM_CHANNEL_2) != HAL_OK)
+  if (HAL_TIM_PWM_Init(&htim2) != HAL_OK)
   {
     Error_Handler();
   }
-
   sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
   sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
   if (HAL_TIMEx_MasterConfigSynchronization(&htim2, &sMasterConfig) != HAL_OK)
   {
     Error_Handler();
   }
+  sConfigOC.OCMode = TIM_OCMODE_PWM1;
+  sConfigOC.Pulse = 500;
+  sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+  sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+  if (HAL_TIM_PWM_ConfigChannel(&htim2, &sConfigOC, TIM_CHANNEL_2) != HAL_OK)
+  {
+    Error_Handler();
+  }
   /* USER CODE BEGIN TIM2_Init 2 */
   /* USER CODE END TIM2_Init 2 */
 }
@@ -317,7 +791,7 @@ static void MX_USART1_UART_Init(void)
 
   /* USER CODE END USART1_Init 1 */
   huart1.Instance = USART1;
-  huart1.Init.BaudRate = 9600;
+  huart1.Init.BaudRate = UART_BAUD_RATE;
   huart1.Init.WordLength = UART_WORDLENGTH_8B;
   huart1.Init.StopBits = UART_STOPBITS_1;
   huart1.Init.Parity = UART_PARITY_NONE;
@@ -363,6 +837,12 @@ static void MX_DMA_Init(void)
   /* DMA1_Channel1_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 0, 0);
   HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+  /* DMA1_Channel4_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel4_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+  /* DMA1_Channel5_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel5_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel5_IRQn);
 
 }
 
@@ -386,7 +866,305 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+#if (REPORT_FLOAT_FORMAT == 1)
+/* Report line of one channel, legacy float + snprintf("%.2f") path */
+static uint16_t Report_Format(char *msg, const STATS_ChannelTypeDef *stats,
+                              const OVS_NoiseTypeDef *noise, uint8_t channel, uint8_t single)
+{
+  float voltage = (STATS_Mean(stats) * VOLTAGE_REF) / ADC_FULL_SCALE;
 
+  (void)noise;
+
+  if (single)
+  {
+    return snprintf(msg, 64, "Voltage: %.2f V\r\n", voltage);
+  }
+
+  float min = (stats->min * VOLTAGE_REF) / ADC_FULL_SCALE;
+  float max = (stats->max * VOLTAGE_REF) / ADC_FULL_SCALE;
+  return snprintf(msg, 64, "CH%u: %.2f V min %.2f max %.2f\r\n",
+                  channel, voltage, min, max);
+}
+#else
+/* Report line of one channel in integer fixed-point */
+static uint16_t Report_Format(char *msg, const STATS_ChannelTypeDef *stats,
+                              const OVS_NoiseTypeDef *noise, uint8_t channel, uint8_t single)
+{
+  char *p = msg;
+
+  if (single)
+  {
+    p = FMT_Str(p, "Voltage: ");
+    p = FMT_Volts(p, REPORT_UV(channel, STATS_Mean(stats)), REPORT_DECIMALS);
+    p = FMT_Str(p, " V");
+  }
+  else
+  {
+    p = FMT_Str(p, "CH");
+    p = FMT_Uint(p, channel);
+    p = FMT_Str(p, ": ");
+    p = FMT_Volts(p, REPORT_UV(channel, STATS_Mean(stats)), REPORT_DECIMALS);
+    p = FMT_Str(p, " V min ");
+    p = FMT_Volts(p, REPORT_UV(channel, stats->min), REPORT_DECIMALS);
+    p = FMT_Str(p, " max ");
+    p = FMT_Volts(p, REPORT_UV(channel, stats->max), REPORT_DECIMALS);
+  }
+  if ((noise != NULL) && (noise->count >= 2U))
+  {
+    p = FMT_Str(p, " ENOB ");
+    p = FMT_Fixed(p, OVS_Enob(noise, 12 + OVERSAMPLE_BITS), 2);
+  }
+  p = FMT_Str(p, "\r\n");
+  return (uint16_t)(p - msg);
+}
+#endif
+
+/* Text report of all channels, one line each */
+static void Report_Send(const STATS_ChannelTypeDef *stats, const OVS_NoiseTypeDef *noise,
+                        uint8_t count)
+{
+  uint8_t channels[ACQ_MAX_CHANNELS];
+  char msg[64];
+  uint32_t cycles = 0;
+
+  (void)ACQ_GetChannels(channels);
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (stats[i].count == 0U)
+    {
+      continue;
+    }
+
+    uint32_t start = CYCLE_Now();
+    uint16_t length = Report_Format(msg, &stats[i], (noise != NULL) ? &noise[i] : NULL,
+                                    channels[i], count == 1U);
+    cycles += CYCLE_Now() - start;
+
+    /* Queued for the TX DMA; a line that does not fit is dropped and counted */
+    (void)UTX_Write(msg, length);
+  }
+  report_format_cycles = cycles;
+}
+
+/* AC report line of one channel */
+static uint16_t Report_FormatAc(char *msg, const AC_ChannelTypeDef *ac, uint32_t rate_mhz,
+                                uint8_t channel, uint8_t single)
+{
+  char *p = msg;
+  uint32_t frequency = AC_FrequencyMilliHz(ac, rate_mhz);
+
+  if (single)
+  {
+    p = FMT_Str(p, "AC: ");
+  }
+  else
+  {
+    p = FMT_Str(p, "CH");
+    p = FMT_Uint(p, channel);
+    p = FMT_Str(p, ": ");
+  }
+  /* RMS comes in ADC counts with 8 fractional bits */
+  p = FMT_Volts(p, VOLT_OversampledToMicrovolts(AC_RmsQ8(ac, 0U), 8U), 4U);
+  p = FMT_Str(p, " Vrms ");
+  p = FMT_Volts(p, VOLT_ToMicrovolts(AC_PeakToPeak(ac)), 4U);
+  p = FMT_Str(p, " Vpp");
+  if (frequency != 0U)
+  {
+    p = FMT_Str(p, " ");
+    p = FMT_Fixed(p, frequency, 3);
+    p = FMT_Str(p, " Hz");
+  }
+  p = FMT_Str(p, "\r\n");
+  return (uint16_t)(p - msg);
+}
+
+/* AC report of all channels, one line each */
+static void Report_SendAc(const AC_ChannelTypeDef *ac, uint8_t count)
+{
+  uint8_t channels[ACQ_MAX_CHANNELS];
+  char msg[64];
+  uint32_t rate_mhz = ACQ_GetSampleRateMilliHz();
+  uint32_t cycles = 0;
+
+  (void)ACQ_GetChannels(channels);
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (ac[i].count == 0U)
+    {
+      continue;
+    }
+
+    uint32_t start = CYCLE_Now();
+    uint16_t length = Report_FormatAc(msg, &ac[i], rate_mhz, channels[i], count == 1U);
+    cycles += CYCLE_Now() - start;
+
+    (void)UTX_Write(msg, length);
+  }
+  report_format_cycles = cycles;
+}
+
+/* Latest spectrum, if a record was completed since the last report */
+static void Report_SendFft(void)
+{
+  SPEC_ResultTypeDef result;
+  char msg[96];
+  char *p = msg;
+  uint32_t noise;
+
+  if (!SPEC_GetResult(&result))
+  {
+    return;
+  }
+  fft_cycles = result.cycles;
+  noise = (uint32_t)((result.noise_dbfs_q8 < 0) ? -result.noise_dbfs_q8 : result.noise_dbfs_q8);
+
+  p = FMT_Str(p, "FFT CH");
+  p = FMT_Uint(p, result.channel);
+  p = FMT_Str(p, ": ");
+  p = FMT_Fixed(p, result.frequency_mhz, 3);
+  p = FMT_Str(p, " Hz ");
+  /* RMS comes in ADC counts with 8 fractional bits */
+  p = FMT_Volts(p, VOLT_OversampledToMicrovolts(result.rms_q8, 8U), 4U);
+  p = FMT_Str(p, " Vrms THD ");
+  p = FMT_Fixed(p, result.thd_ppm, 4);
+  p = FMT_Str(p, (result.noise_dbfs_q8 < 0) ? " % NOISE -" : " % NOISE ");
+  p = FMT_Fixed(p, ((noise * 100U) + 128U) >> 8, 2);
+  p = FMT_Str(p, " dBFS/bin (");
+  p = FMT_Uint(p, result.points);
+  p = FMT_Str(p, " points)\r\n");
+  (void)UTX_Write(msg, (uint16_t)(p - msg));
+}
+
+/* One alarm event */
+static void Report_Alarm(const ALM_EventTypeDef *event)
+{
+  char msg[64];
+  char *p = msg;
+
+  p = FMT_Str(p, "ALARM CH");
+  p = FMT_Uint(p, event->channel);
+  p = FMT_Str(p, event->over ? ": over " : ": under ");
+  p = FMT_Volts(p, CAL_ToMicrovolts(event->channel, event->value, 0U), 2);
+  p = FMT_Str(p, " V at ");
+  p = FMT_Uint(p, event->tick);
+  p = FMT_Str(p, " ms\r\n");
+  (void)UTX_Write(msg, (uint16_t)(p - msg));
+}
+
+/* CPU load of the last report period */
+static void Report_Load(const SCHED_LoadTypeDef *load)
+{
+  char msg[64];
+  char *p = msg;
+
+  p = FMT_Str(p, "CPU: ");
+  p = FMT_Fixed(p, load->load, 2);
+  p = FMT_Str(p, " % awake ");
+  p = FMT_Uint(p, load->awake_cycles);
+  p = FMT_Str(p, " sleep ");
+  p = FMT_Uint(p, load->sleep_cycles);
+  p = FMT_Str(p, " cycles\r\n");
+  (void)UTX_Write(msg, (uint16_t)(p - msg));
+}
+
+/* Proof that no block was lost: the DMA block count, the blocks lost before
+   or during processing and the worst latency against the block period */
+static void Report_Acq(void)
+{
+  ACQ_StatsTypeDef stats;
+  char msg[96];
+  char *p = msg;
+  uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+
+  ACQ_GetStats(&stats);
+  p = FMT_Str(p, "ACQ: blocks ");
+  p = FMT_Uint(p, stats.blocks);
+  p = FMT_Str(p, " missed ");
+  p = FMT_Uint(p, stats.missed);
+  p = FMT_Str(p, " torn ");
+  p = FMT_Uint(p, stats.torn);
+  p = FMT_Str(p, " latency ");
+  p = FMT_Uint(p, stats.latency_max / cycles_per_us);
+  p = FMT_Str(p, " us of ");
+  p = FMT_Uint(p, stats.period / cycles_per_us);
+  p = FMT_Str(p, " us\r\n");
+  (void)UTX_Write(msg, (uint16_t)(p - msg));
+}
+
+/* Moving average of every channel in 1/16 counts, with the samples it
+   covers (fewer than the window while it fills) */
+static void Report_Average(uint8_t count)
+{
+  uint8_t channels[ACQ_MAX_CHANNELS];
+  char msg[64];
+  char *p;
+
+  (void)ACQ_GetChannels(channels);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    p = FMT_Str(msg, "AVG CH");
+    p = FMT_Uint(p, channels[i]);
+    p = FMT_Str(p, ": ");
+    p = FMT_Volts(p, CAL_ToMicrovolts(channels[i], MAVG_Mean(&mavg, i, 4), 4), 5);
+    p = FMT_Str(p, " V over ");
+    p = FMT_Uint(p, mavg.fill);
+    p = FMT_Str(p, " samples\r\n");
+    (void)UTX_Write(msg, (uint16_t)(p - msg));
+  }
+}
+
+/* CLOCK_PROFILE could not be applied at startup; names the profile in use */
+static void Report_Clock(CLK_ProfileTypeDef wanted)
+{
+  char msg[64];
+  char *p = msg;
+
+  p = FMT_Str(p, "ERR CLOCK ");
+  p = FMT_Str(p, CLK_Name(wanted));
+  p = FMT_Str(p, " failed, running on ");
+  p = FMT_Str(p, CLK_Name(CLK_GetProfile()));
+  p = FMT_Str(p, "\r\n");
+  (void)UTX_Write(msg, (uint16_t)(p - msg));
+}
+
+/* Answers "CAL <n> <volts>": the window mean of the channel in 1/16 counts
+   becomes a calibration point */
+static void Report_Calibrate(const STATS_ChannelTypeDef *stats, uint8_t count)
+{
+  uint8_t channels[ACQ_MAX_CHANNELS];
+  HAL_StatusTypeDef status = HAL_ERROR;
+  uint32_t raw = 0;
+  char msg[64];
+  char *p = msg;
+
+  (void)ACQ_GetChannels(channels);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if ((channels[i] == settings.cal_channel) && (stats[i].count != 0U))
+    {
+      raw = (uint32_t)(((stats[i].sum << CAL_RAW_SHIFT) + (stats[i].count / 2U)) / stats[i].count);
+      raw = VOLT_Compensate(raw);
+      /* With VDDA above 3.3 V a reading near full scale maps beyond the
+         nominal range, where the table has no room: reject the point */
+      if (raw <= UINT16_MAX)
+      {
+        status = CAL_AddPoint(settings.cal_channel, (uint16_t)raw, settings.cal_microvolts);
+      }
+      break;
+    }
+  }
+
+  p = FMT_Str(p, (status == HAL_OK) ? "OK CAL CH" : "ERR CAL CH");
+  p = FMT_Uint(p, settings.cal_channel);
+  p = FMT_Str(p, ": ");
+  p = FMT_Fixed(p, (raw * 10000U) >> CAL_RAW_SHIFT, 4);
+  p = FMT_Str(p, " = ");
+  p = FMT_Volts(p, settings.cal_microvolts, 6);
+  p = FMT_Str(p, " V\r\n");
+  (void)UTX_Write(msg, (uint16_t)(p - msg));
+}
 /* USER CODE END 4 */
 
 /**
@@ -0,0 +1,178 @@
+/**
+  ******************************************************************************
+  * @file           : movavg.c
+  * @brief          : Sliding-window moving average across DMA blocks.
+  *
+  *                   The last window samples of every channel are kept in
+  *                   a ring of scans together with their exact sum. Each
+  *                   new sample adds itself and subtracts the sample it
+  *                   replaces, so a sample costs the same for a window of
+  *                   16 or of 2000 and the sum never drifts: it is a plain
+  *                   uint32_t of 12-bit values (up to 2^20 samples).
+  *
+  *                   The window is independent of the DMA block length;
+  *                   the ring memory comes from the caller and is shared
+  *                   by the channels, so the longest window is its size
+  *                   divided by the scan length. A torn block empties the
+  *                   ring, the average is valid again once a full window
+  *                   has been collected.
+  *
+  *                   No HAL, so Host/pipeline_bench.c checks it on the PC.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "movavg.h"
+
+/* Private function prototypes -----------------------------------------------*/
+static void MAVG_Clamp(MAVG_HandleTypeDef *mavg);
+
+/* Private user code ---------------------------------------------------------*/
+/* Shortens the window to what the history holds for the scan length */
+static void MAVG_Clamp(MAVG_HandleTypeDef *mavg)
+{
+  mavg->window = mavg->requested;
+  if ((mavg->channels != 0U) && (((uint32_t)mavg->window * mavg->channels) > mavg->size))
+  {
+    mavg->window = (uint16_t)(mavg->size / mavg->channels);
+  }
+}
+
+/**
+  * @brief  Binds the history memory; the average starts switched off
+  * @param  mavg: moving average
+  * @param  history: ring memory, size samples
+  * @param  size: samples, all channels together
+  * @retval None
+  */
+void MAVG_Init(MAVG_HandleTypeDef *mavg, uint16_t *history, uint16_t size)
+{
+  mavg->history = history;
+  mavg->size = size;
+  mavg->requested = 0U;
+  mavg->window = 0U;
+  mavg->channels = 0U;
+  MAVG_Reset(mavg);
+}
+
+/**
+  * @brief  Sets the window length and starts collecting again
+  * @note   The window is shortened to the history size / scan length.
+  * @param  mavg: moving average
+  * @param  window: samples per channel, 0 switches the average off
+  * @retval None
+  */
+void MAVG_Config(MAVG_HandleTypeDef *mavg, uint16_t window)
+{
+  mavg->requested = window;
+  MAVG_Clamp(mavg);
+  MAVG_Reset(mavg);
+}
+
+/**
+  * @brief  Empties the history
+  * @param  mavg: moving average
+  * @retval None
+  */
+void MAVG_Reset(MAVG_HandleTypeDef *mavg)
+{
+  mavg->head = 0U;
+  mavg->fill = 0U;
+  for (uint8_t ch = 0U; ch < MAVG_MAX_CHANNELS; ch++)
+  {
+    mavg->sum[ch] = 0U;
+  }
+}
+
+/**
+  * @brief  Slides the window over one block
+  * @note   Call before ACQ_ReleaseBlock(), then MAVG_Release().
+  * @param  mavg: moving average
+  * @param  data: interleaved 12-bit samples
+  * @param  length: total number of samples, a multiple of channels
+  * @param  channels: 1..MAVG_MAX_CHANNELS; a new scan length starts over
+  * @retval None
+  */
+void MAVG_Block(MAVG_HandleTypeDef *mavg, const uint16_t *data, uint16_t length, uint8_t channels)
+{
+  if (channels != mavg->channels)
+  {
+    mavg->channels = channels;
+    MAVG_Clamp(mavg);
+    MAVG_Reset(mavg);
+  }
+  if (mavg->window == 0U)
+  {
+    return;
+  }
+
+  for (uint16_t i = 0U; i < length; i += channels)
+  {
+    uint16_t *slot = &mavg->history[(uint32_t)mavg->head * channels];
+
+    if (mavg->fill < mavg->window)
+    {
+      for (uint8_t ch = 0U; ch < channels; ch++)
+      {
+        slot[ch] = data[i + ch];
+        mavg->sum[ch] += data[i + ch];
+      }
+      mavg->fill++;
+    }
+    else
+    {
+      /* The oldest sample leaves as the new one enters */
+      for (uint8_t ch = 0U; ch < channels; ch++)
+      {
+        mavg->sum[ch] = (mavg->sum[ch] - slot[ch]) + data[i + ch];
+        slot[ch] = data[i + ch];
+      }
+    }
+    mavg->head++;
+    if (mavg->head == mavg->window)
+    {
+      mavg->head = 0U;
+    }
+  }
+}
+
+/**
+  * @brief  Drops the history if the last block was overwritten meanwhile
+  * @param  mavg: moving average
+  * @param  valid: ACQ_ReleaseBlock() result
+  * @retval None
+  */
+void MAVG_Release(MAVG_HandleTypeDef *mavg, uint8_t valid)
+{
+  if (valid == 0U)
+  {
+    MAVG_Reset(mavg);
+  }
+}
+
+/**
+  * @brief  Checks whether a full window has been collected
+  * @param  mavg: moving average
+  * @retval 1 if MAVG_Mean() covers window samples
+  */
+uint8_t MAVG_IsFull(const MAVG_HandleTypeDef *mavg)
+{
+  return ((mavg->window != 0U) && (mavg->fill == mavg->window)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Mean of the samples in the window
+  * @param  mavg: moving average
+  * @param  channel: position in the scan
+  * @param  extra_bits: fraction bits of the result, 0..8
+  * @retval Mean in ADC counts with extra_bits more bits, rounded; 0 while
+  *         the history is empty
+  */
+uint32_t MAVG_Mean(const MAVG_HandleTypeDef *mavg, uint8_t channel, uint8_t extra_bits)
+{
+  if ((mavg->fill == 0U) || (channel >= MAVG_MAX_CHANNELS))
+  {
+    return 0U;
+  }
+  return (uint32_t)((((uint64_t)mavg->sum[channel] << extra_bits) + (mavg->fill / 2U)) / mavg->fill);
+}
@@ -0,0 +1,261 @@
+/**
+  ******************************************************************************
+  * @file           : oversample.c
+  * @brief          : Oversample-and-decimate stage for higher resolution.
+  *
+  *                   Every 4^n input samples of a channel give one output
+  *                   with n more bits: the samples are summed (boxcar, order
+  *                   1) or run through a second order CIC decimator, and the
+  *                   surplus gain is shifted out. The gain in resolution is
+  *                   real only if the input carries at least about 1 LSB of
+  *                   white noise, which the F103 ADC usually does; ENOB
+  *                   measured on the decimated values shows what is gained.
+  *
+  *                   The CIC integrators are plain uint32_t sums that wrap
+  *                   around; the comb differences undo the wrap as long as
+  *                   the full output range fits in 32 bits (12 + 2 * 2n).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "oversample.h"
+
+/* Private user code ---------------------------------------------------------*/
+/**
+  * @brief  Base 2 logarithm, bit by bit from the squared mantissa
+  * @param  value: argument, at least 1
+  * @retval log2(value) in Q16
+  */
+uint32_t OVS_Log2Q16(uint64_t value)
+{
+  uint32_t result = 0U;
+  uint64_t mantissa;
+
+  while ((value >> result) > 1U)
+  {
+    result++;
+  }
+  mantissa = (result >= 31U) ? (value >> (result - 31U)) : (value << (31U - result));
+  result <<= 16;
+
+  /* mantissa is 1.x in Q31 */
+  for (uint32_t bit = 1UL << 15; bit != 0U; bit >>= 1)
+  {
+    mantissa = (mantissa * mantissa) >> 31;
+    if (mantissa >= (1ULL << 32))
+    {
+      mantissa >>= 1;
+      result |= bit;
+    }
+  }
+  return result;
+}
+
+/**
+  * @brief  Sets the resolution and filter type and clears the state
+  * @param  ovs: stage to configure
+  * @param  extra_bits: 1..OVS_MAX_EXTRA_BITS, decimation by 4^extra_bits
+  * @param  order: 1 boxcar, 2 CIC
+  * @param  channels: interleaved channels of the input blocks
+  * @retval 1 if the configuration is valid
+  */
+uint8_t OVS_Config(OVS_HandleTypeDef *ovs, uint8_t extra_bits, uint8_t order, uint8_t channels)
+{
+  if ((extra_bits == 0U) || (extra_bits > OVS_MAX_EXTRA_BITS) ||
+      (order == 0U) || (order > OVS_MAX_ORDER) ||
+      (channels == 0U) || (channels > OVS_MAX_CHANNELS))
+  {
+    return 0U;
+  }
+
+  ovs->extra_bits = extra_bits;
+  ovs->order = order;
+  ovs->channels = channels;
+  ovs->ratio = (uint16_t)(1UL << (2U * extra_bits));
+  /* Filter gain is ratio^order = 2^(2n * order), keep n bits of it */
+  ovs->shift = (uint8_t)((2U * extra_bits * order) - extra_bits);
+  OVS_Reset(ovs);
+  return 1U;
+}
+
+/**
+  * @brief  Clears the filter state, e.g. after a lost block
+  * @note   A CIC needs order outputs to settle after a reset.
+  * @param  ovs: configured stage
+  * @retval None
+  */
+void OVS_Reset(OVS_HandleTypeDef *ovs)
+{
+  for (uint8_t ch = 0U; ch < OVS_MAX_CHANNELS; ch++)
+  {
+    for (uint8_t stage = 0U; stage < OVS_MAX_ORDER; stage++)
+    {
+      ovs->channel[ch].integrator[stage] = 0U;
+      ovs->channel[ch].comb[stage] = 0U;
+    }
+    ovs->channel[ch].phase = 0U;
+  }
+}
+
+/**
+  * @brief  Feeds one interleaved block, decimated results are appended
+  * @param  ovs: configured stage
+  * @param  data: interleaved 12-bit samples
+  * @param  length: total number of samples, a multiple of channels
+  * @param  out: decimated values, interleaved like the input
+  * @param  out_size: capacity of out; further results are dropped
+  * @retval Number of values written to out
+  */
+uint16_t OVS_Block(OVS_HandleTypeDef *ovs, const uint16_t *data, uint16_t length,
+                   uint16_t *out, uint16_t out_size)
+{
+  const uint8_t channels = ovs->channels;
+  const uint16_t ratio = ovs->ratio;
+  const uint8_t shift = ovs->shift;
+  const uint32_t round = 1UL << (shift - 1U);
+  const uint16_t per_channel = out_size / channels;
+  uint16_t produced = 0U;
+
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    OVS_ChannelTypeDef *state = &ovs->channel[ch];
+    uint32_t i0 = state->integrator[0];
+    uint32_t i1 = state->integrator[1];
+    uint16_t phase = state->phase;
+    uint16_t count = 0U;
+
+    for (uint16_t i = ch; i < length; i += channels)
+    {
+      uint32_t y;
+      uint32_t delayed;
+
+      i0 += data[i];
+      if (ovs->order == 1U)
+      {
+        if (++phase != ratio)
+        {
+          continue;
+        }
+        /* Sum and dump */
+        y = i0;
+        i0 = 0U;
+      }
+      else
+      {
+        i1 += i0;
+        if (++phase != ratio)
+        {
+          continue;
+        }
+        /* Two comb stages, differential delay 1 at the output rate */
+        y = i1 - state->comb[0];
+        state->comb[0] = i1;
+        delayed = state->comb[1];
+        state->comb[1] = y;
+        y -= delayed;
+      }
+      phase = 0U;
+
+      if (count < per_channel)
+      {
+        out[(count * channels) + ch] = (uint16_t)((y + round) >> shift);
+        count++;
+      }
+    }
+
+    state->integrator[0] = i0;
+    state->integrator[1] = i1;
+    state->phase = phase;
+    produced = count;
+  }
+  return (uint16_t)(produced * channels);
+}
+
+/**
+  * @brief  Clears the noise accumulators
+  * @param  noise: array of channels entries
+  * @param  channels: number of channels
+  * @retval None
+  */
+void OVS_NoiseReset(OVS_NoiseTypeDef *noise, uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    noise[ch].sum = 0;
+    noise[ch].sum_sq = 0U;
+    noise[ch].count = 0U;
+    noise[ch].reference = 0U;
+  }
+}
+
+/**
+  * @brief  Adds interleaved decimated values to the noise accumulators
+  * @param  noise: array of channels entries
+  * @param  data: interleaved values (OVS_Block output)
+  * @param  length: total number of values, a multiple of channels
+  * @param  channels: interleave stride
+  * @retval None
+  */
+void OVS_NoiseBlock(OVS_NoiseTypeDef *noise, const uint16_t *data,
+                    uint16_t length, uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    OVS_NoiseTypeDef *acc = &noise[ch];
+
+    for (uint16_t i = ch; i < length; i += channels)
+    {
+      int32_t deviation;
+
+      if (acc->count == 0U)
+      {
+        acc->reference = data[i];
+      }
+      deviation = (int32_t)data[i] - acc->reference;
+      acc->sum += deviation;
+      acc->sum_sq += (uint64_t)((int64_t)deviation * deviation);
+      acc->count++;
+    }
+  }
+}
+
+/**
+  * @brief  Effective number of bits from the RMS noise of a DC input
+  * @note   ENOB = bits - log2(sigma * sqrt(12)), sigma in output LSB. Only
+  *         meaningful for a steady (DC plus noise) test input.
+  * @param  noise: one channel
+  * @param  bits: resolution of the values, OVS_ADC_BITS + extra bits
+  * @retval ENOB in 1/100 bit, capped at bits; 0 with fewer than two values
+  */
+uint16_t OVS_Enob(const OVS_NoiseTypeDef *noise, uint8_t bits)
+{
+  uint64_t magnitude;
+  uint64_t scatter;
+  int64_t enob;
+
+  if (noise->count < 2U)
+  {
+    return 0U;
+  }
+
+  /* count^2 * variance */
+  magnitude = (uint64_t)((noise->sum < 0) ? -noise->sum : noise->sum);
+  scatter = ((uint64_t)noise->count * noise->sum_sq) - (magnitude * magnitude);
+  if (scatter == 0U)
+  {
+    return (uint16_t)(bits * 100U);
+  }
+
+  enob = ((int64_t)bits << 16) -
+         (((int64_t)OVS_Log2Q16(12U * scatter) -
+           (2 * (int64_t)OVS_Log2Q16(noise->count))) / 2);
+  if (enob > ((int64_t)bits << 16))
+  {
+    enob = (int64_t)bits << 16;
+  }
+  if (enob < 0)
+  {
+    enob = 0;
+  }
+  return (uint16_t)(((enob * 100) + 32768) >> 16);
+}
@@ -0,0 +1,211 @@
+/**
+  ******************************************************************************
+  * @file           : pipeline.c
+  * @brief          : Per-block processing of the report path.
+  *
+  *                   The main loop hands every DMA block to PIPE_Block()
+  *                   while it is still in the buffer and reports the
+  *                   outcome of ACQ_ReleaseBlock() to PIPE_Release():
+  *
+  *                   - PIPE_Block() takes the min/max/mean of the raw
+  *                     samples and the robust estimates of the channels
+  *                     that have a robust mode, runs the AC meter if
+  *                     enabled and passes the block through the filter
+  *                     preset or, without a filter, the oversampling stage
+  *                   - PIPE_Release() merges the block results into the
+  *                     report window if the block stayed intact, otherwise
+  *                     drops them and restarts the filter state
+  *
+  *                   Only stdint and the stage modules are used, no HAL, so
+  *                   Host/pipeline_bench.c runs the same code on the PC with
+  *                   synthetic blocks.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pipeline.h"
+
+/* Private define ------------------------------------------------------------*/
+#if (PIPE_MAX_CHANNELS > FLT_MAX_CHANNELS) || (PIPE_MAX_CHANNELS > OVS_MAX_CHANNELS)
+#error "PIPE_MAX_CHANNELS exceeds a stage limit"
+#endif
+
+/* Private user code ---------------------------------------------------------*/
+/**
+  * @brief  Sets the processing and starts a new report window
+  * @note   The filter and oversampling state is kept unless the filter or
+  *         the oversampling changes.
+  * @param  pipe: pipeline
+  * @param  filter: FLT_PRESET_x, FLT_PRESET_NONE for oversampling
+  * @param  extra_bits: 0..OVS_MAX_EXTRA_BITS
+  * @param  order: oversampling filter order, 1..OVS_MAX_ORDER
+  * @param  ac: 1 to run the AC meter
+  * @retval 1 if the configuration is valid
+  */
+uint8_t PIPE_Config(PIPE_HandleTypeDef *pipe, FLT_PresetTypeDef filter,
+                    uint8_t extra_bits, uint8_t order, uint8_t ac)
+{
+  if ((filter >= FLT_PRESET_COUNT) || (extra_bits > OVS_MAX_EXTRA_BITS) ||
+      (order == 0U) || (order > OVS_MAX_ORDER))
+  {
+    return 0U;
+  }
+  if ((filter != pipe->filter) || (extra_bits != pipe->extra_bits) || (order != pipe->order))
+  {
+    /* Configured again with the next block */
+    pipe->flt.channels = 0U;
+    pipe->ovs.channels = 0U;
+  }
+  pipe->filter = filter;
+  pipe->extra_bits = extra_bits;
+  pipe->order = order;
+  pipe->ac = ac;
+  pipe->processed = 0U;
+  PIPE_ResetWindow(pipe);
+  return 1U;
+}
+
+/**
+  * @brief  Sets the robust mode of each channel
+  * @note   The windows of unchanged channels run on.
+  * @param  pipe: pipeline
+  * @param  config: one entry per position in the scan list
+  * @param  count: entries, at most ROB_MAX_CHANNELS; the channels after
+  *                them are set to ROB_MODE_NONE
+  * @retval 1 if every entry is valid
+  */
+uint8_t PIPE_ConfigRobust(PIPE_HandleTypeDef *pipe, const ROB_ConfigTypeDef *config, uint8_t count)
+{
+  uint8_t valid = 1U;
+
+  for (uint8_t ch = 0U; ch < ROB_MAX_CHANNELS; ch++)
+  {
+    if (ch < count)
+    {
+      valid &= ROB_SetChannel(&pipe->rob, ch, config[ch].mode, config[ch].window);
+    }
+    else
+    {
+      (void)ROB_SetChannel(&pipe->rob, ch, ROB_MODE_NONE, 0U);
+    }
+  }
+  return valid;
+}
+
+/**
+  * @brief  Clears the report window, including the AC crossing level
+  * @param  pipe: pipeline
+  * @retval None
+  */
+void PIPE_ResetWindow(PIPE_HandleTypeDef *pipe)
+{
+  STATS_Reset(pipe->window_stats, PIPE_MAX_CHANNELS);
+  STATS_Reset(pipe->proc_stats, PIPE_MAX_CHANNELS);
+  OVS_NoiseReset(pipe->proc_noise, PIPE_MAX_CHANNELS);
+  AC_Reset(pipe->ac_window, PIPE_MAX_CHANNELS);
+}
+
+/**
+  * @brief  Starts the next report window after a report
+  * @note   The AC meter keeps its crossing level from the last window.
+  * @param  pipe: pipeline
+  * @retval None
+  */
+void PIPE_NextWindow(PIPE_HandleTypeDef *pipe)
+{
+  STATS_Reset(pipe->window_stats, PIPE_MAX_CHANNELS);
+  STATS_Reset(pipe->proc_stats, PIPE_MAX_CHANNELS);
+  OVS_NoiseReset(pipe->proc_noise, PIPE_MAX_CHANNELS);
+  AC_NextWindow(pipe->ac_window, PIPE_MAX_CHANNELS);
+}
+
+/**
+  * @brief  Processes one block
+  * @note   Call before ACQ_ReleaseBlock(), the samples are read from the
+  *         DMA buffer. The results are kept in the handle until
+  *         PIPE_Release().
+  * @param  pipe: configured pipeline
+  * @param  data: interleaved 12-bit samples
+  * @param  length: total number of samples, a multiple of channels,
+  *                 at most PIPE_MAX_BLOCK
+  * @param  channels: 1..PIPE_MAX_CHANNELS
+  * @retval None
+  */
+void PIPE_Block(PIPE_HandleTypeDef *pipe, const uint16_t *data, uint16_t length, uint8_t channels)
+{
+  pipe->channels = channels;
+  STATS_Block(pipe->block_stats, data, length, channels);
+  ROB_Block(&pipe->rob, data, length, channels, pipe->rob_block_stats);
+  if (pipe->ac != 0U)
+  {
+    AC_Block(pipe->ac_block, pipe->ac_window, data, length, channels);
+  }
+
+  pipe->processed = 1U;
+  if ((pipe->flt.preset != pipe->filter) || (pipe->flt.channels != channels))
+  {
+    (void)FLT_Config(&pipe->flt, pipe->filter, channels);
+  }
+  if (pipe->filter != FLT_PRESET_NONE)
+  {
+    pipe->proc_count = FLT_Block(&pipe->flt, data, length, pipe->proc_out,
+                                 PIPE_MAX_BLOCK, pipe->extra_bits);
+  }
+  else if (pipe->extra_bits > 0U)
+  {
+    if (pipe->ovs.channels != channels)
+    {
+      (void)OVS_Config(&pipe->ovs, pipe->extra_bits, pipe->order, channels);
+    }
+    pipe->proc_count = OVS_Block(&pipe->ovs, data, length, pipe->proc_out, PIPE_MAX_BLOCK);
+  }
+  else
+  {
+    pipe->processed = 0U;
+  }
+}
+
+/**
+  * @brief  Merges the last block into the report window
+  * @param  pipe: pipeline
+  * @param  valid: ACQ_ReleaseBlock() result; 0 drops the block and
+  *                restarts the filter state, which has taken overwritten
+  *                samples
+  * @retval None
+  */
+void PIPE_Release(PIPE_HandleTypeDef *pipe, uint8_t valid)
+{
+  const uint8_t channels = pipe->channels;
+
+  if (valid != 0U)
+  {
+    for (uint8_t ch = 0U; ch < channels; ch++)
+    {
+      STATS_Merge(&pipe->window_stats[ch],
+                  ((ch < ROB_MAX_CHANNELS) && (pipe->rob.channel[ch].mode != ROB_MODE_NONE)) ?
+                  &pipe->rob_block_stats[ch] : &pipe->block_stats[ch], 1U);
+    }
+    if (pipe->ac != 0U)
+    {
+      AC_Merge(pipe->ac_window, pipe->ac_block, channels);
+    }
+    if (pipe->processed != 0U)
+    {
+      STATS_Block(pipe->proc_block_stats, pipe->proc_out, pipe->proc_count, channels);
+      STATS_Merge(pipe->proc_stats, pipe->proc_block_stats, channels);
+      OVS_NoiseBlock(pipe->proc_noise, pipe->proc_out, pipe->proc_count, channels);
+    }
+  }
+  else
+  {
+    if (pipe->processed != 0U)
+    {
+      FLT_Reset(&pipe->flt);
+      OVS_Reset(&pipe->ovs);
+    }
+    /* Robust windows would span the gap */
+    ROB_Reset(&pipe->rob);
+    /* Crossings may be missing in the gap */
+    AC_Skip(pipe->ac_window, channels);
+  }
+}
@@ -0,0 +1,122 @@
+/**
+  ******************************************************************************
+  * @file           : prof.c
+  * @brief          : DWT cycle profiling of named code regions.
+  *
+  *                   PROF_END() adds the cycles of one pass to the region:
+  *                   a compare for min and max and a 64-bit add, a few tens
+  *                   of cycles. Interrupt regions record from the
+  *                   interrupt, so PROF_Get() copies a region with the
+  *                   interrupts masked. Regions may nest (the ADC callback
+  *                   runs inside the DMA interrupt); an interrupt that
+  *                   arrives inside a main loop region is counted in it.
+  *
+  *                   With PROF_ENABLE 0 the macros expand to nothing and
+  *                   only the empty tables remain.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "prof.h"
+
+/* Private variables ---------------------------------------------------------*/
+/* Indexed by PROF_RegionTypeDef */
+static const char *const prof_names[PROF_REGION_COUNT] =
+{
+  "DMA_IRQ", "ADC_CB", "BLOCK", "PIPELINE", "STREAM", "CAPTURE", "LOG", "SPECTRUM",
+  "AVERAGE", "RELEASE", "REPORT", "FFT", "FLASH", "COMMAND"
+};
+static PROF_StatsTypeDef prof_stats[PROF_REGION_COUNT];
+/* Cycles of an empty PROF_BEGIN/PROF_END pair */
+static uint32_t prof_overhead = 0U;
+
+/* Private user code ---------------------------------------------------------*/
+/**
+  * @brief  Measures the cost of an empty region and clears the statistics
+  * @note   Call after CYCLE_Init().
+  * @retval None
+  */
+void PROF_Init(void)
+{
+  uint32_t overhead = 0xFFFFFFFFU;
+
+  for (uint8_t i = 0U; i < 8U; i++)
+  {
+    uint32_t start = CYCLE_Now();
+    uint32_t cycles = CYCLE_Now() - start;
+
+    if (cycles < overhead)
+    {
+      overhead = cycles;
+    }
+  }
+  prof_overhead = overhead;
+  PROF_Reset();
+}
+
+/**
+  * @brief  Clears the statistics of all regions
+  * @retval None
+  */
+void PROF_Reset(void)
+{
+  for (uint8_t i = 0U; i < PROF_REGION_COUNT; i++)
+  {
+    __disable_irq();
+    prof_stats[i].count = 0U;
+    prof_stats[i].min = 0xFFFFFFFFU;
+    prof_stats[i].max = 0U;
+    prof_stats[i].total = 0U;
+    __enable_irq();
+  }
+}
+
+/**
+  * @brief  Adds one pass to a region, used by PROF_END()
+  * @param  region: PROF_x
+  * @param  cycles: CYCLE_Now() difference over the pass
+  * @retval None
+  */
+void PROF_Record(PROF_RegionTypeDef region, uint32_t cycles)
+{
+  PROF_StatsTypeDef *stats = &prof_stats[region];
+
+  cycles = (cycles > prof_overhead) ? (cycles - prof_overhead) : 0U;
+  stats->count++;
+  stats->total += cycles;
+  if (cycles < stats->min)
+  {
+    stats->min = cycles;
+  }
+  if (cycles > stats->max)
+  {
+    stats->max = cycles;
+  }
+}
+
+/**
+  * @brief  Consistent copy of the statistics of one region
+  * @param  region: PROF_x
+  * @param  stats: destination; min is 0 while count is 0
+  * @retval None
+  */
+void PROF_Get(PROF_RegionTypeDef region, PROF_StatsTypeDef *stats)
+{
+  __disable_irq();
+  *stats = prof_stats[region];
+  __enable_irq();
+  if (stats->count == 0U)
+  {
+    stats->min = 0U;
+  }
+}
+
+/**
+  * @brief  Region name for the PROF command output
+  * @param  region: PROF_x
+  * @retval Name
+  */
+const char *PROF_Name(PROF_RegionTypeDef region)
+{
+  return prof_names[region];
+}
@@ -0,0 +1,272 @@
+/**
+  ******************************************************************************
+  * @file           : robust.c
+  * @brief          : Spike-rejecting estimate of the channel level.
+  *
+  *                   A single sample hit by switching noise moves a plain
+  *                   mean by spike / N. This stage collects N consecutive
+  *                   samples of a channel (8, 16 or 32), sorts them and
+  *                   takes the median or the mean of the middle half, which
+  *                   ignore up to N/2 - 1 or N/4 outliers at either end.
+  *
+  *                   The sort is a Batcher odd-even merge network (19, 63
+  *                   and 191 compare-exchanges): the sequence of comparisons
+  *                   is fixed, and each exchange is computed from the sign
+  *                   of the difference without a branch, so the cost does
+  *                   not depend on the data, about 6 exchanges per sample
+  *                   for N = 32.
+  *
+  *                   Each channel (position in the scan list) has its own
+  *                   mode and window; windows run on across blocks. Only
+  *                   the first ROB_MAX_CHANNELS positions have a window, the
+  *                   later ones always report the plain mean. The
+  *                   estimates of a block are summarised as STATS entries,
+  *                   which pipeline.c merges into the report window in
+  *                   place of the raw statistics.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "robust.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t a;               /*!< Receives the smaller value                    */
+  uint8_t b;               /*!< Receives the larger value                     */
+} ROB_PairTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+/* Batcher odd-even merge sort networks */
+static const ROB_PairTypeDef rob_network_8[] =
+{
+  {  0,  1 }, {  2,  3 }, {  0,  2 }, {  1,  3 }, {  1,  2 }, {  4,  5 }, {  6,  7 }, {  4,  6 },
+  {  5,  7 }, {  5,  6 }, {  0,  4 }, {  2,  6 }, {  2,  4 }, {  1,  5 }, {  3,  7 }, {  3,  5 },
+  {  1,  2 }, {  3,  4 }, {  5,  6 }
+};
+
+static const ROB_PairTypeDef rob_network_16[] =
+{
+  {  0,  1 }, {  2,  3 }, {  0,  2 }, {  1,  3 }, {  1,  2 }, {  4,  5 }, {  6,  7 }, {  4,  6 },
+  {  5,  7 }, {  5,  6 }, {  0,  4 }, {  2,  6 }, {  2,  4 }, {  1,  5 }, {  3,  7 }, {  3,  5 },
+  {  1,  2 }, {  3,  4 }, {  5,  6 }, {  8,  9 }, { 10, 11 }, {  8, 10 }, {  9, 11 }, {  9, 10 },
+  { 12, 13 }, { 14, 15 }, { 12, 14 }, { 13, 15 }, { 13, 14 }, {  8, 12 }, { 10, 14 }, { 10, 12 },
+  {  9, 13 }, { 11, 15 }, { 11, 13 }, {  9, 10 }, { 11, 12 }, { 13, 14 }, {  0,  8 }, {  4, 12 },
+  {  4,  8 }, {  2, 10 }, {  6, 14 }, {  6, 10 }, {  2,  4 }, {  6,  8 }, { 10, 12 }, {  1,  9 },
+  {  5, 13 }, {  5,  9 }, {  3, 11 }, {  7, 15 }, {  7, 11 }, {  3,  5 }, {  7,  9 }, { 11, 13 },
+  {  1,  2 }, {  3,  4 }, {  5,  6 }, {  7,  8 }, {  9, 10 }, { 11, 12 }, { 13, 14 }
+};
+
+static const ROB_PairTypeDef rob_network_32[] =
+{
+  {  0,  1 }, {  2,  3 }, {  0,  2 }, {  1,  3 }, {  1,  2 }, {  4,  5 }, {  6,  7 }, {  4,  6 },
+  {  5,  7 }, {  5,  6 }, {  0,  4 }, {  2,  6 }, {  2,  4 }, {  1,  5 }, {  3,  7 }, {  3,  5 },
+  {  1,  2 }, {  3,  4 }, {  5,  6 }, {  8,  9 }, { 10, 11 }, {  8, 10 }, {  9, 11 }, {  9, 10 },
+  { 12, 13 }, { 14, 15 }, { 12, 14 }, { 13, 15 }, { 13, 14 }, {  8, 12 }, { 10, 14 }, { 10, 12 },
+  {  9, 13 }, { 11, 15 }, { 11, 13 }, {  9, 10 }, { 11, 12 }, { 13, 14 }, {  0,  8 }, {  4, 12 },
+  {  4,  8 }, {  2, 10 }, {  6, 14 }, {  6, 10 }, {  2,  4 }, {  6,  8 }, { 10, 12 }, {  1,  9 },
+  {  5, 13 }, {  5,  9 }, {  3, 11 }, {  7, 15 }, {  7, 11 }, {  3,  5 }, {  7,  9 }, { 11, 13 },
+  {  1,  2 }, {  3,  4 }, {  5,  6 }, {  7,  8 }, {  9, 10 }, { 11, 12 }, { 13, 14 }, { 16, 17 },
+  { 18, 19 }, { 16, 18 }, { 17, 19 }, { 17, 18 }, { 20, 21 }, { 22, 23 }, { 20, 22 }, { 21, 23 },
+  { 21, 22 }, { 16, 20 }, { 18, 22 }, { 18, 20 }, { 17, 21 }, { 19, 23 }, { 19, 21 }, { 17, 18 },
+  { 19, 20 }, { 21, 22 }, { 24, 25 }, { 26, 27 }, { 24, 26 }, { 25, 27 }, { 25, 26 }, { 28, 29 },
+  { 30, 31 }, { 28, 30 }, { 29, 31 }, { 29, 30 }, { 24, 28 }, { 26, 30 }, { 26, 28 }, { 25, 29 },
+  { 27, 31 }, { 27, 29 }, { 25, 26 }, { 27, 28 }, { 29, 30 }, { 16, 24 }, { 20, 28 }, { 20, 24 },
+  { 18, 26 }, { 22, 30 }, { 22, 26 }, { 18, 20 }, { 22, 24 }, { 26, 28 }, { 17, 25 }, { 21, 29 },
+  { 21, 25 }, { 19, 27 }, { 23, 31 }, { 23, 27 }, { 19, 21 }, { 23, 25 }, { 27, 29 }, { 17, 18 },
+  { 19, 20 }, { 21, 22 }, { 23, 24 }, { 25, 26 }, { 27, 28 }, { 29, 30 }, {  0, 16 }, {  8, 24 },
+  {  8, 16 }, {  4, 20 }, { 12, 28 }, { 12, 20 }, {  4,  8 }, { 12, 16 }, { 20, 24 }, {  2, 18 },
+  { 10, 26 }, { 10, 18 }, {  6, 22 }, { 14, 30 }, { 14, 22 }, {  6, 10 }, { 14, 18 }, { 22, 26 },
+  {  2,  4 }, {  6,  8 }, { 10, 12 }, { 14, 16 }, { 18, 20 }, { 22, 24 }, { 26, 28 }, {  1, 17 },
+  {  9, 25 }, {  9, 17 }, {  5, 21 }, { 13, 29 }, { 13, 21 }, {  5,  9 }, { 13, 17 }, { 21, 25 },
+  {  3, 19 }, { 11, 27 }, { 11, 19 }, {  7, 23 }, { 15, 31 }, { 15, 23 }, {  7, 11 }, { 15, 19 },
+  { 23, 27 }, {  3,  5 }, {  7,  9 }, { 11, 13 }, { 15, 17 }, { 19, 21 }, { 23, 25 }, { 27, 29 },
+  {  1,  2 }, {  3,  4 }, {  5,  6 }, {  7,  8 }, {  9, 10 }, { 11, 12 }, { 13, 14 }, { 15, 16 },
+  { 17, 18 }, { 19, 20 }, { 21, 22 }, { 23, 24 }, { 25, 26 }, { 27, 28 }, { 29, 30 }
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void ROB_Exchange(uint16_t *values, const ROB_PairTypeDef *pair);
+
+/* Private user code ---------------------------------------------------------*/
+/* Orders one pair without a branch: m is the difference if it is negative
+   (arithmetic shift of the sign), 0 otherwise */
+static void ROB_Exchange(uint16_t *values, const ROB_PairTypeDef *pair)
+{
+  int32_t x = values[pair->a];
+  int32_t y = values[pair->b];
+  int32_t d = y - x;
+  int32_t m = d & (d >> 31);
+
+  values[pair->a] = (uint16_t)(x + m);
+  values[pair->b] = (uint16_t)(y - m);
+}
+
+/**
+  * @brief  Sets the mode and window of one channel
+  * @note   A changed channel starts a new window; the others keep theirs.
+  * @param  rob: robust stage
+  * @param  rank: position of the channel in the scan list
+  * @param  mode: ROB_MODE_x
+  * @param  window: 8, 16 or 32 samples, ignored for ROB_MODE_NONE
+  * @retval 1 if the setting is valid
+  */
+uint8_t ROB_SetChannel(ROB_HandleTypeDef *rob, uint8_t rank, ROB_ModeTypeDef mode, uint8_t window)
+{
+  ROB_ChannelTypeDef *channel;
+
+  if ((rank >= ROB_MAX_CHANNELS) || (mode >= ROB_MODE_COUNT) ||
+      ((mode != ROB_MODE_NONE) && !IS_ROB_WINDOW(window)))
+  {
+    return 0U;
+  }
+  channel = &rob->channel[rank];
+  if (mode == ROB_MODE_NONE)
+  {
+    window = 0U;
+  }
+  if ((mode != channel->mode) || (window != channel->window))
+  {
+    if ((channel->mode == ROB_MODE_NONE) && (mode != ROB_MODE_NONE))
+    {
+      rob->active++;
+    }
+    else if ((channel->mode != ROB_MODE_NONE) && (mode == ROB_MODE_NONE))
+    {
+      rob->active--;
+    }
+    channel->mode = mode;
+    channel->window = window;
+    channel->fill = 0U;
+  }
+  return 1U;
+}
+
+/**
+  * @brief  Drops the partly collected windows (lost samples, new scan list)
+  * @param  rob: robust stage
+  * @retval None
+  */
+void ROB_Reset(ROB_HandleTypeDef *rob)
+{
+  for (uint8_t ch = 0U; ch < ROB_MAX_CHANNELS; ch++)
+  {
+    rob->channel[ch].fill = 0U;
+  }
+}
+
+/**
+  * @brief  Runs one block through the stage
+  * @param  rob: robust stage
+  * @param  data: interleaved 12-bit samples
+  * @param  length: total number of samples, a multiple of channels
+  * @param  channels: interleaved channels of the block
+  * @param  stats: array of ROB_MAX_CHANNELS entries, overwritten with the
+  *                estimates completed in this block; empty for ROB_MODE_NONE
+  * @retval None
+  */
+void ROB_Block(ROB_HandleTypeDef *rob, const uint16_t *data, uint16_t length,
+               uint8_t channels, STATS_ChannelTypeDef *stats)
+{
+  const uint8_t windowed = (channels < ROB_MAX_CHANNELS) ? channels : (uint8_t)ROB_MAX_CHANNELS;
+
+  if (channels != rob->channels)
+  {
+    rob->channels = channels;
+    ROB_Reset(rob);
+  }
+  STATS_Reset(stats, windowed);
+  if (rob->active == 0U)
+  {
+    return;
+  }
+
+  for (uint8_t ch = 0U; ch < windowed; ch++)
+  {
+    ROB_ChannelTypeDef *channel = &rob->channel[ch];
+
+    if (channel->mode == ROB_MODE_NONE)
+    {
+      continue;
+    }
+    for (uint16_t i = ch; i < length; i += channels)
+    {
+      channel->buffer[channel->fill] = data[i];
+      channel->fill++;
+      if (channel->fill == channel->window)
+      {
+        uint16_t value = ROB_Estimate(channel->buffer, channel->window, channel->mode);
+
+        channel->fill = 0U;
+        stats[ch].sum += value;
+        stats[ch].count++;
+        if (value < stats[ch].min)
+        {
+          stats[ch].min = value;
+        }
+        if (value > stats[ch].max)
+        {
+          stats[ch].max = value;
+        }
+      }
+    }
+  }
+}
+
+/**
+  * @brief  Sorts values in ascending order with a fixed network
+  * @param  values: array to sort in place
+  * @param  count: 8, 16 or 32; other lengths are left unsorted
+  * @retval None
+  */
+void ROB_Sort(uint16_t *values, uint8_t count)
+{
+  const ROB_PairTypeDef *pair;
+  uint16_t pairs;
+
+  switch (count)
+  {
+    case 8U:
+      pair = rob_network_8;
+      pairs = (uint16_t)(sizeof(rob_network_8) / sizeof(rob_network_8[0]));
+      break;
+    case 16U:
+      pair = rob_network_16;
+      pairs = (uint16_t)(sizeof(rob_network_16) / sizeof(rob_network_16[0]));
+      break;
+    case 32U:
+      pair = rob_network_32;
+      pairs = (uint16_t)(sizeof(rob_network_32) / sizeof(rob_network_32[0]));
+      break;
+    default:
+      return;
+  }
+  for (uint16_t i = 0U; i < pairs; i++)
+  {
+    ROB_Exchange(values, &pair[i]);
+  }
+}
+
+/**
+  * @brief  Robust estimate of a window
+  * @param  values: count samples, sorted in place
+  * @param  count: 8, 16 or 32
+  * @param  mode: ROB_MODE_MEDIAN or ROB_MODE_TRIMMED
+  * @retval Estimate in the unit of the samples, rounded
+  */
+uint16_t ROB_Estimate(uint16_t *values, uint8_t count, ROB_ModeTypeDef mode)
+{
+  uint32_t sum = 0U;
+  uint8_t quarter = (uint8_t)(count / 4U);
+
+  ROB_Sort(values, count);
+  if (mode == ROB_MODE_MEDIAN)
+  {
+    return (uint16_t)(((uint32_t)values[(count / 2U) - 1U] + values[count / 2U] + 1U) / 2U);
+  }
+  for (uint8_t i = quarter; i < (uint8_t)(count - quarter); i++)
+  {
+    sum += values[i];
+  }
+  return (uint16_t)((sum + quarter) / (uint32_t)(count / 2U));
+}
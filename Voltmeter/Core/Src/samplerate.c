@@ -0,0 +1,269 @@
+/**
+  ******************************************************************************
+  * @file           : samplerate.c
+  * @brief          : Timer-driven ADC sample rate engine.
+  *
+  *                   The ADC runs in single (non-continuous) mode and starts
+  *                   one conversion on every TIM2 CC2 event, so the sample
+  *                   rate is set by the TIM2 prescaler and period only.
+  *                   Dividers are derived from the requested rate and the
+  *                   running clock tree; the longest ADC sample time that
+  *                   still fits into one sampling period is selected.
+  *
+  *                   PSC, ARR and CCR2 are preloaded registers: a new rate is
+  *                   latched at the next update event, so it can be changed
+  *                   while the timer and the ADC DMA keep running.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "samplerate.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t sample_time;    /*!< ADC_SAMPLETIME_x value                          */
+  uint32_t half_cycles;    /*!< Sampling + 12.5 conversion cycles, times two    */
+} SRATE_SampleTimeTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define SRATE_ADC_CHANNELS     18U
+
+/* Private variables ---------------------------------------------------------*/
+/* Ascending conversion time; the last entry that fits the period wins */
+static const SRATE_SampleTimeTypeDef srate_sample_times[] =
+{
+  { ADC_SAMPLETIME_1CYCLE_5,     28U },
+  { ADC_SAMPLETIME_7CYCLES_5,    40U },
+  { ADC_SAMPLETIME_13CYCLES_5,   52U },
+  { ADC_SAMPLETIME_28CYCLES_5,   82U },
+  { ADC_SAMPLETIME_41CYCLES_5,  108U },
+  { ADC_SAMPLETIME_55CYCLES_5,  136U },
+  { ADC_SAMPLETIME_71CYCLES_5,  168U },
+  { ADC_SAMPLETIME_239CYCLES_5, 504U }
+};
+
+static TIM_HandleTypeDef *srate_htim = NULL;
+static ADC_HandleTypeDef *srate_hadc = NULL;
+static ADC_HandleTypeDef *srate_hadc_slave = NULL;
+static uint32_t srate_rate = 0U;         /* requested, may exceed the maximum */
+static uint32_t srate_conversions = 1U;
+static uint32_t srate_sample_time = ADC_SAMPLETIME_71CYCLES_5;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t SRATE_TimerClock(void);
+static uint32_t SRATE_AdcClock(void);
+static void SRATE_ApplySampleTime(uint32_t sample_time);
+static HAL_StatusTypeDef SRATE_Apply(uint32_t rate_hz);
+
+/* Private user code ---------------------------------------------------------*/
+static uint32_t SRATE_TimerClock(void)
+{
+  uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+
+  /* APB1 timers are clocked at twice PCLK1 unless the APB1 prescaler is 1 */
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+  {
+    return 2U * pclk1;
+  }
+  return pclk1;
+}
+
+static uint32_t SRATE_AdcClock(void)
+{
+  return HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_ADC);
+}
+
+static void SRATE_ApplySampleTime(uint32_t sample_time)
+{
+  uint32_t smpr1 = 0U;
+  uint32_t smpr2 = 0U;
+
+  for (uint32_t channel = 0U; channel < 10U; channel++)
+  {
+    smpr2 |= ADC_SMPR2(sample_time, channel);
+  }
+  for (uint32_t channel = 10U; channel < SRATE_ADC_CHANNELS; channel++)
+  {
+    smpr1 |= ADC_SMPR1(sample_time, channel);
+  }
+
+  /* Sample time registers may be written on the fly, the next conversion
+     uses the new value */
+  srate_hadc->Instance->SMPR1 = smpr1;
+  srate_hadc->Instance->SMPR2 = smpr2;
+
+  /* Simultaneous dual mode requires the same sampling time on ADC2 */
+  if (srate_hadc_slave != NULL)
+  {
+    srate_hadc_slave->Instance->SMPR1 = smpr1;
+    srate_hadc_slave->Instance->SMPR2 = smpr2;
+  }
+  srate_sample_time = sample_time;
+}
+
+/* Programs the timer dividers and the sampling time for rate_hz */
+static HAL_StatusTypeDef SRATE_Apply(uint32_t rate_hz)
+{
+  uint32_t tim_clock;
+  uint32_t ticks;
+  uint32_t prescaler;
+  uint32_t period;
+  uint32_t index;
+
+  if ((srate_htim == NULL) || (srate_hadc == NULL) ||
+      (rate_hz < SRATE_MIN_HZ) || (rate_hz > SRATE_GetMaxRate()))
+  {
+    return HAL_ERROR;
+  }
+
+  /* Timer ticks per sample, split into the smallest prescaler that keeps the
+     period within 16 bits (best rate resolution) */
+  tim_clock = SRATE_TimerClock();
+  ticks = (tim_clock + (rate_hz / 2U)) / rate_hz;
+  if (ticks < 2U)
+  {
+    ticks = 2U;
+  }
+  prescaler = (ticks - 1U) / 65536U;
+  period = ((ticks + ((prescaler + 1U) / 2U)) / (prescaler + 1U)) - 1U;
+
+  /* Longest sampling time for which the whole conversion still fits */
+  index = (sizeof(srate_sample_times) / sizeof(srate_sample_times[0])) - 1U;
+  while ((index > 0U) &&
+         (((uint64_t)srate_conversions * srate_sample_times[index].half_cycles * rate_hz) >
+          (2ULL * SRATE_AdcClock())))
+  {
+    index--;
+  }
+  SRATE_ApplySampleTime(srate_sample_times[index].sample_time);
+
+  __HAL_TIM_SET_PRESCALER(srate_htim, prescaler);
+  __HAL_TIM_SET_AUTORELOAD(srate_htim, period);
+  __HAL_TIM_SET_COMPARE(srate_htim, TIM_CHANNEL_2, (period + 1U) / 2U);
+  srate_htim->Init.Prescaler = prescaler;
+
+  /* A stopped timer would keep the old dividers until its first update */
+  if ((srate_htim->Instance->CR1 & TIM_CR1_CEN) == 0U)
+  {
+    srate_htim->Instance->EGR = TIM_EGR_UG;
+  }
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Binds the engine to the trigger timer and the ADCs
+  * @param  htim: timer generating the ADC trigger on channel 2 (TIM2)
+  * @param  hadc: ADC triggered by the timer
+  * @param  hadc_slave: ADC2 converting along in dual mode, or NULL
+  * @retval None
+  */
+void SRATE_Init(TIM_HandleTypeDef *htim, ADC_HandleTypeDef *hadc, ADC_HandleTypeDef *hadc_slave)
+{
+  srate_htim = htim;
+  srate_hadc = hadc;
+  srate_hadc_slave = hadc_slave;
+}
+
+/**
+  * @brief  Highest rate the current ADC clock supports
+  * @retval Rate in Hz (one trigger per scan of the channel list)
+  */
+uint32_t SRATE_GetMaxRate(void)
+{
+  uint32_t max_rate = (2U * SRATE_AdcClock()) /
+                      (srate_conversions * srate_sample_times[0].half_cycles);
+
+  return (max_rate < SRATE_MAX_HZ) ? max_rate : SRATE_MAX_HZ;
+}
+
+/**
+  * @brief  Sets the sample rate
+  * @note   May be called while sampling: the new dividers take effect at the
+  *         end of the current sampling period, DMA is not restarted.
+  * @param  rate_hz: requested rate, SRATE_MIN_HZ..SRATE_GetMaxRate()
+  * @retval HAL_ERROR if the rate is out of range
+  */
+HAL_StatusTypeDef SRATE_SetRate(uint32_t rate_hz)
+{
+  HAL_StatusTypeDef status = SRATE_Apply(rate_hz);
+
+  if (status == HAL_OK)
+  {
+    srate_rate = rate_hz;
+  }
+  return status;
+}
+
+/**
+  * @brief  Applies the requested rate again after the scan length or the
+  *         clocks changed
+  * @note   A rate above the new maximum is applied as the maximum; the
+  *         request is kept, so a later shorter scan or faster clock
+  *         returns to it.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef SRATE_Refresh(void)
+{
+  uint32_t max_rate;
+
+  if (srate_rate == 0U)
+  {
+    return HAL_OK;
+  }
+  max_rate = SRATE_GetMaxRate();
+  return SRATE_Apply((srate_rate < max_rate) ? srate_rate : max_rate);
+}
+
+/**
+  * @brief  Sets the number of conversions started by one trigger (scan length)
+  * @note   The sample time is re-derived and the requested rate applied
+  *         again through SRATE_Refresh().
+  * @param  conversions: regular sequence length
+  * @retval HAL status
+  */
+HAL_StatusTypeDef SRATE_SetConversions(uint8_t conversions)
+{
+  if (conversions == 0U)
+  {
+    return HAL_ERROR;
+  }
+  srate_conversions = conversions;
+  return SRATE_Refresh();
+}
+
+/**
+  * @brief  Requested sample rate
+  * @retval Rate in Hz; the running one may be lower while it exceeds
+  *         SRATE_GetMaxRate() (SRATE_GetActualRateMilliHz)
+  */
+uint32_t SRATE_GetRate(void)
+{
+  return srate_rate;
+}
+
+/**
+  * @brief  Rate actually produced by the timer dividers
+  * @retval Rate in mHz
+  */
+uint32_t SRATE_GetActualRateMilliHz(void)
+{
+  uint64_t divider;
+
+  if (srate_htim == NULL)
+  {
+    return 0U;
+  }
+  divider = ((uint64_t)srate_htim->Init.Prescaler + 1U) * ((uint64_t)srate_htim->Init.Period + 1U);
+  return (uint32_t)(((uint64_t)SRATE_TimerClock() * 1000U) / divider);
+}
+
+/**
+  * @brief  ADC sample time selected for the current rate
+  * @retval ADC_SAMPLETIME_x value
+  */
+uint32_t SRATE_GetSampleTime(void)
+{
+  return srate_sample_time;
+}
@@ -0,0 +1,118 @@
+/**
+  ******************************************************************************
+  * @file           : sched.c
+  * @brief          : Event-driven main loop with WFI sleep.
+  *
+  *                   Interrupt callbacks post event bits (SCHED_Post). The
+  *                   main loop calls SCHED_Wait, which returns at once if
+  *                   anything was posted since the last call and otherwise
+  *                   puts the core to sleep until an interrupt posts an
+  *                   event. The check and the WFI run with PRIMASK set: a
+  *                   pending interrupt still ends the WFI, but its handler
+  *                   only runs after the check, so an event posted just
+  *                   before the WFI cannot be slept through.
+  *
+  *                   SysTick still wakes the core every millisecond for the
+  *                   HAL tick; the loop goes back to sleep right away.
+  *
+  *                   Awake cycles are counted with the DWT counter around
+  *                   every sleep. The counter is not reliable while the core
+  *                   sleeps, so the total comes from the HAL tick and the
+  *                   sleep time is the difference.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sched.h"
+#include "cycle.h"
+
+/* Private variables ---------------------------------------------------------*/
+static volatile uint32_t sched_events = 0U;
+static uint32_t sched_mark = 0U;         /* DWT count when last woken */
+static uint32_t sched_awake = 0U;        /* awake cycles of the window */
+static uint32_t sched_window_tick = 0U;  /* HAL tick at the window start */
+
+/**
+  * @brief  Starts the load measurement, plain sleep (not deep sleep)
+  * @note   Needs CYCLE_Init(). Debug builds keep the debugger attached
+  *         while the core sleeps.
+  * @retval None
+  */
+void SCHED_Init(void)
+{
+  CLEAR_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk | SCB_SCR_SLEEPONEXIT_Msk);
+#ifdef DEBUG
+  HAL_DBGMCU_EnableDBGSleepMode();
+#endif
+  sched_awake = 0U;
+  sched_window_tick = HAL_GetTick();
+  sched_mark = CYCLE_Now();
+}
+
+/**
+  * @brief  Posts events to the main loop
+  * @note   Callable from interrupts.
+  * @param  events: SCHED_EVENT_x bits
+  * @retval None
+  */
+void SCHED_Post(uint32_t events)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  sched_events |= events;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Sleeps until at least one event is pending
+  * @retval Events posted since the previous call, cleared
+  */
+uint32_t SCHED_Wait(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t events;
+
+  __disable_irq();
+  while (sched_events == 0U)
+  {
+    sched_awake += CYCLE_Now() - sched_mark;
+    __DSB();
+    __WFI();
+    sched_mark = CYCLE_Now();
+
+    /* Let the interrupt that woke the core run */
+    __enable_irq();
+    __ISB();
+    __disable_irq();
+  }
+  events = sched_events;
+  sched_events = 0U;
+  __set_PRIMASK(primask);
+  return events;
+}
+
+/**
+  * @brief  CPU load since the previous call, starts a new window
+  * @param  load: destination
+  * @retval None
+  */
+void SCHED_GetLoad(SCHED_LoadTypeDef *load)
+{
+  uint32_t now = CYCLE_Now();
+  uint32_t tick = HAL_GetTick();
+  uint64_t total = (uint64_t)(tick - sched_window_tick) * (SystemCoreClock / 1000U);
+  uint64_t awake = (uint64_t)sched_awake + (now - sched_mark);
+
+  if (awake > total)
+  {
+    total = awake;
+  }
+  load->awake_cycles = (uint32_t)awake;
+  load->sleep_cycles = (uint32_t)(total - awake);
+  load->load = (total != 0U) ? (uint16_t)((awake * 10000U) / total) : 0U;
+
+  sched_awake = 0U;
+  sched_mark = now;
+  sched_window_tick = tick;
+}
@@ -0,0 +1,561 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum.c
+  * @brief          : Spectrum analysis of one channel with a Q15 FFT.
+  *
+  *                   One channel of consecutive blocks is collected into a
+  *                   record of 256..1024 samples; a lost or overwritten
+  *                   block starts the record again. SPEC_Process then takes
+  *                   the record apart in the main loop:
+  *
+  *                   - the mean is removed and the rest is scaled up to
+  *                     13 bits and multiplied by a Hann window, so a few
+  *                     counts of ripple on a supply keep their resolution
+  *                   - the N real samples are transformed as N/2 complex
+  *                     ones (even samples real, odd imaginary) with an
+  *                     in-place radix-2 FFT in Q15 and split into the N/2
+  *                     bins of the real spectrum, whose powers overwrite
+  *                     the record
+  *                   - the strongest bin is the fundamental; its frequency
+  *                     is interpolated from the two neighbours, its power
+  *                     and that of harmonics 2..SPEC_HARMONICS are summed
+  *                     over the main lobes and the mean of all other bins is
+  *                     the noise floor
+  *
+  *                   The FFT uses block floating point: before each stage
+  *                   the data is shifted down only if a butterfly could
+  *                   overflow, and the shifts are counted as an exponent.
+  *                   Twiddles, bit-reversed indices and window come from
+  *                   the flash tables in spectrum_tables.h.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "spectrum.h"
+#include "spectrum_tables.h"
+#include "acmeter.h"
+#include "oversample.h"
+#include "cycle.h"
+
+/* Private define ------------------------------------------------------------*/
+#if (SPEC_TABLE_POINTS != SPEC_MAX_POINTS)
+#error "spectrum_tables.h does not match SPEC_MAX_POINTS"
+#endif
+
+#define SPEC_Q15_SHIFT         15U
+#define SPEC_QUARTER           (SPEC_TABLE_POINTS / 4U)
+/* A butterfly grows a value by up to 1 + sqrt(2): below this limit its
+   results still fit into int16 */
+#define SPEC_BFP_LIMIT         8192
+/* Bins 0..SPEC_DC_BINS-1 hold what the window leaves of the mean */
+#define SPEC_DC_BINS           3U
+/* Bins on each side of the fundamental left out of the noise: the Hann
+   sidelobes of a strong signal fall only by 18 dB per octave */
+#define SPEC_SKIRT_BINS        8U
+/* Amplitude of a full-scale sine in ADC counts */
+#define SPEC_FULL_SCALE        2048U
+/* 10 * log10(2) in Q16 */
+#define SPEC_DB_PER_OCTAVE_Q16 197283
+#define SPEC_NOISE_MIN_Q8      (-200L * 256)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  SPEC_STATE_IDLE = 0U,
+  SPEC_STATE_COLLECT,
+  SPEC_STATE_READY
+} SPEC_StateTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+/* Record, then complex FFT data, then bin powers; lent out while the
+   analysis is off */
+static union
+{
+  int16_t sample[SPEC_MAX_POINTS];
+  uint32_t power[SPEC_MAX_POINTS / 2U];
+  uint16_t lent[SPEC_WORKSPACE_SIZE];
+} spec_work;
+/* Bins already taken by the fundamental or a harmonic */
+static uint32_t spec_used[SPEC_MAX_POINTS / 64U];
+
+static SPEC_StateTypeDef spec_state = SPEC_STATE_IDLE;
+static uint16_t spec_points = 512U;
+static uint8_t spec_rank = 0U;
+static uint16_t spec_count = 0U;
+static uint32_t spec_next_sequence = 0U;
+static uint8_t spec_channel = 0U;
+static uint32_t spec_rate_mhz = 0U;
+static uint8_t spec_touched = 0U;
+static SPEC_ResultTypeDef spec_result;
+static uint8_t spec_result_new = 0U;
+
+/* Private function prototypes -----------------------------------------------*/
+static int8_t SPEC_Window(uint16_t points);
+static uint8_t SPEC_Scale(int16_t *data, uint16_t length);
+static uint8_t SPEC_Fft(int16_t *z, uint16_t m);
+static void SPEC_PowerSpectrum(uint16_t points);
+static uint64_t SPEC_Lobe(uint16_t centre, uint16_t bins);
+static void SPEC_Exclude(uint16_t centre, uint16_t bins);
+static void SPEC_Analyse(void);
+
+/* Private user code ---------------------------------------------------------*/
+/* Removes the mean, scales to just below SPEC_BFP_LIMIT and applies the
+   window; returns the left shift of the input */
+static int8_t SPEC_Window(uint16_t points)
+{
+  int16_t *x = spec_work.sample;
+  const uint16_t stride = (uint16_t)(SPEC_TABLE_POINTS / points);
+  uint32_t sum = 0U;
+  uint16_t mean;
+  uint16_t deviation = 0U;
+  int8_t shift = 0;
+
+  for (uint16_t i = 0U; i < points; i++)
+  {
+    sum += (uint16_t)x[i];
+  }
+  mean = (uint16_t)((sum + (points / 2U)) / points);
+  for (uint16_t i = 0U; i < points; i++)
+  {
+    uint16_t d = (uint16_t)((x[i] > (int16_t)mean) ? (x[i] - mean) : (mean - x[i]));
+
+    if (d > deviation)
+    {
+      deviation = d;
+    }
+  }
+  if (deviation != 0U)
+  {
+    while ((shift < 14) && (((uint32_t)deviation << (shift + 1)) < (uint32_t)SPEC_BFP_LIMIT))
+    {
+      shift++;
+    }
+  }
+
+  for (uint16_t i = 0U; i < points; i++)
+  {
+    uint16_t k = (i <= (points / 2U)) ? i : (uint16_t)(points - i);
+    int32_t d = ((int32_t)x[i] - (int32_t)mean) * (1L << shift);
+
+    x[i] = (int16_t)(((d * spec_hann[k * stride]) + (1L << (SPEC_Q15_SHIFT - 1U))) >> SPEC_Q15_SHIFT);
+  }
+  return shift;
+}
+
+/* Block floating point: shifts the data below SPEC_BFP_LIMIT */
+static uint8_t SPEC_Scale(int16_t *data, uint16_t length)
+{
+  int32_t max = 0;
+  uint8_t shift = 0U;
+
+  for (uint16_t i = 0U; i < length; i++)
+  {
+    int32_t value = (data[i] < 0) ? -(int32_t)data[i] : data[i];
+
+    if (value > max)
+    {
+      max = value;
+    }
+  }
+  while ((max >> shift) >= SPEC_BFP_LIMIT)
+  {
+    shift++;
+  }
+  if (shift != 0U)
+  {
+    for (uint16_t i = 0U; i < length; i++)
+    {
+      data[i] = (int16_t)(data[i] >> shift);
+    }
+  }
+  return shift;
+}
+
+/* In-place complex FFT of m points (re, im interleaved); returns the right
+   shifts applied */
+static uint8_t SPEC_Fft(int16_t *z, uint16_t m)
+{
+  uint8_t rev_shift = 0U;
+  uint8_t exponent = 0U;
+
+  while (((SPEC_TABLE_POINTS / 2U) >> rev_shift) > m)
+  {
+    rev_shift++;
+  }
+  for (uint16_t i = 0U; i < m; i++)
+  {
+    uint16_t j = (uint16_t)(spec_bitrev[i] >> rev_shift);
+
+    if (i < j)
+    {
+      int16_t re = z[2U * i];
+      int16_t im = z[(2U * i) + 1U];
+
+      z[2U * i] = z[2U * j];
+      z[(2U * i) + 1U] = z[(2U * j) + 1U];
+      z[2U * j] = re;
+      z[(2U * j) + 1U] = im;
+    }
+  }
+
+  for (uint16_t len = 2U; len <= m; len <<= 1)
+  {
+    const uint16_t half = len / 2U;
+    const uint16_t step = (uint16_t)(SPEC_TABLE_POINTS / len);
+
+    exponent += SPEC_Scale(z, (uint16_t)(2U * m));
+    for (uint16_t j = 0U; j < half; j++)
+    {
+      /* W = exp(-2 pi i j / len) = c - i s */
+      const int32_t c = spec_sine[(j * step) + SPEC_QUARTER];
+      const int32_t s = spec_sine[j * step];
+
+      for (uint16_t a = (uint16_t)(2U * j); a < (2U * m); a += (uint16_t)(2U * len))
+      {
+        const uint16_t b = (uint16_t)(a + len);
+        int32_t tr = ((c * z[b]) + (s * z[b + 1U]) + (1L << (SPEC_Q15_SHIFT - 1U))) >> SPEC_Q15_SHIFT;
+        int32_t ti = ((c * z[b + 1U]) - (s * z[b]) + (1L << (SPEC_Q15_SHIFT - 1U))) >> SPEC_Q15_SHIFT;
+        int32_t ar = z[a];
+        int32_t ai = z[a + 1U];
+
+        z[a] = (int16_t)(ar + tr);
+        z[a + 1U] = (int16_t)(ai + ti);
+        z[b] = (int16_t)(ar - tr);
+        z[b + 1U] = (int16_t)(ai - ti);
+      }
+    }
+  }
+  return exponent;
+}
+
+/* Turns the N/2-point complex spectrum of the packed record into the powers
+   of bins 0..N/2-1 of the real one, in place (power k replaces Z[k]) */
+static void SPEC_PowerSpectrum(uint16_t points)
+{
+  int16_t *z = spec_work.sample;
+  const uint16_t m = points / 2U;
+  const uint16_t stride = (uint16_t)(SPEC_TABLE_POINTS / points);
+  int32_t dc = (int32_t)z[0] + z[1];
+
+  for (uint16_t k = 1U; k <= (m / 2U); k++)
+  {
+    const uint16_t l = (uint16_t)(m - k);
+    const int32_t c = spec_sine[(k * stride) + SPEC_QUARTER];
+    const int32_t s = spec_sine[k * stride];
+    /* Twice the even and odd parts: Fe = (Z[k] + Z*[l]) / 2,
+       Fo = -i (Z[k] - Z*[l]) / 2 */
+    int32_t fe_re = (int32_t)z[2U * k] + z[2U * l];
+    int32_t fe_im = (int32_t)z[(2U * k) + 1U] - z[(2U * l) + 1U];
+    int32_t fo_re = (int32_t)z[(2U * k) + 1U] + z[(2U * l) + 1U];
+    int32_t fo_im = (int32_t)z[2U * l] - z[2U * k];
+    /* W * Fo, W = exp(-2 pi i k / N) */
+    int32_t wr = ((c * fo_re) + (s * fo_im) + (1L << (SPEC_Q15_SHIFT - 1U))) >> SPEC_Q15_SHIFT;
+    int32_t wi = ((c * fo_im) - (s * fo_re) + (1L << (SPEC_Q15_SHIFT - 1U))) >> SPEC_Q15_SHIFT;
+    /* X[k] = Fe + W Fo, X[l] = (Fe - W Fo)* */
+    int64_t xr = (int64_t)fe_re + wr;
+    int64_t xi = (int64_t)fe_im + wi;
+    int64_t yr = (int64_t)fe_re - wr;
+    int64_t yi = (int64_t)fe_im - wi;
+
+    spec_work.power[k] = (uint32_t)((uint64_t)((xr * xr) + (xi * xi)) >> 2);
+    spec_work.power[l] = (uint32_t)((uint64_t)((yr * yr) + (yi * yi)) >> 2);
+  }
+  spec_work.power[0] = (uint32_t)(dc * dc);
+}
+
+/* Power of the bins around centre that no other peak has taken yet */
+static uint64_t SPEC_Lobe(uint16_t centre, uint16_t bins)
+{
+  uint16_t first = (centre > SPEC_LOBE_BINS) ? (uint16_t)(centre - SPEC_LOBE_BINS) : 0U;
+  uint16_t last = (uint16_t)(centre + SPEC_LOBE_BINS);
+  uint64_t power = 0U;
+
+  if (last >= bins)
+  {
+    last = (uint16_t)(bins - 1U);
+  }
+  for (uint16_t k = first; k <= last; k++)
+  {
+    if ((spec_used[k / 32U] & (1UL << (k % 32U))) == 0U)
+    {
+      spec_used[k / 32U] |= 1UL << (k % 32U);
+      power += spec_work.power[k];
+    }
+  }
+  return power;
+}
+
+/* Takes the skirt around centre out of the noise */
+static void SPEC_Exclude(uint16_t centre, uint16_t bins)
+{
+  uint16_t first = (centre > SPEC_SKIRT_BINS) ? (uint16_t)(centre - SPEC_SKIRT_BINS) : 0U;
+  uint16_t last = (uint16_t)(centre + SPEC_SKIRT_BINS);
+
+  if (last >= bins)
+  {
+    last = (uint16_t)(bins - 1U);
+  }
+  for (uint16_t k = first; k <= last; k++)
+  {
+    spec_used[k / 32U] |= 1UL << (k % 32U);
+  }
+}
+
+static void SPEC_Analyse(void)
+{
+  SPEC_ResultTypeDef *r = &spec_result;
+  const uint16_t n = spec_points;
+  const uint16_t m = n / 2U;
+  int32_t exponent;
+  uint16_t peak = SPEC_DC_BINS;
+  uint32_t below;
+  uint32_t top;
+  uint32_t above;
+  int32_t delta_q16;
+  uint32_t position_q16;
+  uint64_t fundamental;
+  uint64_t harmonics = 0U;
+  uint64_t noise = 0U;
+  uint16_t noise_bins = 0U;
+  uint64_t value;
+
+  exponent = -(int32_t)SPEC_Window(n);
+  exponent += SPEC_Fft(spec_work.sample, m);
+  SPEC_PowerSpectrum(n);
+
+  for (uint16_t i = 0U; i < (SPEC_MAX_POINTS / 64U); i++)
+  {
+    spec_used[i] = 0U;
+  }
+  for (uint16_t k = 0U; k < SPEC_DC_BINS; k++)
+  {
+    spec_used[0] |= 1UL << k;
+  }
+  for (uint16_t k = SPEC_DC_BINS; k < (m - 1U); k++)
+  {
+    if (spec_work.power[k] > spec_work.power[peak])
+    {
+      peak = k;
+    }
+  }
+
+  /* Hann window: delta = 2 (a+ - a-) / (a- + 2 a0 + a+) bins */
+  below = AC_Isqrt(spec_work.power[peak - 1U]);
+  top = AC_Isqrt(spec_work.power[peak]);
+  above = AC_Isqrt(spec_work.power[peak + 1U]);
+  delta_q16 = 0;
+  if (top != 0U)
+  {
+    delta_q16 = (int32_t)((((int64_t)above - (int64_t)below) << 17) /
+                          (int64_t)(below + (2U * top) + above));
+  }
+  position_q16 = (uint32_t)(((int32_t)peak << 16) + delta_q16);
+
+  fundamental = SPEC_Lobe(peak, m);
+  SPEC_Exclude(peak, m);
+  for (uint32_t h = 2U; h <= SPEC_HARMONICS; h++)
+  {
+    uint32_t centre = ((h * position_q16) + 0x8000U) >> 16;
+
+    if ((centre + SPEC_LOBE_BINS) >= m)
+    {
+      break;
+    }
+    harmonics += SPEC_Lobe((uint16_t)centre, m);
+  }
+  for (uint16_t k = SPEC_DC_BINS; k < m; k++)
+  {
+    if ((spec_used[k / 32U] & (1UL << (k % 32U))) == 0U)
+    {
+      noise += spec_work.power[k];
+      noise_bins++;
+    }
+  }
+
+  r->points = n;
+  r->channel = spec_channel;
+  r->frequency_mhz = (top != 0U) ?
+                     (uint32_t)(((uint64_t)position_q16 * spec_rate_mhz) / ((uint64_t)n << 16)) : 0U;
+
+  /* A sine of amplitude A leaves 3 N^2 A^2 / 32 in its lobe, the stored
+     powers are 4^exponent too small; RMS^2 = A^2 / 2 */
+  value = (fundamental << 20) / (3U * (uint32_t)n * n);
+  value = (exponent >= 0) ? (value << (2 * exponent)) : (value >> (-2 * exponent));
+  r->rms_q8 = AC_Isqrt(value);
+
+  r->thd_ppm = 0U;
+  if (fundamental != 0U)
+  {
+    value = (harmonics * 1000000U) / fundamental;
+    r->thd_ppm = AC_Isqrt(((value > 1000000000U) ? 1000000000U : value) * 1000000U);
+  }
+
+  r->noise_dbfs_q8 = (int32_t)SPEC_NOISE_MIN_Q8;
+  if ((noise_bins != 0U) && ((noise / noise_bins) != 0U))
+  {
+    int64_t octaves_q16 = (int64_t)OVS_Log2Q16(noise / noise_bins) + ((int64_t)exponent << 17) -
+                          (int64_t)OVS_Log2Q16((3ULL * n * n * SPEC_FULL_SCALE * SPEC_FULL_SCALE) / 32U);
+    int64_t db_q8 = (octaves_q16 * SPEC_DB_PER_OCTAVE_Q16) / (1L << 24);
+
+    if (db_q8 > SPEC_NOISE_MIN_Q8)
+    {
+      r->noise_dbfs_q8 = (int32_t)db_q8;
+    }
+  }
+}
+
+/**
+  * @brief  Sets the record length and the analysed channel, restarts
+  *         the record
+  * @param  points: SPEC_MIN_POINTS..SPEC_MAX_POINTS, a power of two
+  * @param  rank: channel, position in the scan list
+  * @retval HAL_ERROR on bad arguments
+  */
+HAL_StatusTypeDef SPEC_Config(uint16_t points, uint8_t rank)
+{
+  if ((points < SPEC_MIN_POINTS) || (points > SPEC_MAX_POINTS) ||
+      ((points & (points - 1U)) != 0U) || (rank >= ACQ_MAX_CHANNELS))
+  {
+    return HAL_ERROR;
+  }
+  spec_points = points;
+  spec_rank = rank;
+  spec_count = 0U;
+  spec_result_new = 0U;
+  if (spec_state != SPEC_STATE_IDLE)
+  {
+    spec_state = SPEC_STATE_COLLECT;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Starts or stops collecting records
+  * @param  enable: 1 to analyse, 0 to stop
+  * @retval None
+  */
+void SPEC_Enable(uint8_t enable)
+{
+  spec_count = 0U;
+  spec_result_new = 0U;
+  spec_state = (enable != 0U) ? SPEC_STATE_COLLECT : SPEC_STATE_IDLE;
+}
+
+/**
+  * @brief  Analysis state
+  * @retval 1 if enabled
+  */
+uint8_t SPEC_IsEnabled(void)
+{
+  return (spec_state != SPEC_STATE_IDLE) ? 1U : 0U;
+}
+
+/**
+  * @brief  Appends the analysed channel of a block to the record
+  * @note   Call before ACQ_ReleaseBlock(), the samples are read from the
+  *         DMA buffer.
+  * @param  block: unpacked block
+  * @retval None
+  */
+void SPEC_Block(const ACQ_BlockTypeDef *block)
+{
+  uint8_t channel_list[ACQ_MAX_CHANNELS];
+  uint32_t rate_mhz;
+
+  spec_touched = 0U;
+  if ((spec_state != SPEC_STATE_COLLECT) || (spec_rank >= block->channels))
+  {
+    return;
+  }
+  (void)ACQ_GetChannels(channel_list);
+  rate_mhz = ACQ_GetSampleRateMilliHz();
+
+  /* The record must be one gapless run at one rate */
+  if ((spec_count != 0U) &&
+      ((block->sequence != spec_next_sequence) || (channel_list[spec_rank] != spec_channel) ||
+       (rate_mhz != spec_rate_mhz)))
+  {
+    spec_count = 0U;
+  }
+  if (spec_count == 0U)
+  {
+    spec_channel = channel_list[spec_rank];
+    spec_rate_mhz = rate_mhz;
+  }
+
+  for (uint16_t i = spec_rank; (i < block->length) && (spec_count < spec_points); i += block->channels)
+  {
+    spec_work.sample[spec_count++] = (int16_t)block->data[i];
+  }
+  spec_next_sequence = block->sequence + 1U;
+  spec_touched = 1U;
+}
+
+/**
+  * @brief  Confirms the block taken by SPEC_Block
+  * @param  valid: ACQ_ReleaseBlock() result, 0 starts the record again
+  * @retval None
+  */
+void SPEC_Release(uint8_t valid)
+{
+  if (spec_touched == 0U)
+  {
+    return;
+  }
+  spec_touched = 0U;
+  if (valid == 0U)
+  {
+    spec_count = 0U;
+  }
+  else if (spec_count == spec_points)
+  {
+    spec_state = SPEC_STATE_READY;
+  }
+}
+
+/**
+  * @brief  Analyses a complete record and starts the next one
+  * @note   Call from the main loop; 1024 points take a few ms.
+  * @retval 1 if a new result is available
+  */
+uint8_t SPEC_Process(void)
+{
+  uint32_t start;
+
+  if (spec_state != SPEC_STATE_READY)
+  {
+    return 0U;
+  }
+  start = CYCLE_Now();
+  SPEC_Analyse();
+  spec_result.cycles = CYCLE_Now() - start;
+  spec_result_new = 1U;
+  spec_count = 0U;
+  spec_state = SPEC_STATE_COLLECT;
+  return 1U;
+}
+
+/**
+  * @brief  Latest analysis
+  * @param  result: destination
+  * @retval 1 if it is new since the last call
+  */
+uint8_t SPEC_GetResult(SPEC_ResultTypeDef *result)
+{
+  uint8_t fresh = spec_result_new;
+
+  *result = spec_result;
+  spec_result_new = 0U;
+  return fresh;
+}
+
+/**
+  * @brief  Record memory for another stage while the analysis is off
+  * @note   The borrower has to stop using it before SPEC_Enable(1); the
+  *         moving average does so in FORMAT FFT.
+  * @retval SPEC_WORKSPACE_SIZE values
+  */
+uint16_t *SPEC_GetWorkspace(void)
+{
+  return spec_work.lent;
+}
@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file           : stats.c
+  * @brief          : Per-channel running statistics over interleaved blocks.
+  *
+  *                   A scan block holds the channels interleaved in rank
+  *                   order: ch0 ch1 .. chN-1 ch0 ch1 .. The statistics are
+  *                   taken in place with a stride, nothing is copied out of
+  *                   the DMA buffer. A block is first reduced on its own and
+  *                   merged into the running totals only once the acquisition
+  *                   layer confirms the block was not overwritten.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stats.h"
+
+/**
+  * @brief  Clears the statistics of all channels
+  * @param  stats: array of channels entries
+  * @param  channels: number of channels
+  * @retval None
+  */
+void STATS_Reset(STATS_ChannelTypeDef *stats, uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    stats[ch].sum = 0U;
+    stats[ch].count = 0U;
+    stats[ch].min = UINT16_MAX;
+    stats[ch].max = 0U;
+  }
+}
+
+/**
+  * @brief  Reduces one interleaved block into per-channel statistics
+  * @param  stats: array of channels entries, overwritten
+  * @param  data: interleaved samples
+  * @param  length: total number of samples, a multiple of channels
+  * @param  channels: interleave stride
+  * @retval None
+  */
+void STATS_Block(STATS_ChannelTypeDef *stats, const uint16_t *data,
+                 uint16_t length, uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    uint32_t sum = 0U;
+    uint16_t min = UINT16_MAX;
+    uint16_t max = 0U;
+    uint32_t count = 0U;
+
+    for (uint16_t i = ch; i < length; i += channels)
+    {
+      uint16_t sample = data[i];
+
+      sum += sample;
+      if (sample < min)
+      {
+        min = sample;
+      }
+      if (sample > max)
+      {
+        max = sample;
+      }
+      count++;
+    }
+
+    stats[ch].sum = sum;
+    stats[ch].count = count;
+    stats[ch].min = min;
+    stats[ch].max = max;
+  }
+}
+
+/**
+  * @brief  Adds block statistics to running totals
+  * @param  total: running statistics
+  * @param  block: statistics of one block (STATS_Block)
+  * @param  channels: number of channels
+  * @retval None
+  */
+void STATS_Merge(STATS_ChannelTypeDef *total, const STATS_ChannelTypeDef *block,
+                 uint8_t channels)
+{
+  for (uint8_t ch = 0U; ch < channels; ch++)
+  {
+    total[ch].sum += block[ch].sum;
+    total[ch].count += block[ch].count;
+    if (block[ch].min < total[ch].min)
+    {
+      total[ch].min = block[ch].min;
+    }
+    if (block[ch].max > total[ch].max)
+    {
+      total[ch].max = block[ch].max;
+    }
+  }
+}
+
+/**
+  * @brief  Mean of the samples accumulated since the last reset
+  * @param  stats: one channel
+  * @retval Mean in ADC counts, 0 if no sample was taken
+  */
+uint16_t STATS_Mean(const STATS_ChannelTypeDef *stats)
+{
+  if (stats->count == 0U)
+  {
+    return 0U;
+  }
+  return (uint16_t)(stats->sum / stats->count);
+}
@@ -0,0 +1,128 @@
+/**
+  ******************************************************************************
+  * @file           : stream.c
+  * @brief          : Raw sample streaming over the UART TX ring.
+  *
+  *                   The main loop encodes a block straight from the DMA
+  *                   buffer (STREAM_Encode) and, once the acquisition layer
+  *                   confirmed that the block was not overwritten meanwhile,
+  *                   queues the frame (STREAM_Send). A frame that does not
+  *                   fit into the TX ring is dropped as a whole; the host
+  *                   sees the gap in the block sequence numbers.
+  *
+  *                   Throughput: a frame of S samples on N channels takes
+  *                   1.5 * S + N + 16 bytes (header 12, CRC 2, COBS 1 per
+  *                   254, delimiter 1), S = ACQ_SCANS_PER_HALF * N. At
+  *                   2 Mbaud (200 kB/s) that is 41 bytes per 16 samples or
+  *                   78 kS/s for one channel, 105 kS/s for three and
+  *                   121 kS/s for twelve (317-byte frames).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stream.h"
+#include "stream_frame.h"
+#include "uart_tx.h"
+
+/* Private define ------------------------------------------------------------*/
+#if ((ACQ_BUFFER_SIZE / 2U) > SFRAME_MAX_SAMPLES) || (ACQ_MAX_CHANNELS > SFRAME_MAX_CHANNELS)
+#error "An acquisition block does not fit into one stream frame"
+#endif
+
+#if (SFRAME_ENCODED_MAX > UTX_BUFFER_SIZE)
+#error "UTX_BUFFER_SIZE cannot hold one stream frame"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t stream_enabled = 0U;
+static uint8_t stream_frame[SFRAME_ENCODED_MAX];
+static uint16_t stream_length = 0U;
+static STREAM_StatsTypeDef stream_stats;
+
+/**
+  * @brief  Switches streaming on or off
+  * @note   The text report must stay quiet while streaming, the host
+  *         decoder would only see broken frames.
+  * @param  enable: 1 to stream every block
+  * @retval None
+  */
+void STREAM_Enable(uint8_t enable)
+{
+  stream_enabled = (enable != 0U) ? 1U : 0U;
+  stream_length = 0U;
+}
+
+/**
+  * @brief  Streaming state
+  * @retval 1 if enabled
+  */
+uint8_t STREAM_IsEnabled(void)
+{
+  return stream_enabled;
+}
+
+/**
+  * @brief  Encodes a block into the pending frame
+  * @note   Call before ACQ_ReleaseBlock(), the samples are read from the
+  *         DMA buffer.
+  * @param  block: unpacked block
+  * @retval Frame length in bytes, 0 if streaming is off
+  */
+uint16_t STREAM_Encode(const ACQ_BlockTypeDef *block)
+{
+  SFRAME_HeaderTypeDef header;
+  uint8_t channel_list[ACQ_MAX_CHANNELS];
+
+  stream_length = 0U;
+  if (stream_enabled == 0U)
+  {
+    return 0U;
+  }
+
+  (void)ACQ_GetChannels(channel_list);
+  header.type = SFRAME_TYPE_SAMPLES;
+  header.channels = block->channels;
+  header.samples = block->length;
+  header.sequence = block->sequence;
+  header.rate_mhz = ACQ_GetSampleRateMilliHz();
+
+  stream_length = SFRAME_Encode(stream_frame, NULL, &header, channel_list, block->data);
+  return stream_length;
+}
+
+/**
+  * @brief  Queues the pending frame on the UART
+  * @param  valid: ACQ_ReleaseBlock() result, 0 discards the frame
+  * @retval None
+  */
+void STREAM_Send(uint8_t valid)
+{
+  if (stream_length == 0U)
+  {
+    return;
+  }
+
+  if (valid == 0U)
+  {
+    stream_stats.frames_torn++;
+  }
+  else if (UTX_Write(stream_frame, stream_length) == HAL_OK)
+  {
+    stream_stats.frames_sent++;
+  }
+  else
+  {
+    stream_stats.frames_dropped++;
+  }
+  stream_length = 0U;
+}
+
+/**
+  * @brief  Copies the streaming counters
+  * @param  stats: destination
+  * @retval None
+  */
+void STREAM_GetStats(STREAM_StatsTypeDef *stats)
+{
+  *stats = stream_stats;
+}
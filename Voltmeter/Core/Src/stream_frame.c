@@ -0,0 +1,307 @@
+/**
+  ******************************************************************************
+  * @file           : stream_frame.c
+  * @brief          : Binary sample frame encoder and decoder.
+  *
+  *                   A frame carries one acquisition block: a small header,
+  *                   the samples packed 12 bits each and a CRC. COBS byte
+  *                   stuffing removes every 0x00 from the frame, so a single
+  *                   0x00 marks the frame end and a receiver resynchronises
+  *                   on the next delimiter after any loss or corruption.
+  *
+  *                   No HAL dependency: the host decoder builds this file
+  *                   as is.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "stream_frame.h"
+
+/* Private variables ---------------------------------------------------------*/
+/* Unstuffed frame of SFRAME_Encode(raw = NULL); the stream, the capture and
+   the log dump all encode from the main loop, one frame at a time */
+static uint8_t sframe_raw[SFRAME_RAW_MAX];
+
+/* CRC-16/CCITT (poly 0x1021) of one nibble, two lookups per byte */
+static const uint16_t sframe_crc_nibble[16] =
+{
+  0x0000U, 0x1021U, 0x2042U, 0x3063U, 0x4084U, 0x50A5U, 0x60C6U, 0x70E7U,
+  0x8108U, 0x9129U, 0xA14AU, 0xB16BU, 0xC18CU, 0xD1ADU, 0xE1CEU, 0xF1EFU
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void SFRAME_Put16(uint8_t *dst, uint16_t value);
+static void SFRAME_Put32(uint8_t *dst, uint32_t value);
+static uint16_t SFRAME_Get16(const uint8_t *src);
+static uint32_t SFRAME_Get32(const uint8_t *src);
+
+/* Private user code ---------------------------------------------------------*/
+static void SFRAME_Put16(uint8_t *dst, uint16_t value)
+{
+  dst[0] = (uint8_t)value;
+  dst[1] = (uint8_t)(value >> 8);
+}
+
+static void SFRAME_Put32(uint8_t *dst, uint32_t value)
+{
+  SFRAME_Put16(dst, (uint16_t)value);
+  SFRAME_Put16(dst + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t SFRAME_Get16(const uint8_t *src)
+{
+  return (uint16_t)(src[0] | ((uint16_t)src[1] << 8));
+}
+
+static uint32_t SFRAME_Get32(const uint8_t *src)
+{
+  return SFRAME_Get16(src) | ((uint32_t)SFRAME_Get16(src + 2) << 16);
+}
+
+/**
+  * @brief  CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection)
+  * @param  data: bytes to check
+  * @param  length: number of bytes
+  * @retval CRC value
+  */
+uint16_t SFRAME_Crc16(const uint8_t *data, uint16_t length)
+{
+  uint16_t crc = 0xFFFFU;
+
+  for (uint16_t i = 0U; i < length; i++)
+  {
+    crc = (uint16_t)(crc << 4) ^ sframe_crc_nibble[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (uint16_t)(crc << 4) ^ sframe_crc_nibble[(crc >> 12) ^ (data[i] & 0x0FU)];
+  }
+  return crc;
+}
+
+/**
+  * @brief  Packs 12-bit samples two per three bytes
+  * @note   a, b -> a[7:0], b[3:0]a[11:8], b[11:4]; an odd last sample is
+  *         stored as a[7:0], a[11:8].
+  * @param  dst: SFRAME_PACKED_SIZE(count) bytes
+  * @param  samples: right-aligned 12-bit samples
+  * @param  count: number of samples
+  * @retval Bytes written
+  */
+uint16_t SFRAME_Pack12(uint8_t *dst, const uint16_t *samples, uint16_t count)
+{
+  uint8_t *p = dst;
+  uint16_t i;
+
+  for (i = 0U; (i + 1U) < count; i += 2U)
+  {
+    uint16_t a = samples[i] & 0x0FFFU;
+    uint16_t b = samples[i + 1U] & 0x0FFFU;
+
+    *p++ = (uint8_t)a;
+    *p++ = (uint8_t)((a >> 8) | (b << 4));
+    *p++ = (uint8_t)(b >> 4);
+  }
+  if (i < count)
+  {
+    *p++ = (uint8_t)samples[i];
+    *p++ = (uint8_t)((samples[i] >> 8) & 0x0FU);
+  }
+  return (uint16_t)(p - dst);
+}
+
+/**
+  * @brief  Reverses SFRAME_Pack12()
+  * @param  samples: count output samples
+  * @param  src: packed bytes
+  * @param  count: number of samples
+  * @retval None
+  */
+void SFRAME_Unpack12(uint16_t *samples, const uint8_t *src, uint16_t count)
+{
+  uint16_t i;
+
+  for (i = 0U; (i + 1U) < count; i += 2U)
+  {
+    samples[i] = (uint16_t)(src[0] | ((uint16_t)(src[1] & 0x0FU) << 8));
+    samples[i + 1U] = (uint16_t)((src[1] >> 4) | ((uint16_t)src[2] << 4));
+    src += 3;
+  }
+  if (i < count)
+  {
+    samples[i] = (uint16_t)(src[0] | ((uint16_t)(src[1] & 0x0FU) << 8));
+  }
+}
+
+/**
+  * @brief  COBS-encodes a buffer, the delimiter is not appended
+  * @param  dst: SFRAME_COBS_SIZE(length) bytes, must not overlap src
+  * @param  src: data
+  * @param  length: number of bytes
+  * @retval Encoded length, output contains no 0x00
+  */
+uint16_t SFRAME_CobsEncode(uint8_t *dst, const uint8_t *src, uint16_t length)
+{
+  uint16_t code_pos = 0U;
+  uint16_t out = 1U;
+  uint8_t code = 1U;
+
+  for (uint16_t i = 0U; i < length; i++)
+  {
+    if (src[i] == 0U)
+    {
+      dst[code_pos] = code;
+      code_pos = out++;
+      code = 1U;
+    }
+    else
+    {
+      dst[out++] = src[i];
+      code++;
+      if (code == 0xFFU)
+      {
+        dst[code_pos] = code;
+        code_pos = out++;
+        code = 1U;
+      }
+    }
+  }
+  dst[code_pos] = code;
+  return out;
+}
+
+/**
+  * @brief  Decodes one COBS block (delimiter removed)
+  * @param  dst: at least length - 1 bytes
+  * @param  src: encoded bytes
+  * @param  length: number of encoded bytes
+  * @retval Decoded length, 0 if the input is malformed
+  */
+uint16_t SFRAME_CobsDecode(uint8_t *dst, const uint8_t *src, uint16_t length)
+{
+  uint16_t in = 0U;
+  uint16_t out = 0U;
+
+  while (in < length)
+  {
+    uint8_t code = src[in++];
+
+    if ((code == 0U) || ((uint32_t)in + code - 1U > length))
+    {
+      return 0U;
+    }
+    for (uint8_t i = 1U; i < code; i++)
+    {
+      if (src[in] == 0U)
+      {
+        return 0U;
+      }
+      dst[out++] = src[in++];
+    }
+    if ((code != 0xFFU) && (in < length))
+    {
+      dst[out++] = 0U;
+    }
+  }
+  return out;
+}
+
+/**
+  * @brief  Builds a complete stuffed frame with its delimiter
+  * @param  dst: SFRAME_ENCODED_MAX bytes
+  * @param  raw: scratch of SFRAME_RAW_MAX bytes for the unstuffed frame,
+  *              NULL for the one shared by all callers of the same context
+  * @param  header: header fields, channels and samples within limits
+  * @param  channel_list: header->channels ADC channel numbers
+  * @param  samples: header->samples samples in rank order
+  * @retval Bytes to send, 0 if the header is out of limits
+  */
+uint16_t SFRAME_Encode(uint8_t *dst, uint8_t *raw, const SFRAME_HeaderTypeDef *header,
+                       const uint8_t *channel_list, const uint16_t *samples)
+{
+  uint16_t length;
+
+  if ((header->channels == 0U) || (header->channels > SFRAME_MAX_CHANNELS) ||
+      (header->samples > SFRAME_MAX_SAMPLES))
+  {
+    return 0U;
+  }
+  if (raw == NULL)
+  {
+    raw = sframe_raw;
+  }
+
+  raw[0] = header->type;
+  raw[1] = header->channels;
+  SFRAME_Put16(&raw[2], header->samples);
+  SFRAME_Put32(&raw[4], header->sequence);
+  SFRAME_Put32(&raw[8], header->rate_mhz);
+  length = SFRAME_HEADER_SIZE;
+
+  for (uint8_t ch = 0U; ch < header->channels; ch++)
+  {
+    raw[length++] = channel_list[ch];
+  }
+  length += SFRAME_Pack12(&raw[length], samples, header->samples);
+  SFRAME_Put16(&raw[length], SFRAME_Crc16(raw, length));
+  length += SFRAME_CRC_SIZE;
+
+  length = SFRAME_CobsEncode(dst, raw, length);
+  dst[length++] = 0U;
+  return length;
+}
+
+/**
+  * @brief  Checks and unpacks one frame received between two delimiters
+  * @param  src: stuffed frame without the delimiter
+  * @param  length: number of bytes
+  * @param  raw: scratch of SFRAME_ENCODED_MAX bytes
+  * @param  header: receives the header fields
+  * @param  channel_list: receives up to SFRAME_MAX_CHANNELS channel numbers
+  * @param  samples: receives up to SFRAME_MAX_SAMPLES samples
+  * @retval SFRAME_OK or the reason the frame was rejected
+  */
+SFRAME_StatusTypeDef SFRAME_Decode(const uint8_t *src, uint16_t length, uint8_t *raw,
+                                   SFRAME_HeaderTypeDef *header, uint8_t *channel_list,
+                                   uint16_t *samples)
+{
+  uint16_t size;
+  uint16_t offset;
+
+  if (length >= SFRAME_ENCODED_MAX)
+  {
+    return SFRAME_ERR_LENGTH;
+  }
+  size = SFRAME_CobsDecode(raw, src, length);
+  if (size == 0U)
+  {
+    return SFRAME_ERR_COBS;
+  }
+  if (size < (SFRAME_HEADER_SIZE + SFRAME_CRC_SIZE))
+  {
+    return SFRAME_ERR_LENGTH;
+  }
+  size -= SFRAME_CRC_SIZE;
+  if (SFRAME_Crc16(raw, size) != SFRAME_Get16(&raw[size]))
+  {
+    return SFRAME_ERR_CRC;
+  }
+
+  header->type = raw[0];
+  header->channels = raw[1];
+  header->samples = SFRAME_Get16(&raw[2]);
+  header->sequence = SFRAME_Get32(&raw[4]);
+  header->rate_mhz = SFRAME_Get32(&raw[8]);
+  if ((header->channels == 0U) || (header->channels > SFRAME_MAX_CHANNELS) ||
+      (header->samples > SFRAME_MAX_SAMPLES) ||
+      (size != (SFRAME_HEADER_SIZE + header->channels + SFRAME_PACKED_SIZE(header->samples))))
+  {
+    return SFRAME_ERR_LENGTH;
+  }
+
+  offset = SFRAME_HEADER_SIZE;
+  for (uint8_t ch = 0U; ch < header->channels; ch++)
+  {
+    channel_list[ch] = raw[offset++];
+  }
+  SFRAME_Unpack12(samples, &raw[offset], header->samples);
+  return SFRAME_OK;
+}
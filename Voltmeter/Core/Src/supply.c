@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+  * @file           : supply.c
+  * @brief          : Ratiometric supply compensation with Vrefint.
+  *
+  *                   The ADC measures against VDDA, which is the 3.3 V rail
+  *                   and sags with the load. Every SUP_PERIOD_MS the main
+  *                   loop submits one injected conversion of Vrefint
+  *                   (inject.c) and picks the result up on a later pass,
+  *                   so it never waits for the ADC. VDDA follows from
+  *                   Vrefint * 4095 / reading; the readings are smoothed
+  *                   and the estimate is handed to voltage.c, which scales
+  *                   every conversion with it.
+  *
+  *                   The injected conversion interrupts the regular scan
+  *                   for 252 ADC clocks (Vrefint needs 17.1 us of sampling,
+  *                   239.5 cycles at 8 MHz), which delays one scan by about
+  *                   32 us; at sample rates above ~30 kHz one trigger is
+  *                   lost per period. In the dual modes the pairing of
+  *                   ADC1 and ADC2 would break, so no readings are taken
+  *                   there and the last estimate is kept.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "supply.h"
+#include "acquisition.h"
+#include "inject.h"
+#include "voltage.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Vrefint reading range for SUP_VDDA_MAX_UV .. SUP_VDDA_MIN_UV */
+#define SUP_RAW_MIN            ((uint16_t)(((uint64_t)SUP_VREFINT_UV * VOLT_ADC_MAX) / SUP_VDDA_MAX_UV))
+#define SUP_RAW_MAX            ((uint16_t)(((uint64_t)SUP_VREFINT_UV * VOLT_ADC_MAX) / SUP_VDDA_MIN_UV))
+
+/* Private variables ---------------------------------------------------------*/
+static INJ_RequestTypeDef sup_request;
+static uint8_t sup_enabled = 0U;
+static uint8_t sup_pending = 0U;
+static uint32_t sup_tick = 0U;
+static uint32_t sup_filtered = 0U;   /* Smoothed reading, Q8; 0 - none yet */
+static uint32_t sup_vdda_uv = VOLT_VREF_UV;
+static SUP_StatsTypeDef sup_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static void SUP_Update(uint16_t raw);
+
+/* Private user code ---------------------------------------------------------*/
+static void SUP_Update(uint16_t raw)
+{
+  sup_stats.conversions++;
+  if ((raw < SUP_RAW_MIN) || (raw > SUP_RAW_MAX))
+  {
+    sup_stats.rejected++;
+    return;
+  }
+
+  if (sup_filtered == 0U)
+  {
+    sup_filtered = (uint32_t)raw << 8;
+  }
+  else
+  {
+    sup_filtered = (uint32_t)((int32_t)sup_filtered +
+                              ((((int32_t)raw << 8) - (int32_t)sup_filtered) >> SUP_FILTER_SHIFT));
+  }
+
+  /* VDDA = Vrefint * 4095 / reading, once per period */
+  sup_vdda_uv = (uint32_t)((((uint64_t)SUP_VREFINT_UV * VOLT_ADC_MAX << 8) +
+                            (sup_filtered / 2U)) / sup_filtered);
+  VOLT_SetSupply(sup_vdda_uv);
+}
+
+/**
+  * @brief  Switches the compensation on or off
+  * @note   Off returns to the nominal 3.3 V scale.
+  * @param  enable: 1 - measure VDDA and compensate
+  * @retval None
+  */
+void SUP_Enable(uint8_t enable)
+{
+  sup_enabled = enable;
+  sup_filtered = 0U;
+  sup_vdda_uv = VOLT_VREF_UV;
+  sup_tick = HAL_GetTick() - SUP_PERIOD_MS;
+  VOLT_SetSupply(VOLT_VREF_UV);
+}
+
+/**
+  * @brief  Starts and collects the Vrefint conversions
+  * @note   Call from the main loop; returns at once.
+  * @retval None
+  */
+void SUP_Process(void)
+{
+  if (sup_pending != 0U)
+  {
+    if (INJ_IsFinished(&sup_request) == 0U)
+    {
+      return;
+    }
+    sup_pending = 0U;
+    if ((sup_request.state == INJ_STATE_DONE) && (sup_enabled != 0U))
+    {
+      SUP_Update(sup_request.value);
+    }
+  }
+  if (sup_enabled == 0U)
+  {
+    return;
+  }
+
+  if ((HAL_GetTick() - sup_tick) < SUP_PERIOD_MS)
+  {
+    return;
+  }
+  sup_tick = HAL_GetTick();
+
+  if (ACQ_GetMode() != ACQ_MODE_INDEPENDENT)
+  {
+    sup_stats.skipped++;
+    return;
+  }
+  if (INJ_Submit(&sup_request, ADC_CHANNEL_VREFINT) == HAL_OK)
+  {
+    sup_pending = 1U;
+  }
+}
+
+/**
+  * @brief  Current VDDA estimate
+  * @retval VDDA in uV, VOLT_VREF_UV until the first reading
+  */
+uint32_t SUP_GetMicrovolts(void)
+{
+  return sup_vdda_uv;
+}
+
+/**
+  * @brief  Copies the supply monitor counters
+  * @param  stats: destination
+  * @retval None
+  */
+void SUP_GetStats(SUP_StatsTypeDef *stats)
+{
+  *stats = sup_stats;
+}
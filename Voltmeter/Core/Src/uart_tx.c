@@ -0,0 +1,178 @@
+/**
+  ******************************************************************************
+  * @file           : uart_tx.c
+  * @brief          : Non-blocking UART transmit through a DMA-drained ring.
+  *
+  *                   Producers copy their bytes into the ring and return; the
+  *                   USART1 TX DMA channel sends the oldest contiguous part
+  *                   of the ring and, on completion, is restarted on the next
+  *                   part from the interrupt. A write that does not fit as a
+  *                   whole is dropped and counted, so a line is never cut.
+  *
+  *                   Head and tail are free-running 16-bit indices masked on
+  *                   access. The head is only moved by the main loop, the
+  *                   tail only by the transmit complete interrupt.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "uart_tx.h"
+
+/* Private define ------------------------------------------------------------*/
+#define UTX_MASK               (UTX_BUFFER_SIZE - 1U)
+
+#if ((UTX_BUFFER_SIZE & UTX_MASK) != 0U) || (UTX_BUFFER_SIZE > 32768U)
+#error "UTX_BUFFER_SIZE must be a power of two, 32768 at most"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef *utx_huart = NULL;
+static uint8_t utx_buffer[UTX_BUFFER_SIZE];
+static volatile uint16_t utx_head = 0U;
+static volatile uint16_t utx_tail = 0U;
+/* Bytes handed to the running DMA transfer, 0 while the channel is idle */
+static volatile uint16_t utx_chunk = 0U;
+static volatile uint32_t utx_dropped_writes = 0U;
+static volatile uint32_t utx_dropped_bytes = 0U;
+static uint16_t utx_high_water = 0U;
+
+/* Private function prototypes -----------------------------------------------*/
+static void UTX_Kick(void);
+
+/* Private user code ---------------------------------------------------------*/
+/* Starts the DMA on the oldest contiguous run of pending bytes if the channel
+   is idle. Runs from the main loop and from the completion interrupt. */
+static void UTX_Kick(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint16_t offset;
+  uint16_t length;
+
+  __disable_irq();
+  if ((utx_huart != NULL) && (utx_chunk == 0U) && (utx_head != utx_tail))
+  {
+    offset = utx_tail & UTX_MASK;
+    length = (uint16_t)(utx_head - utx_tail);
+    if (length > (UTX_BUFFER_SIZE - offset))
+    {
+      length = UTX_BUFFER_SIZE - offset;
+    }
+    if (HAL_UART_Transmit_DMA(utx_huart, &utx_buffer[offset], length) == HAL_OK)
+    {
+      utx_chunk = length;
+    }
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Binds the ring to a UART with a linked TX DMA channel
+  * @param  huart: UART handle (hdmatx must be linked)
+  * @retval None
+  */
+void UTX_Init(UART_HandleTypeDef *huart)
+{
+  utx_huart = huart;
+  utx_head = 0U;
+  utx_tail = 0U;
+  utx_chunk = 0U;
+}
+
+/**
+  * @brief  Queues bytes for transmission, never waits for the UART
+  * @note   Main loop context only (single producer).
+  * @param  data: bytes to send, copied before returning
+  * @param  length: number of bytes
+  * @retval HAL_BUSY if the ring has no room for all of them, nothing is queued
+  */
+HAL_StatusTypeDef UTX_Write(const void *data, uint16_t length)
+{
+  uint16_t used = (uint16_t)(utx_head - utx_tail);
+  uint16_t offset = utx_head & UTX_MASK;
+  uint16_t first;
+
+  if (length > (UTX_BUFFER_SIZE - used))
+  {
+    utx_dropped_writes++;
+    utx_dropped_bytes += length;
+    return HAL_BUSY;
+  }
+
+  first = UTX_BUFFER_SIZE - offset;
+  if (first > length)
+  {
+    first = length;
+  }
+  memcpy(&utx_buffer[offset], data, first);
+  memcpy(&utx_buffer[0], (const uint8_t *)data + first, length - first);
+
+  used += length;
+  if (used > utx_high_water)
+  {
+    utx_high_water = used;
+  }
+
+  /* Bytes must be in place before the DMA may see the new head */
+  __DMB();
+  utx_head += length;
+
+  UTX_Kick();
+  return HAL_OK;
+}
+
+/**
+  * @brief  Room left in the ring
+  * @retval Bytes that UTX_Write() would accept now
+  */
+uint16_t UTX_GetFree(void)
+{
+  return UTX_BUFFER_SIZE - (uint16_t)(utx_head - utx_tail);
+}
+
+/**
+  * @brief  Checks that everything queued has been sent
+  * @retval 1 if the ring is empty and no transfer is running
+  */
+uint8_t UTX_IsIdle(void)
+{
+  return (utx_head == utx_tail) && (utx_chunk == 0U);
+}
+
+/**
+  * @brief  Copies the overflow counters
+  * @param  stats: destination
+  * @retval None
+  */
+void UTX_GetStats(UTX_StatsTypeDef *stats)
+{
+  stats->dropped_writes = utx_dropped_writes;
+  stats->dropped_bytes = utx_dropped_bytes;
+  stats->high_water = utx_high_water;
+}
+
+/**
+  * @brief  Frees the sent chunk and starts the next one
+  * @retval None
+  */
+void UTX_TxCpltHandler(void)
+{
+  utx_tail += utx_chunk;
+  utx_chunk = 0U;
+  UTX_Kick();
+}
+
+/**
+  * @brief  Recovers from a TX DMA error, the running chunk is given up
+  * @note   UART errors that leave the transmitter busy are ignored here.
+  * @retval None
+  */
+void UTX_ErrorHandler(void)
+{
+  if ((utx_chunk == 0U) || (utx_huart->gState != HAL_UART_STATE_READY))
+  {
+    return;
+  }
+  utx_dropped_bytes += utx_chunk;
+  UTX_TxCpltHandler();
+}
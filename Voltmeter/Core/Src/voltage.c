@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @file           : voltage.c
+  * @brief          : Integer conversion of ADC counts to micro/millivolts.
+  *
+  *                   Replaces (raw * 3.3f) / 4095.0f: one 32x32->64 multiply
+  *                   (UMULL) by a precomputed Q22 constant and a shift, no
+  *                   soft-float library on the FPU-less Cortex-M3. At the
+  *                   nominal 3.3 V scale, rounded to two decimals, it gives
+  *                   the same text as "%.2f" of the float expression for
+  *                   every ADC code; a measured VDDA changes the scale.
+  *
+  *                   The scale starts at the nominal 3.3 V reference and
+  *                   follows the measured VDDA (supply.c) after
+  *                   VOLT_SetSupply(); the division is done there, a few
+  *                   times per second, not per conversion.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "voltage.h"
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t volt_supply_uv = VOLT_VREF_UV;
+static uint32_t volt_scale_q22 = VOLT_SCALE_Q22;
+static uint32_t volt_ratio_q16 = 1UL << 16;     /* VDDA / VOLT_VREF_UV */
+
+/**
+  * @brief  Converts ADC counts to microvolts
+  * @param  raw: ADC result, 0..VOLT_ADC_MAX
+  * @retval Input voltage in uV, rounded
+  */
+uint32_t VOLT_ToMicrovolts(uint16_t raw)
+{
+  return (uint32_t)((((uint64_t)raw * volt_scale_q22) + (1UL << 21)) >> 22);
+}
+
+/**
+  * @brief  Converts ADC counts to millivolts
+  * @param  raw: ADC result, 0..VOLT_ADC_MAX
+  * @retval Input voltage in mV, rounded
+  */
+uint32_t VOLT_ToMillivolts(uint16_t raw)
+{
+  return (VOLT_ToMicrovolts(raw) + 500U) / 1000U;
+}
+
+/**
+  * @brief  Converts an oversampled result to microvolts
+  * @param  value: result with extra_bits more bits, 0..VOLT_ADC_MAX << extra_bits
+  * @param  extra_bits: resolution above 12 bits, 0..8
+  * @retval Input voltage in uV, rounded
+  */
+uint32_t VOLT_OversampledToMicrovolts(uint32_t value, uint8_t extra_bits)
+{
+  uint8_t shift = (uint8_t)(22U + extra_bits);
+
+  return (uint32_t)((((uint64_t)value * volt_scale_q22) + (1ULL << (shift - 1U))) >> shift);
+}
+
+/**
+  * @brief  Sets the reference the ADC actually measures against
+  * @param  vdda_uv: measured VDDA in uV, VOLT_VREF_UV for the nominal scale
+  * @retval None
+  */
+void VOLT_SetSupply(uint32_t vdda_uv)
+{
+  volt_supply_uv = vdda_uv;
+  volt_scale_q22 = (uint32_t)((((uint64_t)vdda_uv << 22) + (VOLT_ADC_MAX / 2U)) / VOLT_ADC_MAX);
+  volt_ratio_q16 = (uint32_t)((((uint64_t)vdda_uv << 16) + (VOLT_VREF_UV / 2U)) / VOLT_VREF_UV);
+}
+
+/**
+  * @brief  Reference in use
+  * @retval VDDA in uV
+  */
+uint32_t VOLT_GetSupply(void)
+{
+  return volt_supply_uv;
+}
+
+/**
+  * @brief  Refers a reading to the nominal reference
+  * @note   Gives the reading an ideal 3.3 V supply would have produced, for
+  *         tables that work on ADC counts (calib.c).
+  * @param  value: ADC counts, any number of extra bits
+  * @retval Compensated value, same number of extra bits
+  */
+uint32_t VOLT_Compensate(uint32_t value)
+{
+  return (uint32_t)((((uint64_t)value * volt_ratio_q16) + (1UL << 15)) >> 16);
+}
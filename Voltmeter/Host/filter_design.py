@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Generates Core/Inc/filter_coeffs.h, the fixed-point filter presets.
+
+Run as a pre-build step (or via `make coeffs` in this directory):
+
+    python3 filter_design.py ../Core/Inc/filter_coeffs.h [--fs 1000]
+
+Only the standard library is used. Biquads are RBJ cookbook sections in
+Q30 with the feedback terms negated (y += a1*y1 + a2*y2); the decimating
+FIR is a Hamming-windowed sinc in Q15, zero-padded to a multiple of 4 taps
+and trimmed so its DC gain is exactly 1.
+"""
+
+import argparse
+import math
+
+Q30 = 1 << 30
+Q15 = 1 << 15
+
+
+def lowpass(fs, f0, q):
+    w0 = 2.0 * math.pi * f0 / fs
+    alpha = math.sin(w0) / (2.0 * q)
+    cosw = math.cos(w0)
+    a0 = 1.0 + alpha
+    b0 = (1.0 - cosw) / 2.0
+    return [b0 / a0, (1.0 - cosw) / a0, b0 / a0,
+            2.0 * cosw / a0, -(1.0 - alpha) / a0]
+
+
+def notch(fs, f0, q):
+    w0 = 2.0 * math.pi * f0 / fs
+    alpha = math.sin(w0) / (2.0 * q)
+    cosw = math.cos(w0)
+    a0 = 1.0 + alpha
+    return [1.0 / a0, -2.0 * cosw / a0, 1.0 / a0,
+            2.0 * cosw / a0, -(1.0 - alpha) / a0]
+
+
+def butterworth(fs, f0, order):
+    """Cascade of second order sections of an even order Butterworth."""
+    sections = []
+    for k in range(order // 2):
+        q = 1.0 / (2.0 * math.cos(math.pi * (2 * k + 1) / (2 * order)))
+        sections.append(lowpass(fs, f0, q))
+    return sections
+
+
+def fir_lowpass(fs, fc, taps):
+    centre = (taps - 1) / 2.0
+    h = []
+    for n in range(taps):
+        t = n - centre
+        sinc = 2.0 * fc / fs if t == 0 else math.sin(2.0 * math.pi * fc / fs * t) / (math.pi * t)
+        h.append(sinc * (0.54 - 0.46 * math.cos(2.0 * math.pi * n / (taps - 1))))
+    gain = sum(h)
+    q = [int(round(c / gain * Q15)) for c in h]
+    q[taps // 2] += Q15 - sum(q)
+    while len(q) % 4:
+        q.append(0)
+    return q
+
+
+def sos_table(name, sections):
+    rows = []
+    for s in sections:
+        rows.append("  " + ", ".join("%11d" % int(round(c * Q30)) for c in s) + ",")
+    return ["static const int32_t %s[] =" % name, "{"] + rows + ["};"]
+
+
+def fir_table(name, taps):
+    rows = []
+    for i in range(0, len(taps), 8):
+        rows.append("  " + ", ".join("%6d" % c for c in taps[i:i + 8]) + ",")
+    return ["static const int16_t %s[] =" % name, "{"] + rows + ["};"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("output")
+    parser.add_argument("--fs", type=float, default=1000.0, help="sample rate in Hz")
+    args = parser.parse_args()
+    fs = args.fs
+
+    lp_sos = butterworth(fs, fs * 0.04, 4)
+    lp_fir = fir_lowpass(fs, fs * 0.1, 31)
+    n50 = [notch(fs, 50.0, 5.0), notch(fs, 150.0, 5.0)]
+    n60 = [notch(fs, 60.0, 5.0), notch(fs, 180.0, 5.0)]
+
+    lines = [
+        "/**",
+        "  " + "*" * 78,
+        "  * @file           : filter_coeffs.h",
+        "  * @brief          : Filter preset coefficients for filter.c.",
+        "  *                   Generated by Host/filter_design.py, do not edit.",
+        "  *",
+        "  *                   Designed for a %g Hz sample rate:" % fs,
+        "  *                   LOWPASS   4th order Butterworth at %g Hz, then a" % (fs * 0.04),
+        "  *                             %d-tap FIR at %g Hz decimating by 4" % (len(lp_fir), fs * 0.1),
+        "  *                   NOTCH_50  notches at 50 and 150 Hz, Q 5",
+        "  *                   NOTCH_60  notches at 60 and 180 Hz, Q 5",
+        "  " + "*" * 78,
+        "  */",
+        "",
+        "/* Define to prevent recursive inclusion -------------------------------------*/",
+        "#ifndef __FILTER_COEFFS_H",
+        "#define __FILTER_COEFFS_H",
+        "",
+        "#define FLT_DESIGN_FS_HZ       %dU" % int(round(fs)),
+        "",
+        "/* Biquads: b0, b1, b2, a1, a2 in Q30, a1/a2 negated */",
+        "#define FLT_LOWPASS_STAGES     %dU" % len(lp_sos),
+        "#define FLT_LOWPASS_TAPS       %dU" % len(lp_fir),
+        "#define FLT_LOWPASS_DECIMATION 4U",
+        "#define FLT_NOTCH50_STAGES     %dU" % len(n50),
+        "#define FLT_NOTCH60_STAGES     %dU" % len(n60),
+        "",
+    ]
+    lines += sos_table("flt_lowpass_sos", lp_sos) + [""]
+    lines += fir_table("flt_lowpass_fir", lp_fir) + [""]
+    lines += sos_table("flt_notch50_sos", n50) + [""]
+    lines += sos_table("flt_notch60_sos", n60) + [""]
+    lines += ["#endif /* __FILTER_COEFFS_H */", ""]
+
+    # Core sources use CRLF line endings
+    with open(args.output, "w", newline="\r\n") as out:
+        out.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,515 @@
+/**
+  ******************************************************************************
+  * @file           : pipeline_bench.c
+  * @brief          : Runs the firmware processing pipeline on the PC.
+  *
+  *                   Feeds synthetic DMA blocks (DC, sine, noise, spikes)
+  *                   through PIPE_Block()/PIPE_Release() exactly as the
+  *                   main loop does and checks the report window against
+  *                   values computed here in double precision. Then every
+  *                   preset is timed over many blocks and the throughput is
+  *                   printed in samples per second, so a change to a stage
+  *                   can be checked and compared without a board. The PC
+  *                   numbers only compare algorithms; cycles on the F103
+  *                   come from filter_cycles_per_sample.
+  *
+  *                   Exit status 1 if a check fails.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "pipeline.h"
+#include "movavg.h"
+
+/* Private define ------------------------------------------------------------*/
+/* As on the device: 16 scans per block at 1 kHz, the rate the filter
+   presets were designed for */
+#define SCANS                  16U
+#define RATE_HZ                1000.0
+#define PI                     3.14159265358979323846
+/* Moving average history, the size of the FFT record main.c lends it */
+#define MAVG_HISTORY           1024U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef double (*SignalFunc)(unsigned long n, unsigned channel);
+
+typedef struct
+{
+  const char *name;
+  FLT_PresetTypeDef filter;
+  uint8_t extra_bits;
+  uint8_t order;
+  uint8_t ac;
+  ROB_ModeTypeDef robust;
+  uint8_t window;
+} BenchTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static PIPE_HandleTypeDef pipeline;
+static MAVG_HandleTypeDef mavg;
+static uint16_t mavg_history[MAVG_HISTORY];
+static int failures = 0;
+static unsigned long noise_state = 1U;
+
+static const BenchTypeDef benches[] =
+{
+  { "raw",             FLT_PRESET_NONE,      0U, 1U, 0U, ROB_MODE_NONE,     0U },
+  { "oversample 2 cic", FLT_PRESET_NONE,     2U, 2U, 0U, ROB_MODE_NONE,     0U },
+  { "oversample 4 box", FLT_PRESET_NONE,     4U, 1U, 0U, ROB_MODE_NONE,     0U },
+  { "lowpass",         FLT_PRESET_LOWPASS,   2U, 1U, 0U, ROB_MODE_NONE,     0U },
+  { "notch50",         FLT_PRESET_NOTCH_50HZ, 2U, 1U, 0U, ROB_MODE_NONE,    0U },
+  { "ac",              FLT_PRESET_NONE,      0U, 1U, 1U, ROB_MODE_NONE,     0U },
+  { "median 8",        FLT_PRESET_NONE,      0U, 1U, 0U, ROB_MODE_MEDIAN,   8U },
+  { "median 16",       FLT_PRESET_NONE,      0U, 1U, 0U, ROB_MODE_MEDIAN,  16U },
+  { "trimmed mean 32", FLT_PRESET_NONE,      0U, 1U, 0U, ROB_MODE_TRIMMED, 32U }
+};
+
+/* Private user code ---------------------------------------------------------*/
+/* Standard normal deviate, reproducible (LCG and Box-Muller) */
+static double gauss(void)
+{
+  double u;
+  double v;
+
+  noise_state = (noise_state * 1103515245UL) + 12345UL;
+  u = ((double)((noise_state >> 8) & 0xFFFFFFUL) + 1.0) / 16777218.0;
+  noise_state = (noise_state * 1103515245UL) + 12345UL;
+  v = (double)((noise_state >> 8) & 0xFFFFFFUL) / 16777216.0;
+  return sqrt(-2.0 * log(u)) * cos(2.0 * PI * v);
+}
+
+static uint16_t adc(double value)
+{
+  long code = lround(value);
+
+  return (uint16_t)((code < 0) ? 0 : ((code > 4095) ? 4095 : code));
+}
+
+static double dc_signal(unsigned long n, unsigned channel)
+{
+  (void)n;
+  return 1000.0 + (1000.0 * channel);
+}
+
+static double sine_signal(unsigned long n, unsigned channel)
+{
+  return 2048.0 + (1000.0 * sin((2.0 * PI * 50.0 * (double)n / RATE_HZ) + channel));
+}
+
+static double noise_signal(unsigned long n, unsigned channel)
+{
+  (void)n;
+  (void)channel;
+  return 2048.0 + (20.0 * gauss());
+}
+
+static double spike_signal(unsigned long n, unsigned channel)
+{
+  (void)channel;
+  return ((n % 97U) == 50U) ? 4000.0 : 1500.0;
+}
+
+/* One block of scans starting at scan n */
+static void make_block(uint16_t *data, SignalFunc signal, unsigned long n, unsigned channels)
+{
+  for (unsigned s = 0U; s < SCANS; s++)
+  {
+    for (unsigned ch = 0U; ch < channels; ch++)
+    {
+      data[(s * channels) + ch] = adc(signal(n + s, ch));
+    }
+  }
+}
+
+/* Runs blocks through the pipeline like the main loop, valid blocks only */
+static void feed(SignalFunc signal, unsigned long *n, unsigned blocks, unsigned channels)
+{
+  uint16_t data[PIPE_MAX_BLOCK];
+
+  for (unsigned b = 0U; b < blocks; b++)
+  {
+    make_block(data, signal, *n, channels);
+    PIPE_Block(&pipeline, data, (uint16_t)(SCANS * channels), (uint8_t)channels);
+    PIPE_Release(&pipeline, 1U);
+    *n += SCANS;
+  }
+}
+
+static void check(int ok, const char *what, double got, double want)
+{
+  printf("%-4s %-44s got %12.4f want %12.4f\n", ok ? "ok" : "FAIL", what, got, want);
+  if (!ok)
+  {
+    failures++;
+  }
+}
+
+static void check_near(const char *what, double got, double want, double tolerance)
+{
+  check(fabs(got - want) <= tolerance, what, got, want);
+}
+
+static double mean(const STATS_ChannelTypeDef *stats)
+{
+  return (stats->count != 0U) ? ((double)stats->sum / stats->count) : 0.0;
+}
+
+static void test_dc(void)
+{
+  unsigned long n = 0U;
+
+  (void)PIPE_Config(&pipeline, FLT_PRESET_NONE, 0U, 1U, 0U);
+  feed(dc_signal, &n, 10U, 3U);
+  for (unsigned ch = 0U; ch < 3U; ch++)
+  {
+    check_near("dc raw mean", mean(&pipeline.window_stats[ch]), dc_signal(0U, ch), 0.0);
+    check_near("dc raw max - min",
+               (double)pipeline.window_stats[ch].max - pipeline.window_stats[ch].min, 0.0, 0.0);
+  }
+  check(pipeline.processed == 0U, "dc raw not processed", pipeline.processed, 0.0);
+
+  /* CIC: the first outputs after the configuration are a transient */
+  (void)PIPE_Config(&pipeline, FLT_PRESET_NONE, 2U, 2U, 0U);
+  feed(dc_signal, &n, 4U, 3U);
+  PIPE_NextWindow(&pipeline);
+  feed(dc_signal, &n, 40U, 3U);
+  for (unsigned ch = 0U; ch < 3U; ch++)
+  {
+    check_near("dc cic 2 bits mean", mean(&pipeline.proc_stats[ch]), 4.0 * dc_signal(0U, ch), 0.0);
+  }
+  check_near("dc cic enob (exact input)", OVS_Enob(&pipeline.proc_noise[0], 14U) / 100.0, 14.0, 0.0);
+
+  (void)PIPE_Config(&pipeline, FLT_PRESET_LOWPASS, 2U, 1U, 0U);
+  feed(dc_signal, &n, 20U, 3U);
+  PIPE_NextWindow(&pipeline);
+  feed(dc_signal, &n, 20U, 3U);
+  for (unsigned ch = 0U; ch < 3U; ch++)
+  {
+    check_near("dc lowpass mean", mean(&pipeline.proc_stats[ch]), 4.0 * dc_signal(0U, ch), 1.0);
+  }
+}
+
+static void test_sine(void)
+{
+  unsigned long n = 0U;
+  double rms;
+
+  (void)PIPE_Config(&pipeline, FLT_PRESET_NONE, 0U, 1U, 1U);
+  /* The crossing level comes from the previous window */
+  feed(sine_signal, &n, 25U, 1U);
+  PIPE_NextWindow(&pipeline);
+  feed(sine_signal, &n, 125U, 1U);
+  rms = AC_RmsQ8(&pipeline.ac_window[0], 0U) / 256.0;
+  check_near("sine ac rms", rms, 1000.0 / sqrt(2.0), 0.005 * 1000.0 / sqrt(2.0));
+  check_near("sine ac frequency (Hz)", AC_FrequencyMilliHz(&pipeline.ac_window[0], 1000000U) / 1000.0,
+             50.0, 0.05);
+  check_near("sine ac peak-to-peak", AC_PeakToPeak(&pipeline.ac_window[0]), 2000.0, 2.0);
+
+  /* 50 Hz and its third harmonic are notched out */
+  (void)PIPE_Config(&pipeline, FLT_PRESET_NOTCH_50HZ, 2U, 1U, 0U);
+  feed(sine_signal, &n, 60U, 1U);
+  PIPE_NextWindow(&pipeline);
+  feed(sine_signal, &n, 60U, 1U);
+  check_near("sine notch50 residual p-p (input 8000)",
+             (double)pipeline.proc_stats[0].max - pipeline.proc_stats[0].min, 0.0, 160.0);
+  check_near("sine notch50 mean", mean(&pipeline.proc_stats[0]), 4.0 * 2048.0, 4.0);
+}
+
+static void test_noise(void)
+{
+  unsigned long n = 0U;
+
+  noise_state = 1U;
+  (void)PIPE_Config(&pipeline, FLT_PRESET_NONE, 0U, 1U, 1U);
+  feed(noise_signal, &n, 500U, 1U);
+  check_near("noise ac rms (sigma 20)", AC_RmsQ8(&pipeline.ac_window[0], 0U) / 256.0, 20.0, 1.0);
+  check_near("noise mean", mean(&pipeline.window_stats[0]), 2048.0, 0.5);
+}
+
+static void test_spikes(void)
+{
+  unsigned long n = 0U;
+  unsigned long spikes;
+  double want;
+
+  (void)PIPE_Config(&pipeline, FLT_PRESET_LOWPASS, 2U, 1U, 0U);
+  feed(spike_signal, &n, 97U, 1U);
+  spikes = (97U * SCANS) / 97U;
+  want = ((spikes * 4000.0) + (((97U * SCANS) - spikes) * 1500.0)) / (97U * SCANS);
+  check_near("spikes raw max", pipeline.window_stats[0].max, 4000.0, 0.0);
+  check_near("spikes raw min", pipeline.window_stats[0].min, 1500.0, 0.0);
+  check_near("spikes raw mean", mean(&pipeline.window_stats[0]), want, 1e-9);
+  PIPE_NextWindow(&pipeline);
+  feed(spike_signal, &n, 97U, 1U);
+  check_near("spikes lowpass mean", mean(&pipeline.proc_stats[0]), 4.0 * want, 0.01 * 4.0 * want);
+  check(pipeline.proc_stats[0].max < (4U * 2000U), "spikes lowpass max (smoothed)",
+        pipeline.proc_stats[0].max, 4.0 * 2000.0);
+}
+
+/* Every windowed position in one robust mode, or all off */
+static void set_robust(ROB_ModeTypeDef mode, uint8_t window)
+{
+  ROB_ConfigTypeDef config[ROB_MAX_CHANNELS];
+
+  for (unsigned ch = 0U; ch < ROB_MAX_CHANNELS; ch++)
+  {
+    config[ch].mode = mode;
+    config[ch].window = window;
+  }
+  (void)PIPE_ConfigRobust(&pipeline, config, ROB_MAX_CHANNELS);
+}
+
+static int compare_u16(const void *a, const void *b)
+{
+  return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+static void test_robust(void)
+{
+  static const uint8_t windows[] = { 8U, 16U, 32U };
+  uint16_t values[ROB_MAX_WINDOW];
+  uint16_t sorted[ROB_MAX_WINDOW];
+  unsigned long n = 0U;
+  unsigned unsorted = 0U;
+
+  /* Networks against qsort on random data with repeated values */
+  noise_state = 1U;
+  for (unsigned w = 0U; w < sizeof(windows); w++)
+  {
+    for (unsigned t = 0U; t < 2000U; t++)
+    {
+      for (unsigned i = 0U; i < windows[w]; i++)
+      {
+        values[i] = adc(2048.0 + (600.0 * gauss()));
+        sorted[i] = values[i];
+      }
+      ROB_Sort(values, windows[w]);
+      qsort(sorted, windows[w], sizeof(sorted[0]), compare_u16);
+      unsorted += (memcmp(values, sorted, windows[w] * sizeof(values[0])) != 0) ? 1U : 0U;
+    }
+  }
+  check(unsorted == 0U, "robust networks 8/16/32 sort", unsorted, 0.0);
+
+  /* One spike in 97 samples never reaches the median or the middle half */
+  (void)PIPE_Config(&pipeline, FLT_PRESET_NONE, 0U, 1U, 0U);
+  set_robust(ROB_MODE_MEDIAN, 16U);
+  feed(spike_signal, &n, 97U, 1U);
+  check_near("spikes median 16 mean", mean(&pipeline.window_stats[0]), 1500.0, 0.0);
+  check_near("spikes median 16 max", pipeline.window_stats[0].max, 1500.0, 0.0);
+  check_near("spikes median 16 count", pipeline.window_stats[0].count, 97.0, 0.0);
+  PIPE_NextWindow(&pipeline);
+  set_robust(ROB_MODE_TRIMMED, 32U);
+  feed(spike_signal, &n, 96U, 1U);
+  check_near("spikes trimmed 32 mean", mean(&pipeline.window_stats[0]), 1500.0, 0.0);
+  check_near("spikes trimmed 32 max", pipeline.window_stats[0].max, 1500.0, 0.0);
+  check_near("spikes trimmed 32 count", pipeline.window_stats[0].count, 48.0, 0.0);
+  set_robust(ROB_MODE_NONE, 0U);
+}
+
+/* Running sums against sums recomputed over every window, across blocks */
+static void test_mavg(void)
+{
+  static uint16_t samples[64U * SCANS * 3U];
+  const unsigned channels = 3U;
+  const unsigned window = 250U;
+  unsigned mismatches = 0U;
+  unsigned scans = 0U;
+
+  noise_state = 7U;
+  MAVG_Init(&mavg, mavg_history, MAVG_HISTORY);
+  MAVG_Config(&mavg, (uint16_t)window);
+  for (unsigned b = 0U; b < 64U; b++)
+  {
+    uint16_t *data = &samples[scans * channels];
+
+    for (unsigned k = 0U; k < (SCANS * channels); k++)
+    {
+      data[k] = adc(2048.0 + (800.0 * gauss()));
+    }
+    MAVG_Block(&mavg, data, (uint16_t)(SCANS * channels), (uint8_t)channels);
+    MAVG_Release(&mavg, 1U);
+    scans += SCANS;
+
+    for (unsigned ch = 0U; ch < channels; ch++)
+    {
+      unsigned first = (scans > window) ? (scans - window) : 0U;
+      uint64_t sum = 0U;
+
+      for (unsigned s = first; s < scans; s++)
+      {
+        sum += samples[(s * channels) + ch];
+      }
+      mismatches += (sum != mavg.sum[ch]) ? 1U : 0U;
+      mismatches += (((sum << 4) + ((scans - first) / 2U)) / (scans - first) !=
+                     MAVG_Mean(&mavg, (uint8_t)ch, 4U)) ? 1U : 0U;
+    }
+  }
+  check(mismatches == 0U, "moving average 250 exact sums", mismatches, 0.0);
+  check_near("moving average full", MAVG_IsFull(&mavg), 1.0, 0.0);
+
+  /* 3 channels fit 341 scans of the 1024-sample history */
+  MAVG_Config(&mavg, 2000U);
+  check_near("moving average window clamped", mavg.window, MAVG_HISTORY / channels, 0.0);
+  MAVG_Release(&mavg, 0U);
+  check_near("moving average torn block empties", mavg.fill, 0.0, 0.0);
+}
+
+/* Time per sample must not grow with the window */
+static void bench_mavg(uint16_t window, unsigned long blocks)
+{
+  static uint16_t data[PIPE_MAX_BLOCK];
+  struct timespec t0;
+  struct timespec t1;
+  double seconds;
+  double samples = (double)blocks * SCANS;
+
+  for (unsigned k = 0U; k < SCANS; k++)
+  {
+    data[k] = adc(sine_signal(k, 0U));
+  }
+  MAVG_Init(&mavg, mavg_history, MAVG_HISTORY);
+  MAVG_Config(&mavg, window);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (unsigned long i = 0U; i < blocks; i++)
+  {
+    MAVG_Block(&mavg, data, (uint16_t)SCANS, 1U);
+    MAVG_Release(&mavg, 1U);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  seconds = (double)(t1.tv_sec - t0.tv_sec) + ((double)(t1.tv_nsec - t0.tv_nsec) * 1e-9);
+  printf("moving average %4u  1 ch  %8.2f Msamples/s  %7.2f ns/sample\n",
+         (unsigned)window, samples / seconds / 1e6, seconds * 1e9 / samples);
+}
+
+/* A FORMAT AC window of 2^26 full-scale samples (a minute at a high rate):
+   the sum of squares passes 2^48, where scaling it first would overflow */
+static void test_long_window(void)
+{
+  AC_ChannelTypeDef window;
+  AC_ChannelTypeDef block;
+  uint16_t data[192];
+
+  for (unsigned i = 0U; i < 192U; i++)
+  {
+    data[i] = ((i % 2U) == 0U) ? 4095U : 0U;
+  }
+  AC_Reset(&window, 1U);
+  for (unsigned long b = 0U; b < ((1UL << 26) / 192U) + 1U; b++)
+  {
+    AC_Block(&block, &window, data, 192U, 1U);
+    AC_Merge(&window, &block, 1U);
+  }
+  check(window.sum_sq >= (1ULL << 48), "long window sum of squares >= 2^48",
+        (double)window.sum_sq, (double)(1ULL << 48));
+  check_near("long window ac rms", AC_RmsQ8(&window, 0U) / 256.0, 2047.5, 0.01);
+  check_near("long window ac+dc rms", AC_RmsQ8(&window, 1U) / 256.0, 4095.0 / sqrt(2.0), 0.01);
+}
+
+static void test_torn(void)
+{
+  unsigned long n = 0U;
+  uint16_t data[PIPE_MAX_BLOCK];
+  uint32_t count;
+
+  (void)PIPE_Config(&pipeline, FLT_PRESET_NONE, 0U, 1U, 1U);
+  feed(dc_signal, &n, 5U, 2U);
+  count = pipeline.window_stats[0].count;
+  memset(data, 0xFF, sizeof(data));
+  PIPE_Block(&pipeline, data, (uint16_t)(SCANS * 2U), 2U);
+  PIPE_Release(&pipeline, 0U);
+  check_near("torn block dropped (count)", pipeline.window_stats[0].count, count, 0.0);
+  check_near("torn block dropped (max)", pipeline.window_stats[0].max, dc_signal(0U, 0U), 0.0);
+}
+
+static void bench(const BenchTypeDef *b, unsigned channels, unsigned long blocks)
+{
+  static uint16_t data[8][PIPE_MAX_BLOCK];
+  struct timespec t0;
+  struct timespec t1;
+  unsigned long n = 0U;
+  double seconds;
+  double samples = (double)blocks * SCANS * channels;
+
+  noise_state = 1U;
+  for (unsigned i = 0U; i < 8U; i++)
+  {
+    for (unsigned k = 0U; k < (SCANS * channels); k++)
+    {
+      data[i][k] = adc(sine_signal(n, k % channels) + (5.0 * gauss()));
+      n += ((k % channels) == (channels - 1U)) ? 1U : 0U;
+    }
+  }
+  (void)PIPE_Config(&pipeline, b->filter, b->extra_bits, b->order, b->ac);
+  set_robust(b->robust, b->window);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (unsigned long i = 0U; i < blocks; i++)
+  {
+    PIPE_Block(&pipeline, data[i % 8U], (uint16_t)(SCANS * channels), (uint8_t)channels);
+    PIPE_Release(&pipeline, 1U);
+    if ((i % 64U) == 63U)
+    {
+      PIPE_NextWindow(&pipeline);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  seconds = (double)(t1.tv_sec - t0.tv_sec) + ((double)(t1.tv_nsec - t0.tv_nsec) * 1e-9);
+  printf("%-18s %2u ch  %8.2f Msamples/s  %7.2f ns/sample\n",
+         b->name, channels, samples / seconds / 1e6, seconds * 1e9 / samples);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long blocks = 200000UL;
+  int quick = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:q")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        blocks = strtoul(optarg, NULL, 0);
+        break;
+      case 'q':
+        quick = 1;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n blocks] [-q]\n"
+                        "  -n  blocks per benchmark (default 200000)\n"
+                        "  -q  checks only, no benchmark\n", argv[0]);
+        return 2;
+    }
+  }
+
+  test_dc();
+  test_sine();
+  test_noise();
+  test_spikes();
+  test_robust();
+  test_mavg();
+  test_long_window();
+  test_torn();
+  printf("%d check(s) failed\n", failures);
+
+  if (!quick && (blocks != 0U))
+  {
+    for (unsigned i = 0U; i < (sizeof(benches) / sizeof(benches[0])); i++)
+    {
+      bench(&benches[i], 1U, blocks);
+      bench(&benches[i], 4U, blocks / 4U);
+    }
+    bench_mavg(16U, blocks);
+    bench_mavg(1000U, blocks);
+  }
+  return (failures != 0) ? 1 : 0;
+}
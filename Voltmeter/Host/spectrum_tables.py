@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""Generates Core/Inc/spectrum_tables.h, the fixed-point FFT tables.
+
+Run as a pre-build step (or via `make tables` in this directory):
+
+    python3 spectrum_tables.py ../Core/Inc/spectrum_tables.h [--points 1024]
+
+Only the standard library is used. All tables are built for the largest
+transform and read with a stride by the smaller ones: three quarters of a
+sine period in Q15 (cosine is the sine a quarter period later), the
+bit-reversed indices of the half-size complex FFT and the first half of a
+periodic Hann window in Q15.
+"""
+
+import argparse
+import math
+
+Q15 = 1 << 15
+
+
+def q15(value):
+    return max(-Q15, min(Q15 - 1, int(round(value * Q15))))
+
+
+def table(ctype, name, values, per_row, width):
+    rows = []
+    for i in range(0, len(values), per_row):
+        rows.append("  " + ", ".join("%*d" % (width, v) for v in values[i:i + per_row]) + ",")
+    return ["static const %s %s[] =" % (ctype, name), "{"] + rows + ["};"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("output")
+    parser.add_argument("--points", type=int, default=1024, help="largest FFT size, a power of two")
+    args = parser.parse_args()
+    n = args.points
+    if n < 8 or n & (n - 1):
+        parser.error("--points must be a power of two")
+
+    half = n // 2
+    bits = half.bit_length() - 1
+    sine = [q15(math.sin(2.0 * math.pi * i / n)) for i in range(3 * n // 4)]
+    bitrev = [int(format(i, "0%db" % bits)[::-1], 2) for i in range(half)]
+    hann = [q15(0.5 - 0.5 * math.cos(2.0 * math.pi * i / n)) for i in range(half + 1)]
+
+    lines = [
+        "/**",
+        "  " + "*" * 78,
+        "  * @file           : spectrum_tables.h",
+        "  * @brief          : FFT tables for spectrum.c.",
+        "  *                   Generated by Host/spectrum_tables.py, do not edit.",
+        "  *",
+        "  *                   Built for %d points; smaller transforms read them" % n,
+        "  *                   with a stride of SPEC_TABLE_POINTS / points.",
+        "  " + "*" * 78,
+        "  */",
+        "",
+        "/* Define to prevent recursive inclusion -------------------------------------*/",
+        "#ifndef __SPECTRUM_TABLES_H",
+        "#define __SPECTRUM_TABLES_H",
+        "",
+        "#define SPEC_TABLE_POINTS      %dU" % n,
+        "",
+        "/* sin(2 pi i / SPEC_TABLE_POINTS) in Q15, i < 3/4 SPEC_TABLE_POINTS */",
+    ]
+    lines += table("int16_t", "spec_sine", sine, 8, 6) + [""]
+    lines += ["/* Bit-reversed index of the SPEC_TABLE_POINTS / 2 complex FFT */"]
+    lines += table("uint16_t", "spec_bitrev", bitrev, 16, 3) + [""]
+    lines += ["/* Periodic Hann window in Q15, first SPEC_TABLE_POINTS / 2 + 1 points */"]
+    lines += table("int16_t", "spec_hann", hann, 8, 6) + [""]
+    lines += ["#endif /* __SPECTRUM_TABLES_H */", ""]
+
+    # Core sources use CRLF line endings
+    with open(args.output, "w", newline="\r\n") as out:
+        out.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
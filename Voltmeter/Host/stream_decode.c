@@ -0,0 +1,471 @@
+/**
+  ******************************************************************************
+  * @file           : stream_decode.c
+  * @brief          : PC decoder for the Voltmeter raw sample stream.
+  *
+  *                   Reads the byte stream from a serial port, a recorded
+  *                   capture file or stdin, splits it on the 0x00 frame
+  *                   delimiters and checks every frame. Samples are written
+  *                   as CSV (one row per scan) and/or as raw little-endian
+  *                   uint16 values, channels interleaved:
+  *
+  *                     numpy.fromfile("out.u16", "<u2").reshape(-1, channels)
+  *
+  *                   Lost blocks are found from the gaps in the block
+  *                   sequence numbers and reported with the frame errors on
+  *                   stderr at the end. Triggered records (capture.c) go
+  *                   to a CSV of their own (-t), timed from the trigger,
+  *                   and a flash log dump (datalog.c) to another one (-l),
+  *                   timed by the device tick.
+  *
+  *                   stty -F /dev/ttyUSB0 2000000 raw
+  *                   ./stream_decode -c out.csv /dev/ttyUSB0
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "stream_frame.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Longer sequence jumps are treated as a device restart, not as a loss */
+#define MAX_GAP_BLOCKS         100000UL
+#define GAP_FILL_VALUE         0xFFFFU
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  unsigned long frames;
+  unsigned long cobs_errors;
+  unsigned long length_errors;
+  unsigned long crc_errors;
+  unsigned long missing_blocks;
+  unsigned long restarts;
+  unsigned long long samples;
+  unsigned long skipped_bytes;
+  unsigned long captures;
+  unsigned long log_scans;
+} DecodeStatsTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static FILE *csv_out = NULL;
+static FILE *bin_out = NULL;
+static FILE *capture_out = NULL;
+static FILE *log_out = NULL;
+static int gap_fill = 0;
+static int verbose = 1;
+
+static DecodeStatsTypeDef stats;
+static SFRAME_HeaderTypeDef last;
+static uint8_t last_channels[SFRAME_MAX_CHANNELS];
+static int have_last = 0;
+static int32_t capture_next = 0;
+static SFRAME_HeaderTypeDef log_last;
+static uint8_t log_last_channels[SFRAME_MAX_CHANNELS];
+
+/* Private user code ---------------------------------------------------------*/
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-c out.csv] [-b out.u16] [-t records.csv] [-l log.csv] [-g] [-q]\n"
+          "       [capture|-]\n"
+          "  -c  write samples as CSV, one row per scan\n"
+          "  -b  write samples as raw little-endian uint16, channels interleaved\n"
+          "  -t  write triggered records as CSV, time from the trigger\n"
+          "  -l  write a flash log dump as CSV, time from the device start\n"
+          "  -g  fill lost blocks with 0x%04X in the -b output\n"
+          "  -q  no configuration messages\n"
+          "  input defaults to stdin\n",
+          name, GAP_FILL_VALUE);
+}
+
+static void write_csv_header(const SFRAME_HeaderTypeDef *header, const uint8_t *channel_list)
+{
+  fprintf(csv_out, "sequence,time_s");
+  for (unsigned ch = 0; ch < header->channels; ch++)
+  {
+    fprintf(csv_out, ",CH%u", channel_list[ch]);
+  }
+  fprintf(csv_out, "\n");
+}
+
+static void write_gap(unsigned long blocks)
+{
+  static const uint16_t fill = GAP_FILL_VALUE;
+
+  for (unsigned long i = 0; i < blocks * last.samples; i++)
+  {
+    fwrite(&fill, sizeof(fill), 1, bin_out);
+  }
+}
+
+static void write_samples(const SFRAME_HeaderTypeDef *header, const uint16_t *samples)
+{
+  unsigned scans = header->samples / header->channels;
+
+  if (csv_out != NULL)
+  {
+    for (unsigned scan = 0; scan < scans; scan++)
+    {
+      /* Time of the scan from the start of the acquisition */
+      double index = (double)(header->sequence - 1U) * scans + scan;
+      double time = (header->rate_mhz != 0U) ? (index * 1000.0) / header->rate_mhz : 0.0;
+
+      fprintf(csv_out, "%lu,%.7f", (unsigned long)header->sequence, time);
+      for (unsigned ch = 0; ch < header->channels; ch++)
+      {
+        fprintf(csv_out, ",%u", samples[(scan * header->channels) + ch]);
+      }
+      fprintf(csv_out, "\n");
+    }
+  }
+
+  if (bin_out != NULL)
+  {
+    for (unsigned i = 0; i < header->samples; i++)
+    {
+      uint8_t le[2] = { (uint8_t)samples[i], (uint8_t)(samples[i] >> 8) };
+      fwrite(le, 1, sizeof(le), bin_out);
+    }
+  }
+}
+
+/* A record starts again from its most negative offset, so any offset other
+   than the one following the previous frame begins a new record */
+static void handle_capture(const SFRAME_HeaderTypeDef *header, const uint8_t *channel_list,
+                           const uint16_t *samples)
+{
+  int32_t offset = (int32_t)header->sequence;
+  unsigned scans = header->samples / header->channels;
+
+  if ((stats.captures == 0U) || (offset != capture_next))
+  {
+    stats.captures++;
+    if (verbose)
+    {
+      fprintf(stderr, "record %lu: %ld scan(s) before the trigger\n",
+              stats.captures, (long)((offset < 0) ? -offset : 0));
+    }
+    if (capture_out != NULL)
+    {
+      fprintf(capture_out, "record,scan,time_s");
+      for (unsigned ch = 0; ch < header->channels; ch++)
+      {
+        fprintf(capture_out, ",CH%u", channel_list[ch]);
+      }
+      fprintf(capture_out, "\n");
+    }
+  }
+  capture_next = offset + (int32_t)scans;
+
+  if (capture_out != NULL)
+  {
+    for (unsigned scan = 0; scan < scans; scan++)
+    {
+      long index = (long)offset + (long)scan;
+      double time = (header->rate_mhz != 0U) ? (index * 1000.0) / header->rate_mhz : 0.0;
+
+      fprintf(capture_out, "%lu,%ld,%.7f", stats.captures, index, time);
+      for (unsigned ch = 0; ch < header->channels; ch++)
+      {
+        fprintf(capture_out, ",%u", samples[(scan * header->channels) + ch]);
+      }
+      fprintf(capture_out, "\n");
+    }
+  }
+}
+
+/* Log frames carry the tick (ms) of their first scan; a new column header
+   is written whenever the logged channels change */
+static void handle_log(const SFRAME_HeaderTypeDef *header, const uint8_t *channel_list,
+                       const uint16_t *samples)
+{
+  unsigned scans = header->samples / header->channels;
+
+  if (log_out == NULL)
+  {
+    stats.log_scans += scans;
+    return;
+  }
+  if ((stats.log_scans == 0U) || (header->channels != log_last.channels) ||
+      (memcmp(channel_list, log_last_channels, header->channels) != 0))
+  {
+    fprintf(log_out, "time_s");
+    for (unsigned ch = 0; ch < header->channels; ch++)
+    {
+      fprintf(log_out, ",CH%u", channel_list[ch]);
+    }
+    fprintf(log_out, "\n");
+    log_last = *header;
+    memcpy(log_last_channels, channel_list, header->channels);
+  }
+
+  for (unsigned scan = 0; scan < scans; scan++)
+  {
+    double time = (header->sequence / 1000.0) +
+                  ((header->rate_mhz != 0U) ? (scan * 1000.0) / header->rate_mhz : 0.0);
+
+    fprintf(log_out, "%.3f", time);
+    for (unsigned ch = 0; ch < header->channels; ch++)
+    {
+      fprintf(log_out, ",%u", samples[(scan * header->channels) + ch]);
+    }
+    fprintf(log_out, "\n");
+  }
+  stats.log_scans += scans;
+}
+
+static SFRAME_StatusTypeDef handle_frame(const uint8_t *frame, uint16_t length)
+{
+  static uint8_t raw[SFRAME_ENCODED_MAX];
+  SFRAME_HeaderTypeDef header;
+  uint8_t channel_list[SFRAME_MAX_CHANNELS];
+  uint16_t samples[SFRAME_MAX_SAMPLES];
+  SFRAME_StatusTypeDef status;
+  int changed;
+
+  status = SFRAME_Decode(frame, length, raw, &header, channel_list, samples);
+  if ((status == SFRAME_OK) && (header.type == SFRAME_TYPE_CAPTURE))
+  {
+    handle_capture(&header, channel_list, samples);
+    return status;
+  }
+  if ((status == SFRAME_OK) && (header.type == SFRAME_TYPE_LOG))
+  {
+    handle_log(&header, channel_list, samples);
+    return status;
+  }
+  if ((status != SFRAME_OK) || (header.type != SFRAME_TYPE_SAMPLES))
+  {
+    return status;
+  }
+
+  changed = !have_last || (header.channels != last.channels) ||
+            (header.rate_mhz != last.rate_mhz) ||
+            (memcmp(channel_list, last_channels, header.channels) != 0);
+
+  if (have_last)
+  {
+    if (header.sequence > last.sequence)
+    {
+      unsigned long gap = header.sequence - last.sequence - 1U;
+
+      if (gap > MAX_GAP_BLOCKS)
+      {
+        stats.restarts++;
+      }
+      else
+      {
+        stats.missing_blocks += gap;
+        if (gap_fill && (bin_out != NULL) && !changed)
+        {
+          write_gap(gap);
+        }
+      }
+    }
+    else
+    {
+      stats.restarts++;
+    }
+  }
+
+  if (changed)
+  {
+    if (verbose)
+    {
+      fprintf(stderr, "block %lu: %u channel(s)", (unsigned long)header.sequence, header.channels);
+      for (unsigned ch = 0; ch < header.channels; ch++)
+      {
+        fprintf(stderr, " CH%u", channel_list[ch]);
+      }
+      fprintf(stderr, " at %.3f Hz, %u samples per block\n",
+              header.rate_mhz / 1000.0, header.samples);
+    }
+    if (csv_out != NULL)
+    {
+      write_csv_header(&header, channel_list);
+    }
+  }
+
+  write_samples(&header, samples);
+
+  stats.frames++;
+  stats.samples += header.samples;
+  last = header;
+  memcpy(last_channels, channel_list, header.channels);
+  have_last = 1;
+  return SFRAME_OK;
+}
+
+static void count_error(SFRAME_StatusTypeDef status)
+{
+  switch (status)
+  {
+    case SFRAME_OK:
+      break;
+    case SFRAME_ERR_COBS:
+      stats.cobs_errors++;
+      break;
+    case SFRAME_ERR_LENGTH:
+      stats.length_errors++;
+      break;
+    default:
+      stats.crc_errors++;
+      break;
+  }
+}
+
+static void decode(FILE *in)
+{
+  static uint8_t frame[SFRAME_ENCODED_MAX];
+  uint8_t chunk[4096];
+  size_t count;
+  size_t length = 0;
+  int first = 1;
+  int overflow = 0;
+
+  while ((count = fread(chunk, 1, sizeof(chunk), in)) > 0)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      uint8_t byte = chunk[i];
+      SFRAME_StatusTypeDef status = SFRAME_OK;
+
+      if (byte != 0U)
+      {
+        if (length < sizeof(frame))
+        {
+          frame[length++] = byte;
+        }
+        else
+        {
+          overflow = 1;
+        }
+        continue;
+      }
+
+      if (overflow)
+      {
+        status = SFRAME_ERR_LENGTH;
+      }
+      else if (length > 0)
+      {
+        status = handle_frame(frame, (uint16_t)length);
+      }
+
+      /* A capture may start inside a frame: a broken first frame is only
+         the tail of one sent before */
+      if ((status != SFRAME_OK) && first)
+      {
+        stats.skipped_bytes += length;
+      }
+      else
+      {
+        count_error(status);
+      }
+      first = 0;
+      length = 0;
+      overflow = 0;
+    }
+  }
+  /* A trailing frame without delimiter is incomplete */
+  stats.skipped_bytes += length;
+}
+
+int main(int argc, char **argv)
+{
+  FILE *in = stdin;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "c:b:t:l:gqh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'c':
+        csv_out = fopen(optarg, "w");
+        if (csv_out == NULL)
+        {
+          perror(optarg);
+          return 1;
+        }
+        break;
+      case 'b':
+        bin_out = fopen(optarg, "wb");
+        if (bin_out == NULL)
+        {
+          perror(optarg);
+          return 1;
+        }
+        break;
+      case 't':
+        capture_out = fopen(optarg, "w");
+        if (capture_out == NULL)
+        {
+          perror(optarg);
+          return 1;
+        }
+        break;
+      case 'l':
+        log_out = fopen(optarg, "w");
+        if (log_out == NULL)
+        {
+          perror(optarg);
+          return 1;
+        }
+        break;
+      case 'g':
+        gap_fill = 1;
+        break;
+      case 'q':
+        verbose = 0;
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+  if ((optind < argc) && (strcmp(argv[optind], "-") != 0))
+  {
+    in = fopen(argv[optind], "rb");
+    if (in == NULL)
+    {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+
+  decode(in);
+
+  fprintf(stderr,
+          "frames %lu, samples %llu, missing %lu blocks, restarts %lu, "
+          "crc errors %lu, cobs errors %lu, length errors %lu, skipped %lu bytes, "
+          "records %lu, log scans %lu\n",
+          stats.frames, stats.samples, stats.missing_blocks, stats.restarts,
+          stats.crc_errors, stats.cobs_errors, stats.length_errors, stats.skipped_bytes,
+          stats.captures, stats.log_scans);
+
+  if (csv_out != NULL)
+  {
+    fclose(csv_out);
+  }
+  if (bin_out != NULL)
+  {
+    fclose(bin_out);
+  }
+  if (capture_out != NULL)
+  {
+    fclose(capture_out);
+  }
+  if (log_out != NULL)
+  {
+    fclose(log_out);
+  }
+  if (in != stdin)
+  {
+    fclose(in);
+  }
+  return 0;
+}
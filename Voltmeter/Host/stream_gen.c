@@ -0,0 +1,186 @@
+/**
+  ******************************************************************************
+  * @file           : stream_gen.c
+  * @brief          : Writes a synthetic Voltmeter stream capture.
+  *
+  *                   Encodes blocks of a test signal with the firmware frame
+  *                   encoder, as the device would send them, and lets
+  *                   blocks be dropped or corrupted on the way. The samples
+  *                   of the blocks that survive are written to a reference
+  *                   file in the stream_decode -b format, so a decode of the
+  *                   capture can be compared byte for byte.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "stream_frame.h"
+
+/* Private define ------------------------------------------------------------*/
+#define MAX_EVENTS             32
+
+/* Private variables ---------------------------------------------------------*/
+static unsigned long drops[MAX_EVENTS];
+static unsigned long corrupts[MAX_EVENTS];
+static int drop_count = 0;
+static int corrupt_count = 0;
+
+/* Private user code ---------------------------------------------------------*/
+static int listed(const unsigned long *list, int count, unsigned long sequence)
+{
+  for (int i = 0; i < count; i++)
+  {
+    if (list[i] == sequence)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Triangle wave, each channel offset so columns can be told apart */
+static uint16_t signal(unsigned long scan, unsigned channel)
+{
+  unsigned phase = (unsigned)((scan * 37U) + (channel * 1000U)) % 8190U;
+
+  return (uint16_t)((phase < 4095U) ? phase : (8190U - phase));
+}
+
+int main(int argc, char **argv)
+{
+  static uint8_t raw[SFRAME_ENCODED_MAX];
+  static uint8_t frame[SFRAME_ENCODED_MAX];
+  SFRAME_HeaderTypeDef header = { SFRAME_TYPE_SAMPLES, 1U, 0U, 0U, 1000000U };
+  uint8_t channel_list[SFRAME_MAX_CHANNELS];
+  uint16_t samples[SFRAME_MAX_SAMPLES];
+  unsigned long blocks = 100;
+  unsigned scans = 16;
+  int partial = 0;
+  FILE *out = stdout;
+  FILE *ref = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:c:s:r:d:x:po:e:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        blocks = strtoul(optarg, NULL, 0);
+        break;
+      case 'c':
+        header.channels = (uint8_t)strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        scans = (unsigned)strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        header.rate_mhz = (uint32_t)(strtoul(optarg, NULL, 0) * 1000UL);
+        break;
+      case 'd':
+        if (drop_count < MAX_EVENTS)
+        {
+          drops[drop_count++] = strtoul(optarg, NULL, 0);
+        }
+        break;
+      case 'x':
+        if (corrupt_count < MAX_EVENTS)
+        {
+          corrupts[corrupt_count++] = strtoul(optarg, NULL, 0);
+        }
+        break;
+      case 'p':
+        partial = 1;
+        break;
+      case 'o':
+        out = fopen(optarg, "wb");
+        if (out == NULL)
+        {
+          perror(optarg);
+          return 1;
+        }
+        break;
+      case 'e':
+        ref = fopen(optarg, "wb");
+        if (ref == NULL)
+        {
+          perror(optarg);
+          return 1;
+        }
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-n blocks] [-c channels] [-s scans] [-r rate_hz]\n"
+                "          [-d seq]... [-x seq]... [-p] [-o capture] [-e reference.u16]\n"
+                "  -d  drop the block, -x flip a bit in its frame\n"
+                "  -p  start the capture with the tail of a frame\n",
+                argv[0]);
+        return 1;
+    }
+  }
+  if ((header.channels == 0U) || (header.channels > SFRAME_MAX_CHANNELS) ||
+      ((scans * header.channels) > SFRAME_MAX_SAMPLES))
+  {
+    fprintf(stderr, "channels * scans must fit into %u samples\n", SFRAME_MAX_SAMPLES);
+    return 1;
+  }
+
+  for (unsigned ch = 0; ch < header.channels; ch++)
+  {
+    channel_list[ch] = (uint8_t)ch;
+  }
+  header.samples = (uint16_t)(scans * header.channels);
+
+  if (partial)
+  {
+    /* Tail of a frame sent before the capture started */
+    static const uint8_t tail[] = { 0x12, 0x34, 0x56, 0x78, 0x9A, 0x00 };
+    fwrite(tail, 1, sizeof(tail), out);
+  }
+
+  for (unsigned long sequence = 1; sequence <= blocks; sequence++)
+  {
+    uint16_t length;
+
+    for (unsigned scan = 0; scan < scans; scan++)
+    {
+      for (unsigned ch = 0; ch < header.channels; ch++)
+      {
+        samples[(scan * header.channels) + ch] = signal(((sequence - 1U) * scans) + scan, ch);
+      }
+    }
+    header.sequence = (uint32_t)sequence;
+    length = SFRAME_Encode(frame, raw, &header, channel_list, samples);
+
+    if (listed(drops, drop_count, sequence))
+    {
+      continue;
+    }
+    if (listed(corrupts, corrupt_count, sequence))
+    {
+      /* Keep the byte non-zero so the frame boundaries stay intact */
+      uint8_t *byte = &frame[length / 2U];
+      *byte ^= ((*byte ^ 0x10U) != 0U) ? 0x10U : 0x20U;
+    }
+    else if (ref != NULL)
+    {
+      for (unsigned i = 0; i < header.samples; i++)
+      {
+        uint8_t le[2] = { (uint8_t)samples[i], (uint8_t)(samples[i] >> 8) };
+        fwrite(le, 1, sizeof(le), ref);
+      }
+    }
+    fwrite(frame, 1, length, out);
+  }
+
+  if (ref != NULL)
+  {
+    fclose(ref);
+  }
+  if (out != stdout)
+  {
+    fclose(out);
+  }
+  return 0;
+}